@@ -196,6 +196,10 @@ void SwitcherData::Thread()
 	std::chrono::milliseconds duration;
 	auto startTime = std::chrono::high_resolution_clock::now();
 	auto endTime = std::chrono::high_resolution_clock::now();
+	// Time of the last regular check, which might have been replaced by
+	// an earlier requested check
+	std::chrono::high_resolution_clock::time_point lastRegularCheck{};
+	std::chrono::milliseconds skippedWait(0);
 	switcher->firstIntervalAfterStop = true;
 
 	while (true) {
@@ -219,7 +223,8 @@ void SwitcherData::Thread()
 			duration = std::chrono::milliseconds(sleep);
 		} else {
 			duration = std::chrono::milliseconds(interval) +
-				   std::chrono::milliseconds(linger) - runTime;
+				   std::chrono::milliseconds(linger) - runTime +
+				   skippedWait;
 			if (duration.count() < 1) {
 				blog(LOG_INFO,
 				     "detected busy loop - refusing to sleep less than 1ms");
@@ -229,9 +234,26 @@ void SwitcherData::Thread()
 
 		vblog(LOG_INFO, "try to sleep for %ld", duration.count());
 		SetWaitScene();
-		cv.wait_for(lock, duration);
+		const auto regularCheck =
+			std::chrono::high_resolution_clock::now() + duration;
+		const auto waitInterrupted = [this]() {
+			return stop || SceneChangedDuringWait();
+		};
+		// Requested checks are only performed once the time of the
+		// regular check they replaced has passed
+		cv.wait_until(lock, std::min(lastRegularCheck, regularCheck),
+			      waitInterrupted);
+		cv.wait_until(lock, regularCheck, [&]() {
+			return waitInterrupted() || macroCheckRequested;
+		});
+		macroCheckRequested = false;
 
 		startTime = std::chrono::high_resolution_clock::now();
+		skippedWait = std::max(
+			std::chrono::duration_cast<std::chrono::milliseconds>(
+				regularCheck - startTime),
+			std::chrono::milliseconds(0));
+		lastRegularCheck = regularCheck;
 		sleep = 0;
 		linger = 0;
 
@@ -257,7 +279,9 @@ void SwitcherData::Thread()
 			      duration.count());
 
 			SetWaitScene();
-			cv.wait_for(lock, duration);
+			cv.wait_for(lock, duration, [this]() {
+				return stop || SceneChangedDuringWait();
+			});
 
 			if (stop) {
 				break;
@@ -327,12 +351,8 @@ void SwitcherData::SetPreconditions()
 	lastCursorPos = GetCursorPos();
 }
 
-void ClearWebsocketMessages();
-
 void SwitcherData::ResetForNextInterval()
 {
-	// Core reset functions
-	ClearWebsocketMessages();
 	// Plugin reset functions
 	for (const auto &func : resetIntervalSteps) {
 		func();
@@ -484,6 +504,16 @@ void SwitcherData::Stop()
 	}
 }
 
+void SwitcherData::RequestMacroCheck()
+{
+	// The mutex is not locked, as this might be called from threads, which
+	// must not be blocked, like the audio thread.
+	// A notification missed right before the main loop starts waiting only
+	// delays the check until the end of the interval.
+	macroCheckRequested = true;
+	cv.notify_one();
+}
+
 void SwitcherData::SetWaitScene()
 {
 	waitScene = obs_frontend_get_current_scene();
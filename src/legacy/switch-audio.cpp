@@ -134,18 +134,17 @@ bool SwitcherData::checkAudioSwitch(OBSWeakSource &scene,
 
 		// peak will have a value from -60 db to 0 db
 		bool volumeThresholdreached = false;
+		const float peak = s.volmeter ? s.volmeter->TakePeak()
+					      : -FLT_MAX;
 
 		if (s.condition == ABOVE) {
-			volumeThresholdreached = ((double)s.peak + 60) * 1.7 >
+			volumeThresholdreached = ((double)peak + 60) * 1.7 >
 						 s.volumeThreshold;
 		} else {
-			volumeThresholdreached = ((double)s.peak + 60) * 1.7 <
+			volumeThresholdreached = ((double)peak + 60) * 1.7 <
 						 s.volumeThreshold;
 		}
 
-		// Reset for next check
-		s.peak = -FLT_MAX;
-
 		if (!volumeThresholdreached) {
 			s.duration.Reset();
 		}
@@ -241,40 +240,9 @@ void AdvSceneSwitcher::SetupAudioTab()
 	ui->audioFallback->setChecked(switcher->audioFallback.enable);
 }
 
-void AudioSwitch::setVolumeLevel(void *data, const float *,
-				 const float peak[MAX_AUDIO_CHANNELS],
-				 const float *)
-{
-	AudioSwitch *s = static_cast<AudioSwitch *>(data);
-
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
-		if (peak[i] > s->peak) {
-			s->peak = peak[i];
-		}
-	}
-}
-
-obs_volmeter_t *AddVolmeterToSource(AudioSwitch *entry, obs_weak_source *source)
-{
-	obs_volmeter_t *volmeter = obs_volmeter_create(OBS_FADER_LOG);
-	obs_volmeter_add_callback(volmeter, AudioSwitch::setVolumeLevel, entry);
-	obs_source_t *as = obs_weak_source_get_source(source);
-	if (!obs_volmeter_attach_source(volmeter, as)) {
-		const char *name = obs_source_get_name(as);
-		blog(LOG_WARNING, "failed to attach volmeter to source %s",
-		     name);
-	}
-	obs_source_release(as);
-
-	return volmeter;
-}
-
 void AudioSwitch::resetVolmeter()
 {
-	obs_volmeter_remove_callback(volmeter, setVolumeLevel, this);
-	obs_volmeter_destroy(volmeter);
-
-	volmeter = AddVolmeterToSource(this, audioSource);
+	volmeter = std::make_unique<VolmeterSubscription>(audioSource);
 }
 
 bool AudioSwitch::initialized()
@@ -313,7 +281,7 @@ void AudioSwitch::load(obs_data_t *obj)
 	duration.Load(obj, "duration");
 	ignoreInactiveSource = obs_data_get_bool(obj, "ignoreInactiveSource");
 
-	volmeter = AddVolmeterToSource(this, audioSource);
+	resetVolmeter();
 }
 
 void AudioSwitchFallback::save(obs_data_t *obj)
@@ -344,7 +312,7 @@ AudioSwitch::AudioSwitch(const AudioSwitch &other)
 	  condition(other.condition),
 	  duration(other.duration)
 {
-	volmeter = AddVolmeterToSource(this, other.audioSource);
+	resetVolmeter();
 }
 
 AudioSwitch::AudioSwitch(AudioSwitch &&other) noexcept
@@ -354,15 +322,8 @@ AudioSwitch::AudioSwitch(AudioSwitch &&other) noexcept
 	  volumeThreshold(other.volumeThreshold),
 	  condition(other.condition),
 	  duration(other.duration),
-	  volmeter(other.volmeter)
+	  volmeter(std::move(other.volmeter))
 {
-	other.volmeter = nullptr;
-}
-
-AudioSwitch::~AudioSwitch()
-{
-	obs_volmeter_remove_callback(volmeter, setVolumeLevel, this);
-	obs_volmeter_destroy(volmeter);
 }
 
 AudioSwitch &AudioSwitch::operator=(const AudioSwitch &other)
@@ -379,10 +340,7 @@ AudioSwitch &AudioSwitch::operator=(AudioSwitch &&other) noexcept
 	}
 
 	swap(*this, other);
-
-	obs_volmeter_remove_callback(other.volmeter, setVolumeLevel, this);
-	obs_volmeter_destroy(other.volmeter);
-	other.volmeter = nullptr;
+	other.volmeter.reset();
 
 	return *this;
 }
@@ -398,10 +356,7 @@ void swap(AudioSwitch &first, AudioSwitch &second)
 	std::swap(first.volumeThreshold, second.volumeThreshold);
 	std::swap(first.condition, second.condition);
 	std::swap(first.duration, second.duration);
-	std::swap(first.peak, second.peak);
 	std::swap(first.volmeter, second.volmeter);
-	first.resetVolmeter();
-	second.resetVolmeter();
 }
 
 static inline void populateConditionSelection(QComboBox *list)
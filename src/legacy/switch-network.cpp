@@ -10,6 +10,7 @@ Most of this code is based on https://github.com/Palakis/obs-websocket
 #include "switcher-data.hpp"
 #include "scene-switch-helpers.hpp"
 #include "utility.hpp"
+#include "network-event-loop.hpp"
 
 namespace advss {
 
@@ -123,7 +124,7 @@ WSServer::WSServer() : QObject(nullptr), _connections(), _clMutex()
 		websocketpp::log::alevel::frame_header |
 		websocketpp::log::alevel::frame_payload |
 		websocketpp::log::alevel::control);
-	_server.init_asio();
+	_server.init_asio(&GetNetworkEventLoop());
 #ifndef _WIN32
 	_server.set_reuse_addr(true);
 #endif
@@ -151,8 +152,6 @@ void WSServer::start(quint16 port, bool lockToIPv4)
 		stop();
 	}
 
-	_server.reset();
-
 	_serverPort = port;
 	_lockToIPv4 = lockToIPv4;
 
@@ -187,14 +186,9 @@ void WSServer::start(quint16 port, bool lockToIPv4)
 	}
 	switcher->serverStatus = ServerStatus::STARTING;
 
+	// Connections are handled by the shared network event loop
 	_server.start_accept();
 
-	_threadPool.start(Compatability::CreateFunctionRunnable([=]() {
-		blog(LOG_INFO, "WSServer::start: io thread started");
-		_server.run();
-		blog(LOG_INFO, "WSServer::start: io thread exited");
-	}));
-
 	switcher->serverStatus = ServerStatus::RUNNING;
 	blog(LOG_INFO,
 	     "WSServer::start: server started successfully on port %d",
@@ -359,7 +353,7 @@ WSClient::WSClient() : QObject(nullptr)
 		websocketpp::log::alevel::frame_header |
 		websocketpp::log::alevel::frame_payload |
 		websocketpp::log::alevel::control);
-	_client.init_asio();
+	_client.init_asio(&GetNetworkEventLoop());
 #ifndef _WIN32
 	_client.set_reuse_addr(true);
 #endif
@@ -373,80 +367,82 @@ WSClient::WSClient() : QObject(nullptr)
 WSClient::~WSClient()
 {
 	disconnect();
+	while (_pendingHandlers > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
 }
 
-void WSClient::connectThread()
+// Must be called while holding _connectMtx
+void WSClient::connectNow()
 {
-	while (_retry) {
-		_client.reset();
-		switcher->clientStatus = ClientStatus::CONNECTING;
-		// Create a connection to the given URI and queue it for connection once
-		// the event loop starts
-		websocketpp::lib::error_code ec;
-		client::connection_ptr con = _client.get_connection(_uri, ec);
-		if (ec) {
-			_failMsg = ec.message();
-			blog(LOG_INFO, "client: connect failed: %s",
-			     _failMsg.c_str());
-			switcher->clientStatus = ClientStatus::FAIL;
-		} else {
-			_client.connect(con);
-			_connection = connection_hdl(con);
-
-			// Start the ASIO io_service run loop
-			blog(LOG_INFO, "WSClient::connect: io thread started");
-			_connected = true;
-			_client.run();
-			_connected = false;
-			blog(LOG_INFO, "WSClient::connect: io thread exited");
-		}
+	switcher->clientStatus = ClientStatus::CONNECTING;
+	// The connection is established by the shared network event loop
+	websocketpp::lib::error_code ec;
+	client::connection_ptr con = _client.get_connection(_uri, ec);
+	if (ec) {
+		_failMsg = ec.message();
+		blog(LOG_INFO, "client: connect failed: %s", _failMsg.c_str());
+		switcher->clientStatus = ClientStatus::FAIL;
+		scheduleReconnect();
+		return;
+	}
+	_connected = true;
+	_connection = connection_hdl(con);
+	_client.connect(con);
+}
 
-		if (_retry) {
-			std::unique_lock<std::mutex> lck(_waitMtx);
-			blog(LOG_INFO,
-			     "trying to reconnect to %s in %d seconds.",
-			     _uri.c_str(), RECONNECT_DELAY);
-			_cv.wait_for(lck,
-				     std::chrono::seconds(RECONNECT_DELAY));
-		}
+// Must be called while holding _connectMtx
+void WSClient::scheduleReconnect()
+{
+	if (!_retry) {
+		return;
 	}
+	blog(LOG_INFO, "trying to reconnect to %s in %d seconds.",
+	     _uri.c_str(), RECONNECT_DELAY);
+	++_pendingHandlers;
+	_reconnectTimer = _client.set_timer(
+		RECONNECT_DELAY * 1000,
+		[this](const websocketpp::lib::error_code &ec) {
+			if (!ec) {
+				std::lock_guard<std::mutex> lock(_connectMtx);
+				if (_retry) {
+					connectNow();
+				}
+			}
+			--_pendingHandlers;
+		});
 }
 
 void WSClient::connect(std::string uri)
 {
 	disconnect();
+	std::lock_guard<std::mutex> lock(_connectMtx);
 	_uri = uri;
 	_retry = true;
-
-	_thread = std::thread(&WSClient::connectThread, this);
-
-	switcher->clientStatus = ClientStatus::DISCONNECTED;
+	connectNow();
 	blog(LOG_INFO, "WSClient::connect: exited");
 }
 
 void WSClient::disconnect()
 {
-	_retry = false;
-	websocketpp::lib::error_code ec;
-	_client.close(_connection, websocketpp::close::status::normal,
-		      "Client stopping", ec);
-
 	{
-		std::unique_lock<std::mutex> waitLck(_waitMtx);
-		blog(LOG_INFO, "trying to reconnect to %s in %d seconds.",
-		     _uri.c_str(), RECONNECT_DELAY);
-		_cv.notify_all();
+		std::lock_guard<std::mutex> lock(_connectMtx);
+		_retry = false;
+		if (_reconnectTimer) {
+			_reconnectTimer->cancel();
+			_reconnectTimer.reset();
+		}
 	}
 
+	// The close and fail handlers require the connect lock
+	websocketpp::lib::error_code ec;
+	_client.close(_connection, websocketpp::close::status::normal,
+		      "Client stopping", ec);
 	while (_connected) {
 		std::this_thread::sleep_for(std::chrono::milliseconds(10));
 		_client.close(_connection, websocketpp::close::status::normal,
 			      "Client stopping", ec);
 	}
-
-	if (_thread.joinable()) {
-		_thread.join();
-	}
 }
 
 void WSClient::onOpen(connection_hdl)
@@ -458,6 +454,12 @@ void WSClient::onOpen(connection_hdl)
 void WSClient::onFail(connection_hdl)
 {
 	blog(LOG_INFO, "connection to %s failed", _uri.c_str());
+	{
+		std::lock_guard<std::mutex> lock(_connectMtx);
+		scheduleReconnect();
+	}
+	// This object might be destroyed as soon as this flag is cleared
+	_connected = false;
 }
 
 void WSClient::onMessage(connection_hdl hdl, client::message_ptr message)
@@ -488,6 +490,12 @@ void WSClient::onClose(connection_hdl)
 {
 	blog(LOG_INFO, "client-connection to %s closed.", _uri.c_str());
 	switcher->clientStatus = ClientStatus::DISCONNECTED;
+	{
+		std::lock_guard<std::mutex> lock(_connectMtx);
+		scheduleReconnect();
+	}
+	// This object might be destroyed as soon as this flag is cleared
+	_connected = false;
 }
 
 void SwitcherData::loadNetworkSettings(obs_data_t *obj)
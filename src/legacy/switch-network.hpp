@@ -101,16 +101,17 @@ private:
 	void onFail(connection_hdl hdl);
 	void onMessage(connection_hdl hdl, client::message_ptr message);
 	void onClose(connection_hdl hdl);
-	void connectThread();
+	void connectNow();
+	void scheduleReconnect();
 
 	client _client;
 	std::string _uri;
 	connection_hdl _connection;
-	std::thread _thread;
 	bool _retry = false;
 	std::atomic_bool _connected = {false};
-	std::mutex _waitMtx;
-	std::condition_variable _cv;
+	std::mutex _connectMtx;
+	client::timer_ptr _reconnectTimer;
+	std::atomic_int _pendingHandlers = {0};
 	std::string _failMsg;
 };
 
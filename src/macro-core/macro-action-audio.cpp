@@ -2,6 +2,8 @@
 #include "switcher-data.hpp"
 #include "utility.hpp"
 
+#include <cmath>
+
 namespace advss {
 
 constexpr int64_t nsPerMs = 1000000;
@@ -36,48 +38,36 @@ const static std::map<MacroActionAudio::FadeType, std::string> fadeTypes = {
 	 "AdvSceneSwitcher.action.audio.fade.type.rate"},
 };
 
-constexpr auto fadeInterval = std::chrono::milliseconds(100);
-constexpr float minFade = 0.000001f;
+const static std::map<FadeCurve, std::string> fadeCurves = {
+	{FadeCurve::LINEAR, "AdvSceneSwitcher.action.audio.fade.curve.linear"},
+	{FadeCurve::DB, "AdvSceneSwitcher.action.audio.fade.curve.db"},
+	{FadeCurve::S_CURVE, "AdvSceneSwitcher.action.audio.fade.curve.sCurve"},
+};
 
-void MacroActionAudio::SetFadeActive(bool value)
+OBSWeakSource MacroActionAudio::GetFadeSource() const
 {
+	// The master volume is faded if no source is given
 	if (_action == Action::SOURCE_VOLUME) {
-		switcher->activeAudioFades[_audioSource.ToString()].active =
-			value;
-	} else {
-		switcher->masterAudioFade.active = value;
+		return _audioSource.GetSource();
 	}
+	return nullptr;
 }
 
-bool MacroActionAudio::FadeActive()
+std::chrono::milliseconds MacroActionAudio::GetFadeDuration(float volume) const
 {
-	bool active = true;
-	if (_action == Action::SOURCE_VOLUME) {
-		auto it = switcher->activeAudioFades.find(
-			_audioSource.ToString());
-		if (it == switcher->activeAudioFades.end()) {
-			return false;
-		}
-		active = it->second.active;
-	} else {
-		active = switcher->masterAudioFade.active;
+	if (_fadeType == FadeType::DURATION) {
+		return std::chrono::milliseconds(
+			(int64_t)_duration.Milliseconds());
 	}
 
-	return active;
-}
-
-std::atomic_int *MacroActionAudio::GetFadeIdPtr()
-{
-
-	if (_action == Action::SOURCE_VOLUME) {
-		auto it = switcher->activeAudioFades.find(
-			_audioSource.ToString());
-		if (it == switcher->activeAudioFades.end()) {
-			return nullptr;
-		}
-		return &it->second.id;
+	// The rate is given in percent per second
+	const double rate = _rate;
+	if (rate <= 0.) {
+		return std::chrono::milliseconds(0);
 	}
-	return &switcher->masterAudioFade.id;
+	const double volDiff = std::abs(volume - GetVolume());
+	return std::chrono::milliseconds(
+		(int64_t)(volDiff * 100. / rate * 1000.));
 }
 
 void MacroActionAudio::SetVolume(float vol)
@@ -107,55 +97,14 @@ float MacroActionAudio::GetVolume()
 	return curVol;
 }
 
-void MacroActionAudio::FadeVolume()
-{
-	float vol = (float)_volume / 100.0f;
-	float curVol = GetVolume();
-	bool volIncrease = curVol <= vol;
-	float volDiff = (volIncrease) ? vol - curVol : curVol - vol;
-	int nrSteps = 0;
-	float volStep = 0.;
-	if (_fadeType == FadeType::DURATION) {
-		nrSteps = _duration.Milliseconds() / fadeInterval.count();
-		volStep = volDiff / nrSteps;
-	} else {
-		volStep = _rate / 1000.0f;
-		nrSteps = volDiff / volStep;
-	}
-
-	if (volStep < minFade || nrSteps <= 1) {
-		SetVolume(vol);
-		SetFadeActive(false);
-		return;
-	}
-
-	auto macro = GetMacro();
-	int step = 0;
-	auto fadeId = GetFadeIdPtr();
-	int expectedFadeId = ++(*fadeId);
-	for (; step < nrSteps && !macro->GetStop() && expectedFadeId == *fadeId;
-	     ++step) {
-		curVol = (volIncrease) ? curVol + volStep : curVol - volStep;
-		SetVolume(curVol);
-		std::this_thread::sleep_for(fadeInterval);
-	}
-
-	// As a final step set desired volume once again in case floating-point
-	// precision errors compounded to a noticeable error
-	if (step == nrSteps) {
-		SetVolume(vol);
-	}
-
-	SetFadeActive(false);
-}
-
 void MacroActionAudio::StartFade()
 {
 	if (_action == Action::SOURCE_VOLUME && !_audioSource.GetSource()) {
 		return;
 	}
 
-	if (FadeActive() && !_abortActiveFade) {
+	const auto source = GetFadeSource();
+	if (AudioFadeActive(source) && !_abortActiveFade) {
 		blog(LOG_WARNING,
 		     "Audio fade for volume of %s already active! New fade request will be ignored!",
 		     (_action == Action::SOURCE_VOLUME)
@@ -163,13 +112,17 @@ void MacroActionAudio::StartFade()
 			     : "master volume");
 		return;
 	}
-	SetFadeActive(true);
 
+	// An active fade of the same volume is retargeted to the new volume
+	AudioFade fade;
+	fade.source = source;
+	fade.volume = (float)_volume / 100.0f;
+	fade.duration = GetFadeDuration(fade.volume);
+	fade.curve = _fadeCurve;
+	fade.owner = GetMacro();
+	const auto id = StartAudioFade(fade);
 	if (_wait) {
-		FadeVolume();
-	} else {
-		GetMacro()->AddHelperThread(
-			std::thread(&MacroActionAudio::FadeVolume, this));
+		WaitForAudioFade(id);
 	}
 }
 
@@ -234,6 +187,7 @@ bool MacroActionAudio::Save(obs_data_t *obj) const
 	_rate.Save(obj, "rate");
 	obs_data_set_bool(obj, "fade", _fade);
 	obs_data_set_int(obj, "fadeType", static_cast<int>(_fadeType));
+	obs_data_set_int(obj, "fadeCurve", static_cast<int>(_fadeCurve));
 	obs_data_set_bool(obj, "wait", _wait);
 	obs_data_set_bool(obj, "abortActiveFade", _abortActiveFade);
 	obs_data_set_int(obj, "version", 1);
@@ -271,6 +225,7 @@ bool MacroActionAudio::Load(obs_data_t *obj)
 	} else {
 		_fadeType = FadeType::DURATION;
 	}
+	_fadeCurve = static_cast<FadeCurve>(obs_data_get_int(obj, "fadeCurve"));
 	if (obs_data_has_user_value(obj, "abortActiveFade")) {
 		_abortActiveFade = obs_data_get_bool(obj, "abortActiveFade");
 	} else {
@@ -306,12 +261,20 @@ static inline void populateFadeTypeSelection(QComboBox *list)
 	}
 }
 
+static inline void populateFadeCurveSelection(QComboBox *list)
+{
+	for (const auto &[_, name] : fadeCurves) {
+		list->addItem(obs_module_text(name.c_str()));
+	}
+}
+
 MacroActionAudioEdit::MacroActionAudioEdit(
 	QWidget *parent, std::shared_ptr<MacroActionAudio> entryData)
 	: QWidget(parent),
 	  _sources(new SourceSelectionWidget(this, QStringList(), true)),
 	  _actions(new QComboBox),
 	  _fadeTypes(new QComboBox),
+	  _fadeCurves(new QComboBox),
 	  _syncOffset(new VariableSpinBox),
 	  _monitorTypes(new QComboBox),
 	  _balance(new SliderSpinBox(
@@ -327,6 +290,7 @@ MacroActionAudioEdit::MacroActionAudioEdit(
 	  _abortActiveFade(new QCheckBox(
 		  obs_module_text("AdvSceneSwitcher.action.audio.fade.abort"))),
 	  _fadeTypeLayout(new QHBoxLayout),
+	  _fadeCurveLayout(new QHBoxLayout),
 	  _fadeOptionsLayout(new QVBoxLayout)
 {
 	_syncOffset->setMinimum(-950);
@@ -346,6 +310,7 @@ MacroActionAudioEdit::MacroActionAudioEdit(
 	sources.sort();
 	_sources->SetSourceNameList(sources);
 	populateFadeTypeSelection(_fadeTypes);
+	populateFadeCurveSelection(_fadeCurves);
 	PopulateMonitorTypeSelection(_monitorTypes);
 
 	QWidget::connect(_actions, SIGNAL(currentIndexChanged(int)), this,
@@ -381,6 +346,8 @@ MacroActionAudioEdit::MacroActionAudioEdit(
 			 SLOT(AbortActiveFadeChanged(int)));
 	QWidget::connect(_fadeTypes, SIGNAL(currentIndexChanged(int)), this,
 			 SLOT(FadeTypeChanged(int)));
+	QWidget::connect(_fadeCurves, SIGNAL(currentIndexChanged(int)), this,
+			 SLOT(FadeCurveChanged(int)));
 
 	std::unordered_map<std::string, QWidget *> widgetPlaceholders = {
 		{"{{audioSources}}", _sources},
@@ -404,7 +371,12 @@ MacroActionAudioEdit::MacroActionAudioEdit(
 		obs_module_text("AdvSceneSwitcher.action.audio.fade.duration"),
 		_fadeTypeLayout, widgetPlaceholders);
 
+	PlaceWidgets(
+		obs_module_text("AdvSceneSwitcher.action.audio.fade.curve"),
+		_fadeCurveLayout, {{"{{fadeCurves}}", _fadeCurves}});
+
 	_fadeOptionsLayout->addLayout(_fadeTypeLayout);
+	_fadeOptionsLayout->addLayout(_fadeCurveLayout);
 	_fadeOptionsLayout->addWidget(_abortActiveFade);
 	_fadeOptionsLayout->addWidget(_wait);
 
@@ -468,6 +440,9 @@ void MacroActionAudioEdit::SetWidgetVisibility()
 			 hasVolumeControl(_entryData->_action));
 	SetLayoutVisible(_fadeOptionsLayout,
 			 hasVolumeControl(_entryData->_action));
+	SetLayoutVisible(_fadeCurveLayout,
+			 hasVolumeControl(_entryData->_action) &&
+				 _entryData->_fade);
 	_abortActiveFade->setVisible(hasVolumeControl(_entryData->_action) &&
 				     _entryData->_fade);
 	_wait->setVisible(hasVolumeControl(_entryData->_action) &&
@@ -496,6 +471,7 @@ void MacroActionAudioEdit::UpdateEntryData()
 	_wait->setChecked(_entryData->_wait);
 	_abortActiveFade->setChecked(_entryData->_abortActiveFade);
 	_fadeTypes->setCurrentIndex(static_cast<int>(_entryData->_fadeType));
+	_fadeCurves->setCurrentIndex(static_cast<int>(_entryData->_fadeCurve));
 	SetWidgetVisibility();
 }
 
@@ -625,4 +601,14 @@ void MacroActionAudioEdit::FadeTypeChanged(int value)
 	SetWidgetVisibility();
 }
 
+void MacroActionAudioEdit::FadeCurveChanged(int value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_fadeCurve = static_cast<FadeCurve>(value);
+}
+
 } // namespace advss
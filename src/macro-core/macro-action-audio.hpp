@@ -1,5 +1,6 @@
 #pragma once
 #include "macro-action-edit.hpp"
+#include "audio-fade.hpp"
 #include "duration-control.hpp"
 #include "slider-spinbox.hpp"
 #include "source-selection.hpp"
@@ -51,17 +52,16 @@ public:
 	bool _fade = false;
 	Duration _duration;
 	NumberVariable<double> _rate = 100.;
+	FadeCurve _fadeCurve = FadeCurve::LINEAR;
 	bool _wait = false;
 	bool _abortActiveFade = false;
 
 private:
 	void StartFade();
-	void FadeVolume();
+	OBSWeakSource GetFadeSource() const;
+	std::chrono::milliseconds GetFadeDuration(float volume) const;
 	void SetVolume(float vol);
 	float GetVolume();
-	void SetFadeActive(bool value);
-	bool FadeActive();
-	std::atomic_int *GetFadeIdPtr();
 
 	static bool _registered;
 	static const std::string id;
@@ -96,6 +96,7 @@ private slots:
 	void WaitChanged(int value);
 	void AbortActiveFadeChanged(int value);
 	void FadeTypeChanged(int value);
+	void FadeCurveChanged(int value);
 signals:
 	void HeaderInfoChanged(const QString &);
 
@@ -103,6 +104,7 @@ protected:
 	SourceSelectionWidget *_sources;
 	QComboBox *_actions;
 	QComboBox *_fadeTypes;
+	QComboBox *_fadeCurves;
 	VariableSpinBox *_syncOffset;
 	QComboBox *_monitorTypes;
 	SliderSpinBox *_balance;
@@ -113,6 +115,7 @@ protected:
 	QCheckBox *_wait;
 	QCheckBox *_abortActiveFade;
 	QHBoxLayout *_fadeTypeLayout;
+	QHBoxLayout *_fadeCurveLayout;
 	QVBoxLayout *_fadeOptionsLayout;
 	std::shared_ptr<MacroActionAudio> _entryData;
 
@@ -1,7 +1,7 @@
 #include "macro-action-http.hpp"
 #include "switcher-data.hpp"
 #include "utility.hpp"
-#include "curl-helper.hpp"
+#include "http-client.hpp"
 
 namespace advss {
 
@@ -18,77 +18,44 @@ const static std::map<MacroActionHttp::Method, std::string> methods = {
 	 "AdvSceneSwitcher.action.http.type.post"},
 };
 
-static size_t DropCB(void *, size_t size, size_t nmemb, std::string *)
-{
-	return size * nmemb;
-}
-
-static size_t WriteCB(void *ptr, size_t size, size_t nmemb, std::string *buffer)
-{
-	buffer->append((char *)ptr, nmemb);
-	return size * nmemb;
-}
-
-void MacroActionHttp::SetupHeaders()
-{
-	if (!_setHeaders) {
-		return;
-	}
-	struct curl_slist *headers = nullptr;
-	for (auto &header : _headers) {
-		headers = switcher->curl.SlistAppend(headers, header.c_str());
-	}
-	if (!_headers.empty()) {
-		switcher->curl.SetOpt(CURLOPT_HTTPHEADER, headers);
-	}
-}
-
-void MacroActionHttp::Get()
-{
-	switcher->curl.SetOpt(CURLOPT_URL, _url.c_str());
-	switcher->curl.SetOpt(CURLOPT_HTTPGET, 1L);
-	switcher->curl.SetOpt(CURLOPT_TIMEOUT_MS, _timeout.Milliseconds());
-	SetupHeaders();
-
-	std::string response;
-	if (IsReferencedInVars()) {
-		switcher->curl.SetOpt(CURLOPT_WRITEFUNCTION, WriteCB);
-	} else {
-		switcher->curl.SetOpt(CURLOPT_WRITEFUNCTION, DropCB);
-	}
-	switcher->curl.SetOpt(CURLOPT_WRITEDATA, &response);
-	switcher->curl.Perform();
-
-	SetVariableValue(response);
-}
-
-void MacroActionHttp::Post()
-{
-	switcher->curl.SetOpt(CURLOPT_URL, _url.c_str());
-	switcher->curl.SetOpt(CURLOPT_POSTFIELDS, _data.c_str());
-	switcher->curl.SetOpt(CURLOPT_TIMEOUT_MS, _timeout.Milliseconds());
-	SetupHeaders();
-	switcher->curl.Perform();
-}
-
 bool MacroActionHttp::PerformAction()
 {
-	if (!switcher->curl.Initialized()) {
+	if (!HttpClientAvailable()) {
 		blog(LOG_WARNING,
 		     "cannot perform http action (curl not found)");
 		return true;
 	}
 
+	HttpRequest request;
+	request.url = _url.c_str();
+	request.timeout = std::chrono::milliseconds(
+		(int64_t)_timeout.Milliseconds());
+	if (_setHeaders) {
+		for (const auto &header : _headers) {
+			request.headers.emplace_back(header.c_str());
+		}
+	}
 	switch (_method) {
 	case MacroActionHttp::Method::GET:
-		Get();
+		request.method = HttpRequest::Method::GET;
 		break;
 	case MacroActionHttp::Method::POST:
-		Post();
+		request.method = HttpRequest::Method::POST;
+		request.body = _data.c_str();
 		break;
 	default:
 		break;
 	}
+
+	// Only wait for the response if it is used by a variable, as the
+	// following actions might rely on it
+	const bool waitForResponse = _method == Method::GET &&
+				     IsReferencedInVars();
+	request.keepResponseBody = waitForResponse;
+	auto response = SubmitHttpRequest(request);
+	if (waitForResponse) {
+		SetVariableValue(response.get().body);
+	}
 	return true;
 }
 
@@ -38,10 +38,6 @@ public:
 	Duration _timeout = Duration(1.0);
 
 private:
-	void SetupHeaders();
-	void Get();
-	void Post();
-
 	static bool _registered;
 	static const std::string id;
 };
@@ -1,7 +1,10 @@
 #include "macro-condition-audio.hpp"
 #include "macro.hpp"
+#include "switcher-data.hpp"
 #include "utility.hpp"
 
+#include <limits>
+
 namespace advss {
 
 constexpr int64_t nsPerMs = 1000000;
@@ -33,6 +36,18 @@ const static std::map<MacroConditionAudio::OutputCondition, std::string>
 		 "AdvSceneSwitcher.condition.audio.state.below"},
 };
 
+const static std::map<MacroConditionAudio::OutputMeasure, std::string>
+	outputMeasures = {
+		{MacroConditionAudio::OutputMeasure::PEAK,
+		 "AdvSceneSwitcher.condition.audio.measure.peak"},
+		{MacroConditionAudio::OutputMeasure::RMS,
+		 "AdvSceneSwitcher.condition.audio.measure.rms"},
+		{MacroConditionAudio::OutputMeasure::PERCENTILE,
+		 "AdvSceneSwitcher.condition.audio.measure.percentile"},
+		{MacroConditionAudio::OutputMeasure::TIME,
+		 "AdvSceneSwitcher.condition.audio.measure.time"},
+};
+
 const static std::map<MacroConditionAudio::VolumeCondition, std::string>
 	audioVolumeConditionTypes = {
 		{MacroConditionAudio::VolumeCondition::ABOVE,
@@ -47,18 +62,95 @@ const static std::map<MacroConditionAudio::VolumeCondition, std::string>
 		 "AdvSceneSwitcher.condition.audio.state.unmute"},
 };
 
-MacroConditionAudio::~MacroConditionAudio()
+// Small changes of the level around the threshold should not cause the
+// macros to be checked again and again
+constexpr float thresholdHysteresisDb = 3.f;
+
+// Maps the level in dB to the volume scale used by the condition
+static double dbToVolume(float db)
+{
+	return ((double)db + 60) * 1.7;
+}
+
+static float volumeToDb(double volume)
+{
+	return (float)(volume / 1.7 - 60);
+}
+
+bool MacroConditionAudio::CheckOutputTime(std::chrono::milliseconds window)
+{
+	const auto timeAbove =
+		_volmeter->GetTimeAbove(window, volumeToDb(_volume));
+	const auto time = _outputCondition == OutputCondition::ABOVE
+				  ? timeAbove
+				  : window - timeAbove;
+	SetVariableValue(std::to_string(time.count() / 1000.0));
+	return time.count() >= _minTime.Milliseconds();
+}
+
+void MacroConditionAudio::WatchThreshold(std::chrono::milliseconds window)
 {
-	obs_volmeter_remove_callback(_volmeter, SetVolumeLevel, this);
-	obs_volmeter_destroy(_volmeter);
+	static const std::map<OutputMeasure, LevelWatch::Measure> measures = {
+		{OutputMeasure::PEAK, LevelWatch::Measure::PEAK},
+		{OutputMeasure::RMS, LevelWatch::Measure::RMS},
+		{OutputMeasure::PERCENTILE, LevelWatch::Measure::PERCENTILE},
+		{OutputMeasure::TIME, LevelWatch::Measure::TIME_ABOVE},
+	};
+	auto measure = measures.find(_outputMeasure);
+	if (measure == measures.end()) {
+		_volmeter->StopWatchingThreshold();
+		return;
+	}
+
+	LevelWatch watch;
+	watch.measure = measure->second;
+	watch.window = window;
+	watch.threshold = volumeToDb(_volume);
+	watch.hysteresis = thresholdHysteresisDb;
+	watch.percentile = _percentile;
+	// The time below the threshold is the remainder of the window
+	const auto minTime =
+		std::chrono::milliseconds((int64_t)_minTime.Milliseconds());
+	watch.minTime = _outputCondition == OutputCondition::ABOVE
+				? minTime
+				: window - minTime;
+	_volmeter->WatchThreshold(watch);
 }
 
 bool MacroConditionAudio::CheckOutputCondition()
 {
-	bool ret = false;
-	auto s = obs_weak_source_get_source(_audioSource.GetSource());
+	if (_audioSource.GetType() == SourceSelection::Type::VARIABLE) {
+		UpdateVolmeter();
+	}
+	if (!_volmeter) {
+		return false;
+	}
 
-	double curVolume = ((double)_peak + 60) * 1.7;
+	// The levels are evaluated over a fixed time window, so the result
+	// does not depend on how often the condition is checked
+	const auto window = std::min<std::chrono::milliseconds>(
+		std::chrono::milliseconds((int64_t)_window.Milliseconds()),
+		maxLevelWindow);
+	WatchThreshold(window);
+	float level = -std::numeric_limits<float>::infinity();
+	switch (_outputMeasure) {
+	case OutputMeasure::PEAK:
+		level = _volmeter->GetPeak(window);
+		break;
+	case OutputMeasure::RMS:
+		level = _volmeter->GetRMS(window);
+		break;
+	case OutputMeasure::PERCENTILE:
+		level = _volmeter->GetPercentile(window, _percentile);
+		break;
+	case OutputMeasure::TIME:
+		return CheckOutputTime(window);
+	default:
+		break;
+	}
+
+	bool ret = false;
+	double curVolume = dbToVolume(level);
 
 	switch (_outputCondition) {
 	case OutputCondition::ABOVE:
@@ -74,14 +166,6 @@ bool MacroConditionAudio::CheckOutputCondition()
 	}
 
 	SetVariableValue(std::to_string(curVolume));
-
-	// Reset for next check
-	_peak = -std::numeric_limits<float>::infinity();
-	obs_source_release(s);
-	if (_audioSource.GetType() == SourceSelection::Type::VARIABLE) {
-		ResetVolmeter();
-	}
-
 	return ret;
 }
 
@@ -176,6 +260,10 @@ bool MacroConditionAudio::CheckBalance()
 
 bool MacroConditionAudio::CheckCondition()
 {
+	if (_checkType != Type::OUTPUT_VOLUME && _volmeter) {
+		_volmeter->StopWatchingThreshold();
+	}
+
 	bool ret = false;
 	switch (_checkType) {
 	case Type::OUTPUT_VOLUME:
@@ -215,27 +303,15 @@ bool MacroConditionAudio::Save(obs_data_t *obj) const
 			 static_cast<int>(_outputCondition));
 	obs_data_set_int(obj, "volumeCondition",
 			 static_cast<int>(_volumeCondition));
+	obs_data_set_int(obj, "outputMeasure",
+			 static_cast<int>(_outputMeasure));
+	_window.Save(obj, "window");
+	_percentile.Save(obj, "percentile");
+	_minTime.Save(obj, "minTime");
 	obs_data_set_int(obj, "version", 1);
 	return true;
 }
 
-obs_volmeter_t *AddVolmeterToSource(MacroConditionAudio *entry,
-				    obs_weak_source *source)
-{
-	obs_volmeter_t *volmeter = obs_volmeter_create(OBS_FADER_LOG);
-	obs_volmeter_add_callback(volmeter, MacroConditionAudio::SetVolumeLevel,
-				  entry);
-	obs_source_t *as = obs_weak_source_get_source(source);
-	if (!obs_volmeter_attach_source(volmeter, as)) {
-		const char *name = obs_source_get_name(as);
-		blog(LOG_WARNING, "failed to attach volmeter to source %s",
-		     name);
-	}
-	obs_source_release(as);
-
-	return volmeter;
-}
-
 bool MacroConditionAudio::Load(obs_data_t *obj)
 {
 	MacroCondition::Load(obj);
@@ -256,7 +332,17 @@ bool MacroConditionAudio::Load(obs_data_t *obj)
 		obs_data_get_int(obj, "outputCondition"));
 	_volumeCondition = static_cast<VolumeCondition>(
 		obs_data_get_int(obj, "volumeCondition"));
-	_volmeter = AddVolmeterToSource(this, _audioSource.GetSource());
+	_outputMeasure = static_cast<OutputMeasure>(
+		obs_data_get_int(obj, "outputMeasure"));
+	if (obs_data_has_user_value(obj, "window")) {
+		_window.Load(obj, "window");
+		_percentile.Load(obj, "percentile");
+		_minTime.Load(obj, "minTime");
+	} else {
+		// Previously only the peak since the last check was considered
+		_window = GetSwitcher()->interval / 1000.0;
+	}
+	UpdateVolmeter();
 	return true;
 }
 
@@ -265,29 +351,20 @@ std::string MacroConditionAudio::GetShortDesc() const
 	return _audioSource.ToString();
 }
 
-void MacroConditionAudio::SetVolumeLevel(void *data, const float *,
-					 const float peak[MAX_AUDIO_CHANNELS],
-					 const float *)
+void MacroConditionAudio::UpdateVolmeter()
 {
-	MacroConditionAudio *c = static_cast<MacroConditionAudio *>(data);
-	const auto macro = c->GetMacro();
-	if (macro && macro->Paused()) {
+	const auto source = _audioSource.GetSource();
+	if (_volmeter && _volmeter->UsesSource(source)) {
 		return;
 	}
-
-	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
-		if (peak[i] > c->_peak) {
-			c->_peak = peak[i];
-		}
-	}
-}
-
-void MacroConditionAudio::ResetVolmeter()
-{
-	obs_volmeter_remove_callback(_volmeter, SetVolumeLevel, this);
-	obs_volmeter_destroy(_volmeter);
-
-	_volmeter = AddVolmeterToSource(this, _audioSource.GetSource());
+	// Check the macros right away if the level crosses the threshold
+	// instead of waiting for the next interval
+	_volmeter = std::make_unique<VolmeterSubscription>(
+		source, []() {
+			if (switcher) {
+				switcher->RequestMacroCheck();
+			}
+		});
 }
 
 static inline void populateCheckTypes(QComboBox *list)
@@ -314,6 +391,13 @@ static inline void populateOutputConditionSelection(QComboBox *list)
 	}
 }
 
+static inline void populateOutputMeasureSelection(QComboBox *list)
+{
+	for (const auto &[_, name] : outputMeasures) {
+		list->addItem(obs_module_text(name.c_str()));
+	}
+}
+
 static inline void populateVolumeConditionSelection(QComboBox *list)
 {
 	list->clear();
@@ -331,7 +415,13 @@ MacroConditionAudioEdit::MacroConditionAudioEdit(
 	  _volume(new VariableSpinBox()),
 	  _syncOffset(new VariableSpinBox()),
 	  _monitorTypes(new QComboBox),
-	  _balance(new SliderSpinBox(0., 1., ""))
+	  _balance(new SliderSpinBox(0., 1., "")),
+	  _outputMeasure(new QComboBox()),
+	  _percentile(new VariableDoubleSpinBox()),
+	  _window(new DurationSelection(this, false)),
+	  _minTime(new DurationSelection(this, false)),
+	  _outputMeasureLayout(new QHBoxLayout()),
+	  _minTimeLayout(new QHBoxLayout())
 {
 	_volume->setSuffix("%");
 	_volume->setMaximum(100);
@@ -341,6 +431,12 @@ MacroConditionAudioEdit::MacroConditionAudioEdit(
 	_syncOffset->setMaximum(20000);
 	_syncOffset->setSuffix("ms");
 
+	_percentile->setMinimum(0.);
+	_percentile->setMaximum(100.);
+	_percentile->setSuffix("%");
+	_window->SpinBox()->setMaximum(
+		std::chrono::duration<double>(maxLevelWindow).count());
+
 	auto sources = GetAudioSourceNames();
 	sources.sort();
 	_sources->SetSourceNameList(sources);
@@ -364,12 +460,23 @@ MacroConditionAudioEdit::MacroConditionAudioEdit(
 		this, SLOT(BalanceChanged(const NumberVariable<double> &)));
 	QWidget::connect(_condition, SIGNAL(currentIndexChanged(int)), this,
 			 SLOT(ConditionChanged(int)));
+	QWidget::connect(_outputMeasure, SIGNAL(currentIndexChanged(int)),
+			 this, SLOT(OutputMeasureChanged(int)));
+	QWidget::connect(_window, SIGNAL(DurationChanged(const Duration &)),
+			 this, SLOT(WindowChanged(const Duration &)));
+	QWidget::connect(
+		_percentile,
+		SIGNAL(NumberVariableChanged(const NumberVariable<double> &)),
+		this, SLOT(PercentileChanged(const NumberVariable<double> &)));
+	QWidget::connect(_minTime, SIGNAL(DurationChanged(const Duration &)),
+			 this, SLOT(MinTimeChanged(const Duration &)));
 	QWidget::connect(_sources,
 			 SIGNAL(SourceChanged(const SourceSelection &)), this,
 			 SLOT(SourceChanged(const SourceSelection &)));
 
 	populateCheckTypes(_checkTypes);
 	PopulateMonitorTypeSelection(_monitorTypes);
+	populateOutputMeasureSelection(_outputMeasure);
 
 	QHBoxLayout *switchLayout = new QHBoxLayout;
 	std::unordered_map<std::string, QWidget *> widgetPlaceholders = {
@@ -384,8 +491,20 @@ MacroConditionAudioEdit::MacroConditionAudioEdit(
 	PlaceWidgets(obs_module_text("AdvSceneSwitcher.condition.audio.entry"),
 		     switchLayout, widgetPlaceholders);
 
+	PlaceWidgets(obs_module_text(
+			     "AdvSceneSwitcher.condition.audio.entry.measure"),
+		     _outputMeasureLayout,
+		     {{"{{outputMeasure}}", _outputMeasure},
+		      {"{{percentile}}", _percentile},
+		      {"{{window}}", _window}});
+	PlaceWidgets(obs_module_text(
+			     "AdvSceneSwitcher.condition.audio.entry.minTime"),
+		     _minTimeLayout, {{"{{minTime}}", _minTime}});
+
 	QVBoxLayout *mainLayout = new QVBoxLayout;
 	mainLayout->addLayout(switchLayout);
+	mainLayout->addLayout(_outputMeasureLayout);
+	mainLayout->addLayout(_minTimeLayout);
 	mainLayout->addWidget(_balance);
 	setLayout(mainLayout);
 
@@ -423,7 +542,7 @@ void MacroConditionAudioEdit::SourceChanged(const SourceSelection &source)
 	{
 		auto lock = LockContext();
 		_entryData->_audioSource = source;
-		_entryData->ResetVolmeter();
+		_entryData->UpdateVolmeter();
 	}
 	UpdateVolmeterSource();
 	SetWidgetVisibility();
@@ -472,6 +591,49 @@ void MacroConditionAudioEdit::BalanceChanged(const NumberVariable<double> &value
 	_entryData->_balance = value;
 }
 
+void MacroConditionAudioEdit::OutputMeasureChanged(int value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_outputMeasure =
+		static_cast<MacroConditionAudio::OutputMeasure>(value);
+	SetWidgetVisibility();
+}
+
+void MacroConditionAudioEdit::WindowChanged(const Duration &dur)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_window = dur;
+}
+
+void MacroConditionAudioEdit::PercentileChanged(
+	const NumberVariable<double> &value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_percentile = value;
+}
+
+void MacroConditionAudioEdit::MinTimeChanged(const Duration &dur)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_minTime = dur;
+}
+
 void MacroConditionAudioEdit::ConditionChanged(int cond)
 {
 	if (_loading || !_entryData) {
@@ -526,6 +688,11 @@ void MacroConditionAudioEdit::UpdateEntryData()
 	_syncOffset->SetValue(_entryData->_syncOffset);
 	_monitorTypes->setCurrentIndex(_entryData->_monitorType);
 	_balance->SetDoubleValue(_entryData->_balance);
+	_outputMeasure->setCurrentIndex(
+		static_cast<int>(_entryData->_outputMeasure));
+	_window->SetDuration(_entryData->_window);
+	_percentile->SetValue(_entryData->_percentile);
+	_minTime->SetDuration(_entryData->_minTime);
 	_checkTypes->setCurrentIndex(_checkTypes->findData(
 		static_cast<int>(_entryData->_checkType)));
 
@@ -580,6 +747,16 @@ void MacroConditionAudioEdit::SetWidgetVisibility()
 			     MacroConditionAudio::Type::BALANCE);
 	_volMeter->setVisible(_entryData->_checkType ==
 			      MacroConditionAudio::Type::OUTPUT_VOLUME);
+	const bool isOutputVolume = _entryData->_checkType ==
+				    MacroConditionAudio::Type::OUTPUT_VOLUME;
+	const auto measure = _entryData->_outputMeasure;
+	const bool showPercentile =
+		measure == MacroConditionAudio::OutputMeasure::PERCENTILE;
+	const bool showMinTime =
+		measure == MacroConditionAudio::OutputMeasure::TIME;
+	SetLayoutVisible(_outputMeasureLayout, isOutputVolume);
+	_percentile->setVisible(isOutputVolume && showPercentile);
+	SetLayoutVisible(_minTimeLayout, isOutputVolume && showMinTime);
 	adjustSize();
 }
 
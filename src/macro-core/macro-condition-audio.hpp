@@ -1,10 +1,12 @@
 #pragma once
 #include "macro-condition-edit.hpp"
 #include "volume-control.hpp"
+#include "volmeter-registry.hpp"
 #include "slider-spinbox.hpp"
 #include "source-selection.hpp"
+#include "duration-control.hpp"
+#include "variable-spinbox.hpp"
 
-#include <limits>
 #include <QWidget>
 #include <QComboBox>
 #include <chrono>
@@ -14,7 +16,6 @@ namespace advss {
 class MacroConditionAudio : public MacroCondition {
 public:
 	MacroConditionAudio(Macro *m) : MacroCondition(m, true) {}
-	~MacroConditionAudio();
 	bool CheckCondition();
 	bool Save(obs_data_t *obj) const;
 	bool Load(obs_data_t *obj);
@@ -24,11 +25,8 @@ public:
 	{
 		return std::make_shared<MacroConditionAudio>(m);
 	}
-	static void SetVolumeLevel(void *data,
-				   const float magnitude[MAX_AUDIO_CHANNELS],
-				   const float peak[MAX_AUDIO_CHANNELS],
-				   const float inputPeak[MAX_AUDIO_CHANNELS]);
-	void ResetVolmeter();
+	// Subscribes to the volmeter of the currently selected source
+	void UpdateVolmeter();
 
 	enum class Type {
 		OUTPUT_VOLUME,
@@ -43,6 +41,14 @@ public:
 		BELOW,
 	};
 
+	// How the output volume levels within the window are evaluated
+	enum class OutputMeasure {
+		PEAK,
+		RMS,
+		PERCENTILE,
+		TIME,
+	};
+
 	enum class VolumeCondition {
 		ABOVE,
 		EXACT,
@@ -59,16 +65,21 @@ public:
 	Type _checkType = Type::OUTPUT_VOLUME;
 	OutputCondition _outputCondition = OutputCondition::ABOVE;
 	VolumeCondition _volumeCondition = VolumeCondition::ABOVE;
-	obs_volmeter_t *_volmeter = nullptr;
+	OutputMeasure _outputMeasure = OutputMeasure::PEAK;
+	Duration _window = 1.0;
+	NumberVariable<double> _percentile = 95.;
+	Duration _minTime = 0.5;
 
 private:
 	bool CheckOutputCondition();
+	void WatchThreshold(std::chrono::milliseconds window);
+	bool CheckOutputTime(std::chrono::milliseconds window);
 	bool CheckVolumeCondition();
 	bool CheckSyncOffset();
 	bool CheckMonitor();
 	bool CheckBalance();
 
-	float _peak = -std::numeric_limits<float>::infinity();
+	std::unique_ptr<VolmeterSubscription> _volmeter;
 	static bool _registered;
 	static const std::string id;
 };
@@ -98,6 +109,10 @@ private slots:
 	void SyncOffsetChanged(const NumberVariable<int> &value);
 	void MonitorTypeChanged(int value);
 	void BalanceChanged(const NumberVariable<double> &value);
+	void OutputMeasureChanged(int value);
+	void WindowChanged(const Duration &);
+	void PercentileChanged(const NumberVariable<double> &);
+	void MinTimeChanged(const Duration &);
 
 signals:
 	void HeaderInfoChanged(const QString &);
@@ -110,6 +125,12 @@ protected:
 	VariableSpinBox *_syncOffset;
 	QComboBox *_monitorTypes;
 	SliderSpinBox *_balance;
+	QComboBox *_outputMeasure;
+	VariableDoubleSpinBox *_percentile;
+	DurationSelection *_window;
+	DurationSelection *_minTime;
+	QHBoxLayout *_outputMeasureLayout;
+	QHBoxLayout *_minTimeLayout;
 	VolControl *_volMeter = nullptr;
 	std::shared_ptr<MacroConditionAudio> _entryData;
 
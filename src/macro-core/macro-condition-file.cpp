@@ -1,7 +1,6 @@
 #include "macro-condition-file.hpp"
 #include "utility.hpp"
 #include "switcher-data.hpp"
-#include "curl-helper.hpp"
 
 #include <QTextStream>
 #include <QFileDialog>
@@ -18,27 +17,20 @@ bool MacroConditionFile::_registered = MacroConditionFactory::Register(
 
 static std::hash<std::string> strHash;
 
-static size_t WriteCallback(void *contents, size_t size, size_t nmemb,
-			    void *userp)
+// The remote file is polled in the background, so checking the condition only
+// has to look at the most recently downloaded content
+std::shared_ptr<const RemoteFileContent> MacroConditionFile::GetRemoteContent()
 {
-	((std::string *)userp)->append((char *)contents, size * nmemb);
-	return size * nmemb;
-}
-
-static std::string getRemoteData(std::string &url)
-{
-	std::string readBuffer;
-	switcher->curl.SetOpt(CURLOPT_URL, url.c_str());
-	switcher->curl.SetOpt(CURLOPT_WRITEFUNCTION, WriteCallback);
-	switcher->curl.SetOpt(CURLOPT_WRITEDATA, &readBuffer);
-	// Set timeout to at least one second
-	int timeout = switcher->interval / 1000;
-	if (timeout == 0) {
-		timeout = 1;
+	const std::string url = _file;
+	const std::chrono::milliseconds period(
+		(int64_t)_pollInterval.Milliseconds());
+	if (!_remoteFile || !_remoteFile->UsesURL(url)) {
+		_remoteFile =
+			std::make_unique<RemoteFileSubscription>(url, period);
+	} else {
+		_remoteFile->SetPeriod(period);
 	}
-	switcher->curl.SetOpt(CURLOPT_TIMEOUT, 1);
-	switcher->curl.Perform();
-	return readBuffer;
+	return _remoteFile->GetContent();
 }
 
 bool MacroConditionFile::MatchFileContent(QString &filedata)
@@ -66,10 +58,12 @@ bool MacroConditionFile::MatchFileContent(QString &filedata)
 
 bool MacroConditionFile::CheckRemoteFileContent()
 {
-	std::string path = _file;
-	std::string data = getRemoteData(path);
-	SetVariableValue(data);
-	QString qdata = QString::fromStdString(data);
+	auto content = GetRemoteContent();
+	if (!content) {
+		return false;
+	}
+	SetVariableValue(content->data);
+	QString qdata = QString::fromStdString(content->data);
 	return MatchFileContent(qdata);
 }
 
@@ -110,10 +104,15 @@ bool MacroConditionFile::CheckChangeContent()
 		file.close();
 	} break;
 	case FileType::REMOTE: {
-		std::string path = _file;
-		std::string data = getRemoteData(path);
-		QString filedata = QString::fromStdString(data);
-	} break;
+		// The hash is already calculated when the file is downloaded
+		auto content = GetRemoteContent();
+		if (!content) {
+			return false;
+		}
+		const bool contentChanged = content->hash != _lastHash;
+		_lastHash = content->hash;
+		return contentChanged;
+	}
 	default:
 		break;
 	}
@@ -127,7 +126,16 @@ bool MacroConditionFile::CheckChangeContent()
 bool MacroConditionFile::CheckChangeDate()
 {
 	if (_fileType == FileType::REMOTE) {
-		return false;
+		// Only available if the server sends the Last-Modified header
+		auto content = GetRemoteContent();
+		if (!content || content->lastModified.empty()) {
+			return false;
+		}
+		const auto &lastMod = content->lastModified;
+		SetVariableValue(lastMod);
+		const bool dateChanged = _lastRemoteMod != lastMod;
+		_lastRemoteMod = lastMod;
+		return dateChanged;
 	}
 
 	QFile file(QString::fromStdString(_file));
@@ -176,6 +184,7 @@ bool MacroConditionFile::Save(obs_data_t *obj) const
 	obs_data_set_int(obj, "condition", static_cast<int>(_condition));
 	obs_data_set_bool(obj, "useTime", _useTime);
 	obs_data_set_bool(obj, "onlyMatchIfChanged", _onlyMatchIfChanged);
+	_pollInterval.Save(obj, "pollInterval");
 	return true;
 }
 
@@ -195,6 +204,12 @@ bool MacroConditionFile::Load(obs_data_t *obj)
 		static_cast<ConditionType>(obs_data_get_int(obj, "condition"));
 	_useTime = obs_data_get_bool(obj, "useTime");
 	_onlyMatchIfChanged = obs_data_get_bool(obj, "onlyMatchIfChanged");
+	if (obs_data_has_user_value(obj, "pollInterval")) {
+		_pollInterval.Load(obj, "pollInterval");
+	} else {
+		// Remote files used to be downloaded on every check
+		_pollInterval = switcher->interval / 1000.0;
+	}
 	return true;
 }
 
@@ -230,8 +245,10 @@ MacroConditionFileEdit::MacroConditionFileEdit(
 	  _regex(new RegexConfigWidget(parent)),
 	  _checkModificationDate(new QCheckBox(obs_module_text(
 		  "AdvSceneSwitcher.fileTab.checkfileContentTime"))),
-	  _checkFileContent(new QCheckBox(
-		  obs_module_text("AdvSceneSwitcher.fileTab.checkfileContent")))
+	  _checkFileContent(new QCheckBox(obs_module_text(
+		  "AdvSceneSwitcher.fileTab.checkfileContent"))),
+	  _pollInterval(new DurationSelection(this, false)),
+	  _pollIntervalLayout(new QHBoxLayout())
 {
 	populateFileTypes(_fileTypes);
 	populateConditions(_conditions);
@@ -250,6 +267,9 @@ MacroConditionFileEdit::MacroConditionFileEdit(
 			 this, SLOT(CheckModificationDateChanged(int)));
 	QWidget::connect(_checkFileContent, SIGNAL(stateChanged(int)), this,
 			 SLOT(OnlyMatchIfChangedChanged(int)));
+	QWidget::connect(_pollInterval,
+			 SIGNAL(DurationChanged(const Duration &)), this,
+			 SLOT(PollIntervalChanged(const Duration &)));
 
 	std::unordered_map<std::string, QWidget *> widgetPlaceholders = {
 		{"{{fileType}}", _fileTypes},
@@ -259,6 +279,7 @@ MacroConditionFileEdit::MacroConditionFileEdit(
 		{"{{useRegex}}", _regex},
 		{"{{checkModificationDate}}", _checkModificationDate},
 		{"{{checkFileContent}}", _checkFileContent},
+		{"{{pollInterval}}", _pollInterval},
 	};
 
 	QVBoxLayout *mainLayout = new QVBoxLayout;
@@ -277,9 +298,14 @@ MacroConditionFileEdit::MacroConditionFileEdit(
 	PlaceWidgets(
 		obs_module_text("AdvSceneSwitcher.condition.file.entry.line3"),
 		line3Layout, widgetPlaceholders);
+	PlaceWidgets(
+		obs_module_text(
+			"AdvSceneSwitcher.condition.file.entry.pollInterval"),
+		_pollIntervalLayout, widgetPlaceholders);
 	mainLayout->addLayout(line1Layout);
 	mainLayout->addLayout(line2Layout);
 	mainLayout->addLayout(line3Layout);
+	mainLayout->addLayout(_pollIntervalLayout);
 
 	setLayout(mainLayout);
 
@@ -301,6 +327,7 @@ void MacroConditionFileEdit::UpdateEntryData()
 	_regex->SetRegexConfig(_entryData->_regex);
 	_checkModificationDate->setChecked(_entryData->_useTime);
 	_checkFileContent->setChecked(_entryData->_onlyMatchIfChanged);
+	_pollInterval->SetDuration(_entryData->_pollInterval);
 
 	// TODO: Remove in future version
 	if (!_entryData->_useTime) {
@@ -332,6 +359,7 @@ void MacroConditionFileEdit::FileTypeChanged(int index)
 
 	auto lock = LockContext();
 	_entryData->_fileType = type;
+	SetWidgetVisibility();
 }
 
 void MacroConditionFileEdit::ConditionChanged(int index)
@@ -403,6 +431,16 @@ void MacroConditionFileEdit::OnlyMatchIfChangedChanged(int state)
 	_entryData->_onlyMatchIfChanged = state;
 }
 
+void MacroConditionFileEdit::PollIntervalChanged(const Duration &dur)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_pollInterval = dur;
+}
+
 void MacroConditionFileEdit::SetWidgetVisibility()
 {
 	if (!_entryData) {
@@ -421,6 +459,9 @@ void MacroConditionFileEdit::SetWidgetVisibility()
 		_entryData->_onlyMatchIfChanged &&
 		_entryData->_condition ==
 			MacroConditionFile::ConditionType::MATCH);
+	SetLayoutVisible(_pollIntervalLayout,
+			 _entryData->_fileType ==
+				 MacroConditionFile::FileType::REMOTE);
 	adjustSize();
 	updateGeometry();
 }
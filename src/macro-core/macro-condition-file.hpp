@@ -3,6 +3,8 @@
 #include "file-selection.hpp"
 #include "variable-text-edit.hpp"
 #include "regex-config.hpp"
+#include "duration-control.hpp"
+#include "remote-file-poller.hpp"
 
 #include <QWidget>
 #include <QComboBox>
@@ -42,6 +44,7 @@ public:
 	FileType _fileType = FileType::LOCAL;
 	ConditionType _condition = ConditionType::MATCH;
 	RegexConfig _regex;
+	Duration _pollInterval = 1.0;
 
 	// TODO: Remove in future version
 	bool _useTime = false;
@@ -53,9 +56,12 @@ private:
 	bool CheckLocalFileContent();
 	bool CheckChangeContent();
 	bool CheckChangeDate();
+	std::shared_ptr<const RemoteFileContent> GetRemoteContent();
 
 	QDateTime _lastMod;
+	std::string _lastRemoteMod;
 	size_t _lastHash = 0;
+	std::unique_ptr<RemoteFileSubscription> _remoteFile;
 	static bool _registered;
 	static const std::string id;
 };
@@ -84,6 +90,7 @@ private slots:
 	void RegexChanged(RegexConfig);
 	void CheckModificationDateChanged(int state);
 	void OnlyMatchIfChangedChanged(int state);
+	void PollIntervalChanged(const Duration &);
 signals:
 	void HeaderInfoChanged(const QString &);
 
@@ -95,6 +102,8 @@ protected:
 	RegexConfigWidget *_regex;
 	QCheckBox *_checkModificationDate;
 	QCheckBox *_checkFileContent;
+	DurationSelection *_pollInterval;
+	QHBoxLayout *_pollIntervalLayout;
 	std::shared_ptr<MacroConditionFile> _entryData;
 
 private:
@@ -21,55 +21,33 @@ const static std::map<MacroConditionWebsocket::Type, std::string>
 		 "AdvSceneSwitcher.condition.websocket.type.event"},
 };
 
-static bool matchRegex(const RegexConfig &conf, const std::string &msg,
-		       const std::string &expr)
-{
-	auto regex = conf.GetRegularExpression(expr);
-	if (!regex.isValid()) {
-		return false;
-	}
-	auto match = regex.match(QString::fromStdString(msg));
-	return match.hasMatch();
-}
-
 bool MacroConditionWebsocket::CheckCondition()
 {
-	const std::vector<std::string> *messages = nullptr;
+	MessageBuffer<std::string> *buffer = nullptr;
+	auto connection = _connection.lock();
 	switch (_type) {
 	case MacroConditionWebsocket::Type::REQUEST:
-		messages = &switcher->websocketMessages;
+		buffer = &GetWebsocketMessages();
 		break;
-	case MacroConditionWebsocket::Type::EVENT: {
-		auto connection = _connection.lock();
+	case MacroConditionWebsocket::Type::EVENT:
 		if (!connection) {
 			return false;
 		}
-		messages = &connection->Events();
+		buffer = &connection->Events();
 		break;
-	}
 	default:
 		break;
 	}
 
-	if (!messages) {
+	if (!buffer) {
 		return false;
 	}
 
-	for (const auto &msg : *messages) {
-		if (_regex.Enabled()) {
-			if (matchRegex(_regex, msg, _message)) {
-				SetVariableValue(msg);
-				return true;
-			}
-		} else {
-			if (msg == std::string(_message)) {
-				SetVariableValue(msg);
-				return true;
-			}
-		}
-	}
-	SetVariableValue("");
-	return false;
+	// Only the messages received since the last check are considered
+	const auto match =
+		_subscription.CheckForMatch(*buffer, _message, _regex);
+	SetVariableValue(match.value_or(""));
+	return match.has_value();
 }
 
 bool MacroConditionWebsocket::Save(obs_data_t *obj) const
@@ -1,6 +1,7 @@
 #pragma once
 #include "macro-condition-edit.hpp"
 #include "connection-manager.hpp"
+#include "message-dispatcher.hpp"
 #include "variable-text-edit.hpp"
 #include "regex-config.hpp"
 
@@ -32,6 +33,8 @@ public:
 	std::weak_ptr<Connection> _connection;
 
 private:
+	MessageSubscription _subscription;
+
 	static bool _registered;
 	static const std::string id;
 };
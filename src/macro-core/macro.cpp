@@ -5,6 +5,7 @@
 #include "macro-action-scene-switch.hpp"
 #include "switcher-data.hpp"
 #include "hotkey.hpp"
+#include "audio-fade.hpp"
 
 #include <limits>
 #undef max
@@ -347,6 +348,7 @@ void Macro::Stop()
 {
 	_stop = true;
 	switcher->macroWaitCv.notify_all();
+	CancelAudioFades(this);
 	for (auto &t : _helperThreads) {
 		if (t.joinable()) {
 			t.join();
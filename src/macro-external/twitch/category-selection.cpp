@@ -2,14 +2,19 @@
 #include "token.hpp"
 #include "twitch-helpers.hpp"
 
+#include <log-helper.hpp>
 #include <utility.hpp>
 #include <name-dialog.hpp>
 #include <obs-module-helper.hpp>
 #include <obs.hpp>
+#include <util/platform.h>
+#include <mutex>
 #include <QVBoxLayout>
 
 namespace advss {
 
+constexpr auto categoryCacheExpiry = std::chrono::hours(24 * 7);
+
 void TwitchCategory::Load(obs_data_t *obj)
 {
 	OBSDataAutoRelease data = obs_data_get_obj(obj, "category");
@@ -35,6 +40,10 @@ void TwitchCategorySelection::PopulateCategorySelection()
 		return;
 	}
 
+	if (CategoryGrabber::AllCategoriesFetched()) {
+		_fetchingCategoriesDone = true;
+	}
+
 	if (!_fetchingCategoriesDone && token) {
 		_categoryGrabber.Start(token);
 		if (_progressDialog->exec() == QDialog::Accepted) {
@@ -141,8 +150,101 @@ void TwitchCategorySelection::SelectionChanged(int index)
 }
 
 std::map<QString, int> CategoryGrabber::_categoryMap = {};
+bool CategoryGrabber::_allCategoriesFetched = false;
+int64_t CategoryGrabber::_cacheTimestamp = 0;
 std::mutex CategoryGrabber::_mtx = {};
 
+static std::string getCategoryCachePath()
+{
+	auto path = obs_module_config_path("twitch-categories.json");
+	if (!path) {
+		return "";
+	}
+	std::string result = path;
+	bfree(path);
+	return result;
+}
+
+static int64_t getTimestamp()
+{
+	return std::chrono::duration_cast<std::chrono::seconds>(
+		       std::chrono::system_clock::now().time_since_epoch())
+		.count();
+}
+
+void CategoryGrabber::LoadCache()
+{
+	static std::once_flag loaded;
+	std::call_once(loaded, []() {
+		const auto path = getCategoryCachePath();
+		OBSDataAutoRelease data = obs_data_create_from_json_file_safe(
+			path.c_str(), "bak");
+		if (!data) {
+			return;
+		}
+		const auto timestamp = obs_data_get_int(data, "timestamp");
+		const auto age =
+			std::chrono::seconds(getTimestamp() - timestamp);
+		if (age > categoryCacheExpiry) {
+			vblog(LOG_INFO,
+			      "ignoring expired twitch category cache");
+			return;
+		}
+
+		OBSDataArrayAutoRelease categories =
+			obs_data_get_array(data, "categories");
+		const size_t count = obs_data_array_count(categories);
+		for (size_t i = 0; i < count; i++) {
+			OBSDataAutoRelease category =
+				obs_data_array_item(categories, i);
+			_categoryMap.emplace(
+				obs_data_get_string(category, "name"),
+				obs_data_get_int(category, "id"));
+		}
+		_allCategoriesFetched = obs_data_get_bool(data, "complete");
+		_cacheTimestamp = timestamp;
+		vblog(LOG_INFO, "loaded %d twitch categories from cache",
+		      (int)count);
+	});
+}
+
+void CategoryGrabber::SaveCache()
+{
+	const auto path = getCategoryCachePath();
+	if (path.empty()) {
+		return;
+	}
+	auto dir = obs_module_config_path("");
+	os_mkdirs(dir);
+	bfree(dir);
+
+	OBSDataArrayAutoRelease categories = obs_data_array_create();
+	for (const auto &[name, id] : _categoryMap) {
+		OBSDataAutoRelease category = obs_data_create();
+		obs_data_set_string(category, "name",
+				    name.toStdString().c_str());
+		obs_data_set_int(category, "id", id);
+		obs_data_array_push_back(categories, category);
+	}
+	// Keep the original timestamp so the cache expires eventually
+	if (_cacheTimestamp == 0) {
+		_cacheTimestamp = getTimestamp();
+	}
+	OBSDataAutoRelease data = obs_data_create();
+	obs_data_set_int(data, "timestamp", _cacheTimestamp);
+	obs_data_set_bool(data, "complete", _allCategoriesFetched);
+	obs_data_set_array(data, "categories", categories);
+	obs_data_save_json_safe(data, path.c_str(), "tmp", "bak");
+}
+
+bool CategoryGrabber::AllCategoriesFetched()
+{
+	LoadCache();
+	const auto age =
+		std::chrono::seconds(getTimestamp() - _cacheTimestamp);
+	return _allCategoriesFetched && age <= categoryCacheExpiry;
+}
+
 void CategoryGrabber::Start(const std::shared_ptr<TwitchToken> &token,
 			    const std::string search)
 {
@@ -159,6 +261,7 @@ void CategoryGrabber::Stop()
 
 const std::map<QString, int> &CategoryGrabber::GetCategories()
 {
+	LoadCache();
 	return _categoryMap;
 }
 
@@ -171,11 +274,20 @@ void CategoryGrabber::run()
 
 	{
 		std::lock_guard<std::mutex> lock(_mtx);
+		LoadCache();
+		const auto previousCount = _categoryMap.size();
+		const bool wasComplete = _allCategoriesFetched;
+		const auto previousTimestamp = _cacheTimestamp;
 		if (_searchString.empty()) {
 			GetAll();
 		} else {
 			Search(_searchString);
 		}
+		if (_categoryMap.size() != previousCount ||
+		    _allCategoriesFetched != wasComplete ||
+		    _cacheTimestamp != previousTimestamp) {
+			SaveCache();
+		}
 	}
 
 	emit Finished();
@@ -219,6 +331,8 @@ void CategoryGrabber::GetAll()
 	while (response.status == 200 && !_stop) {
 		cursor = ParseReply(response.data);
 		if (cursor.empty()) {
+			_allCategoriesFetched = true;
+			_cacheTimestamp = getTimestamp();
 			break; // End of category list
 		}
 		params = {{"first", "100"}, {"after", cursor}};
@@ -27,6 +27,9 @@ public:
 		   const std::string searchString = "");
 	void Stop();
 	const std::map<QString, int> &GetCategories();
+	// True if the full category list was fetched and the locally cached
+	// list has not expired yet
+	static bool AllCategoriesFetched();
 
 private:
 signals:
@@ -40,9 +43,15 @@ private:
 	void Search(const std::string &);
 	void GetAll();
 	std::string ParseReply(obs_data_t *) const;
+	static void LoadCache();
+	static void SaveCache();
 
 	std::shared_ptr<TwitchToken> _token;
 	static std::map<QString, int> _categoryMap;
+	static bool _allCategoriesFetched;
+	// Time the cached categories were first fetched at in seconds since
+	// epoch or when the full list was last fetched
+	static int64_t _cacheTimestamp;
 	std::string _searchString = "";
 	bool _stop = false;
 
@@ -0,0 +1,96 @@
+#include "event-sub-message.hpp"
+
+#include <QJsonDocument>
+#include <QJsonObject>
+
+namespace advss {
+
+static EventSubMessage::Type getMessageType(const QString &type)
+{
+	if (type == "session_welcome") {
+		return EventSubMessage::Type::WELCOME;
+	}
+	if (type == "session_keepalive") {
+		return EventSubMessage::Type::KEEPALIVE;
+	}
+	if (type == "notification") {
+		return EventSubMessage::Type::NOTIFICATION;
+	}
+	if (type == "session_reconnect") {
+		return EventSubMessage::Type::RECONNECT;
+	}
+	if (type == "revocation") {
+		return EventSubMessage::Type::REVOCATION;
+	}
+	return EventSubMessage::Type::UNKNOWN;
+}
+
+static void parseSession(const QJsonObject &session, EventSubMessage &message)
+{
+	message.sessionId = session["id"].toString().toStdString();
+	message.reconnectURL =
+		session["reconnect_url"].toString().toStdString();
+	const auto timeout = session["keepalive_timeout_seconds"];
+	if (timeout.isDouble()) {
+		message.keepaliveTimeout =
+			std::chrono::seconds(timeout.toInt());
+	}
+}
+
+std::optional<EventSubMessage> ParseEventSubMessage(const std::string &json)
+{
+	const auto document =
+		QJsonDocument::fromJson(QByteArray::fromStdString(json));
+	if (!document.isObject()) {
+		return {};
+	}
+
+	const auto root = document.object();
+	const auto metadata = root["metadata"].toObject();
+	const auto payload = root["payload"].toObject();
+
+	EventSubMessage message;
+	message.type = getMessageType(metadata["message_type"].toString());
+	message.id = metadata["message_id"].toString().toStdString();
+
+	switch (message.type) {
+	case EventSubMessage::Type::WELCOME:
+	case EventSubMessage::Type::RECONNECT:
+		parseSession(payload["session"].toObject(), message);
+		break;
+	case EventSubMessage::Type::NOTIFICATION:
+	case EventSubMessage::Type::REVOCATION: {
+		const auto subscription = payload["subscription"].toObject();
+		message.subscriptionType =
+			subscription["type"].toString().toStdString();
+		message.subscriptionStatus =
+			subscription["status"].toString().toStdString();
+		const auto event = payload["event"].toObject();
+		message.event = QJsonDocument(event)
+					.toJson(QJsonDocument::Compact)
+					.toStdString();
+		break;
+	}
+	default:
+		break;
+	}
+	return message;
+}
+
+bool MessageIdFilter::IsDuplicate(const std::string &id)
+{
+	if (id.empty()) {
+		return false;
+	}
+	if (!_ids.insert(id).second) {
+		return true;
+	}
+	_order.push_back(id);
+	if (_order.size() > _capacity) {
+		_ids.erase(_order.front());
+		_order.pop_front();
+	}
+	return false;
+}
+
+} // namespace advss
@@ -0,0 +1,53 @@
+#pragma once
+#include <chrono>
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+namespace advss {
+
+// Message received via the EventSub websocket connection
+struct EventSubMessage {
+	enum class Type {
+		UNKNOWN,
+		WELCOME,
+		KEEPALIVE,
+		NOTIFICATION,
+		RECONNECT,
+		REVOCATION,
+	};
+
+	Type type = Type::UNKNOWN;
+	std::string id;
+
+	// Only set for WELCOME and RECONNECT
+	std::string sessionId;
+	std::optional<std::chrono::seconds> keepaliveTimeout;
+	std::string reconnectURL;
+
+	// Only set for NOTIFICATION and REVOCATION
+	std::string subscriptionType;
+	std::string subscriptionStatus;
+	// Event data as compact JSON
+	std::string event;
+};
+
+// Returns std::nullopt if the payload is not a valid JSON object
+std::optional<EventSubMessage> ParseEventSubMessage(const std::string &json);
+
+// Twitch might send the same message more than once.
+// Remembers the ids of the most recent messages to detect duplicates.
+class MessageIdFilter {
+public:
+	explicit MessageIdFilter(size_t capacity = 256) : _capacity(capacity) {}
+	// Messages without an id are never considered to be duplicates
+	bool IsDuplicate(const std::string &id);
+
+private:
+	size_t _capacity;
+	std::unordered_set<std::string> _ids;
+	std::deque<std::string> _order;
+};
+
+} // namespace advss
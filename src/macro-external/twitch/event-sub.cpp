@@ -0,0 +1,539 @@
+#include "event-sub.hpp"
+#include "token.hpp"
+#include "twitch-helpers.hpp"
+
+#include <http-client.hpp>
+#include <log-helper.hpp>
+#include <network-event-loop.hpp>
+#include <obs.hpp>
+#include <switcher-data.hpp>
+
+#include <cstdlib>
+#include <string_view>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <wincrypt.h>
+#elif defined(__APPLE__)
+#include <Security/Security.h>
+#endif
+
+namespace advss {
+
+using websocketpp::connection_hdl;
+
+static constexpr std::string_view defaultEventSubURL =
+	"wss://eventsub.wss.twitch.tv/ws";
+static constexpr std::string_view defaultSubscriptionURL =
+	"https://api.twitch.tv/helix/eventsub/subscriptions";
+
+// The session is closed if no events were requested for this long
+constexpr auto sessionIdleTimeout = std::chrono::seconds(30);
+constexpr auto reconnectDelay = std::chrono::seconds(5);
+constexpr auto subscribeRetryDelay = std::chrono::seconds(60);
+constexpr auto maxSubscribeRetryDelay = std::chrono::seconds(3600);
+constexpr auto subscribeTimeout = std::chrono::seconds(5);
+constexpr auto keepaliveGracePeriod = std::chrono::seconds(5);
+
+static std::string getURL(const char *envVar, std::string_view defaultURL)
+{
+	const char *url = std::getenv(envVar);
+	return url && *url ? url : std::string(defaultURL);
+}
+
+static std::string getEventSubURL()
+{
+	return getURL("ADVSS_TWITCH_EVENTSUB_URL", defaultEventSubURL);
+}
+
+static std::string getSubscriptionURL()
+{
+	return getURL("ADVSS_TWITCH_EVENTSUB_SUBSCRIPTION_URL",
+		      defaultSubscriptionURL);
+}
+
+static void addCertificate(X509_STORE *store, const unsigned char *data,
+			   long size)
+{
+	X509 *cert = d2i_X509(nullptr, &data, size);
+	if (!cert) {
+		return;
+	}
+	X509_STORE_add_cert(store, cert);
+	X509_free(cert);
+}
+
+// The default OpenSSL certificate paths usually contain no certificates on
+// Windows and macOS, so the system trust store is loaded instead, similar to
+// what cpp-httplib does for the Twitch API requests
+static void loadSystemCertificates(X509_STORE *store)
+{
+#ifdef _WIN32
+	HCERTSTORE certStore = CertOpenSystemStoreW(0, L"ROOT");
+	if (!certStore) {
+		blog(LOG_WARNING, "failed to open system certificate store");
+		return;
+	}
+	PCCERT_CONTEXT cert = nullptr;
+	while ((cert = CertEnumCertificatesInStore(certStore, cert))) {
+		addCertificate(store, cert->pbCertEncoded, cert->cbCertEncoded);
+	}
+	CertCloseStore(certStore, 0);
+#elif defined(__APPLE__)
+	CFArrayRef certs = nullptr;
+	if (SecTrustCopyAnchorCertificates(&certs) != errSecSuccess || !certs) {
+		blog(LOG_WARNING, "failed to load system certificates");
+		return;
+	}
+	for (CFIndex i = 0; i < CFArrayGetCount(certs); ++i) {
+		auto cert = (SecCertificateRef)CFArrayGetValueAtIndex(certs, i);
+		CFDataRef data = SecCertificateCopyData(cert);
+		if (!data) {
+			continue;
+		}
+		addCertificate(store, CFDataGetBytePtr(data),
+			       CFDataGetLength(data));
+		CFRelease(data);
+	}
+	CFRelease(certs);
+#else
+	(void)store;
+#endif
+}
+
+EventSub::EventSub()
+{
+	SetupClient(_tlsClient);
+	SetupClient(_plainClient);
+	_tlsClient.set_tls_init_handler([this](connection_hdl) {
+		namespace ssl = websocketpp::lib::asio::ssl;
+		auto context = websocketpp::lib::make_shared<ssl::context>(
+			ssl::context::tlsv12_client);
+		websocketpp::lib::error_code ec;
+		context->set_default_verify_paths(ec);
+		loadSystemCertificates(
+			SSL_CTX_get_cert_store(context->native_handle()));
+		context->set_verify_mode(ssl::verify_peer, ec);
+		// Called from within ConnectNow(), so _mutex is already held
+#if ASIO_VERSION >= 102200
+		context->set_verify_callback(ssl::host_name_verification(_host),
+					     ec);
+#else
+		context->set_verify_callback(ssl::rfc2818_verification(_host),
+					     ec);
+#endif
+		return context;
+	});
+}
+
+EventSub::~EventSub()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_disconnect = true;
+		if (_reconnectTimer) {
+			_reconnectTimer->cancel();
+		}
+		if (_keepaliveTimer) {
+			_keepaliveTimer->cancel();
+		}
+	}
+
+	// The close handlers require the lock
+	while (_openConnections > 0 || _pendingHandlers > 0) {
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			Close(_connection);
+			Close(_oldConnection);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
+}
+
+template<typename Client> void EventSub::SetupClient(Client &client)
+{
+	client.clear_access_channels(websocketpp::log::alevel::all);
+	client.clear_error_channels(websocketpp::log::elevel::all);
+	client.init_asio(&GetNetworkEventLoop());
+	client.set_message_handler(
+		[this](connection_hdl hdl,
+		       typename Client::message_ptr message) {
+			using websocketpp::frame::opcode::text;
+			if (message && message->get_opcode() == text) {
+				OnMessage(hdl, message->get_payload());
+			}
+		});
+	client.set_close_handler([this](connection_hdl hdl) { OnClose(hdl); });
+	client.set_fail_handler([this](connection_hdl hdl) { OnClose(hdl); });
+}
+
+template<typename Client>
+bool EventSub::Connect(Client &client, const std::string &uri)
+{
+	websocketpp::lib::error_code ec;
+	auto con = client.get_connection(uri, ec);
+	if (ec) {
+		blog(LOG_WARNING, "failed to connect to EventSub at '%s': %s",
+		     uri.c_str(), ec.message().c_str());
+		return false;
+	}
+	++_openConnections;
+	_connection = con;
+	client.connect(con);
+	return true;
+}
+
+// Must be called while holding _mutex
+void EventSub::ConnectNow(const std::string &uri)
+{
+	vblog(LOG_INFO, "connecting to EventSub at '%s'", uri.c_str());
+	_connecting = true;
+	_useTls = uri.rfind("wss://", 0) == 0;
+	try {
+		_host = websocketpp::uri(uri).get_host();
+	} catch (const std::exception &) {
+		_host.clear();
+	}
+	const bool connected = _useTls ? Connect(_tlsClient, uri)
+				       : Connect(_plainClient, uri);
+	if (!connected) {
+		ScheduleReconnect();
+	}
+}
+
+// Must be called while holding _mutex
+void EventSub::Close(connection_hdl hdl)
+{
+	if (hdl.expired()) {
+		return;
+	}
+	websocketpp::lib::error_code ec;
+	if (_useTls) {
+		_tlsClient.close(hdl, websocketpp::close::status::normal, "",
+				 ec);
+	} else {
+		_plainClient.close(hdl, websocketpp::close::status::normal, "",
+				   ec);
+	}
+}
+
+// Must be called while holding _mutex
+void EventSub::ScheduleReconnect()
+{
+	if (_disconnect || !InUse()) {
+		_connecting = false;
+		return;
+	}
+	_connecting = true;
+	++_pendingHandlers;
+	_reconnectTimer = _tlsClient.set_timer(
+		std::chrono::duration_cast<std::chrono::milliseconds>(
+			reconnectDelay)
+			.count(),
+		[this](const websocketpp::lib::error_code &ec) {
+			if (!ec) {
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_disconnect && InUse()) {
+					ConnectNow(getEventSubURL());
+				} else {
+					_connecting = false;
+				}
+			}
+			--_pendingHandlers;
+		});
+}
+
+// Must be called while holding _mutex
+void EventSub::ResetKeepaliveTimer()
+{
+	if (_keepaliveTimer) {
+		_keepaliveTimer->cancel();
+	}
+	if (_disconnect) {
+		return;
+	}
+
+	// Twitch sends keepalive messages if there are no events, so if there
+	// is no message at all the connection has to be considered lost
+	++_pendingHandlers;
+	_keepaliveTimer = _tlsClient.set_timer(
+		std::chrono::duration_cast<std::chrono::milliseconds>(
+			_keepaliveTimeout + keepaliveGracePeriod)
+			.count(),
+		[this](const websocketpp::lib::error_code &ec) {
+			if (!ec) {
+				std::lock_guard<std::mutex> lock(_mutex);
+				blog(LOG_INFO, "EventSub connection timed out");
+				Close(_connection);
+			}
+			--_pendingHandlers;
+		});
+}
+
+// Must be called while holding _mutex
+bool EventSub::InUse() const
+{
+	return Clock::now() - _lastUse < sessionIdleTimeout;
+}
+
+bool EventSub::TokenSupportsType(const TwitchToken &token,
+				 const std::string &type)
+{
+	static const std::unordered_map<std::string, TokenOption>
+		requiredOption = {
+			{"channel.follow", {"moderator:read:followers"}},
+			{"channel.channel_points_custom_reward_redemption.add",
+			 {"channel:read:redemptions"}},
+		};
+	auto option = requiredOption.find(type);
+	if (option == requiredOption.end()) {
+		// No permissions required
+		return true;
+	}
+	return token.OptionIsEnabled(option->second);
+}
+
+void EventSub::AddSubscription(const std::shared_ptr<TwitchToken> &token,
+			       const std::string &type)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_lastUse = Clock::now();
+	if (_sessionId.empty()) {
+		if (!_connecting) {
+			ConnectNow(getEventSubURL());
+		}
+		return;
+	}
+	if (_subscribedTypes.count(type) != 0 ||
+	    _pendingSubscriptions.count(type) != 0) {
+		return;
+	}
+	auto retry = _subscribeRetries.find(type);
+	if (retry != _subscribeRetries.end() &&
+	    Clock::now() < retry->second.next) {
+		return;
+	}
+	// Twitch would reject the subscription anyway
+	if (!TokenSupportsType(*token, type)) {
+		return;
+	}
+	_pendingSubscriptions.insert(type);
+	const auto sessionId = _sessionId;
+
+	// The completion callback locks the mutex
+	lock.unlock();
+	Subscribe(*token, type, sessionId);
+}
+
+static OBSData getSubscriptionCondition(const std::string &type,
+					const std::string &userId)
+{
+	OBSDataAutoRelease condition = obs_data_create();
+	if (type == "channel.raid") {
+		obs_data_set_string(condition, "to_broadcaster_user_id",
+				    userId.c_str());
+		return condition.Get();
+	}
+	obs_data_set_string(condition, "broadcaster_user_id", userId.c_str());
+	if (type == "channel.follow") {
+		obs_data_set_string(condition, "moderator_user_id",
+				    userId.c_str());
+	}
+	return condition.Get();
+}
+
+void EventSub::Subscribe(const TwitchToken &token, const std::string &type,
+			 const std::string &sessionId)
+{
+	OBSDataAutoRelease transport = obs_data_create();
+	obs_data_set_string(transport, "method", "websocket");
+	obs_data_set_string(transport, "session_id", sessionId.c_str());
+
+	OBSDataAutoRelease data = obs_data_create();
+	obs_data_set_string(data, "type", type.c_str());
+	obs_data_set_string(data, "version",
+			    type == "channel.follow" ? "2" : "1");
+	obs_data_set_obj(data, "condition",
+			 getSubscriptionCondition(type, token.GetUserID()));
+	obs_data_set_obj(data, "transport", transport);
+	const char *json = obs_data_get_json(data);
+
+	HttpRequest request;
+	request.url = getSubscriptionURL();
+	request.method = HttpRequest::Method::POST;
+	request.body = json ? json : "";
+	request.headers = {
+		"Authorization: Bearer " + token.GetToken(),
+		std::string("Client-Id: ") + GetClientID(),
+		"Content-Type: application/json",
+	};
+	request.timeout = subscribeTimeout;
+
+	// The request is performed in the background, so the macro checks are
+	// never blocked, even if it is retried repeatedly
+	std::weak_ptr<EventSub> weakSelf = weak_from_this();
+	SubmitHttpRequest(request, [weakSelf, type, sessionId](
+					   const HttpResponse &response) {
+		auto self = weakSelf.lock();
+		if (!self) {
+			return;
+		}
+		self->OnSubscribed(type, sessionId, response.status,
+				   response.success ? response.body
+						    : response.error);
+	});
+}
+
+void EventSub::OnSubscribed(const std::string &type,
+			    const std::string &sessionId, long status,
+			    const std::string &error)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_pendingSubscriptions.erase(type);
+
+	// 409 means there already is an identical subscription
+	if (status == 202 || status == 409) {
+		vblog(LOG_INFO, "subscribed to EventSub type '%s'",
+		      type.c_str());
+		_subscribeRetries.erase(type);
+		if (_sessionId == sessionId) {
+			_subscribedTypes.insert(type);
+		}
+		return;
+	}
+
+	// Back off, as failures like missing permissions are not going to be
+	// resolved on their own
+	auto &retry = _subscribeRetries[type];
+	const std::chrono::seconds delay = retry.delay * 2;
+	retry.delay = retry.delay.count() == 0
+			      ? subscribeRetryDelay
+			      : std::min(delay, maxSubscribeRetryDelay);
+	retry.next = Clock::now() + retry.delay;
+	blog(LOG_WARNING,
+	     "failed to subscribe to EventSub type '%s' (%ld) - retrying in %llds: %s",
+	     type.c_str(), status, (long long)retry.delay.count(),
+	     error.c_str());
+}
+
+void EventSub::OnMessage(connection_hdl hdl, const std::string &payload)
+{
+	const auto message = ParseEventSubMessage(payload);
+	if (!message) {
+		blog(LOG_WARNING, "invalid EventSub message received: %s",
+		     payload.c_str());
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_messageIds.IsDuplicate(message->id)) {
+		return;
+	}
+	switch (message->type) {
+	case EventSubMessage::Type::WELCOME:
+		HandleWelcome(hdl, *message);
+		break;
+	case EventSubMessage::Type::NOTIFICATION:
+		HandleNotification(*message);
+		break;
+	case EventSubMessage::Type::RECONNECT:
+		HandleReconnect(*message);
+		break;
+	case EventSubMessage::Type::REVOCATION:
+		HandleRevocation(*message);
+		break;
+	default:
+		break;
+	}
+
+	if (!InUse()) {
+		vblog(LOG_INFO, "closing unused EventSub session");
+		Close(_connection);
+		return;
+	}
+	ResetKeepaliveTimer();
+}
+
+static bool isSameConnection(const connection_hdl &a, const connection_hdl &b)
+{
+	return !a.owner_before(b) && !b.owner_before(a);
+}
+
+void EventSub::OnClose(connection_hdl hdl)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		if (isSameConnection(hdl, _connection)) {
+			vblog(LOG_INFO, "EventSub connection closed");
+			_sessionId.clear();
+			_subscribedTypes.clear();
+			if (_keepaliveTimer) {
+				_keepaliveTimer->cancel();
+			}
+			ScheduleReconnect();
+		}
+	}
+	// This object might be destroyed as soon as this is updated
+	--_openConnections;
+}
+
+// Must be called while holding _mutex
+void EventSub::HandleWelcome(connection_hdl hdl,
+			     const EventSubMessage &message)
+{
+	if (message.sessionId != _sessionId) {
+		_subscribedTypes.clear();
+	}
+	_sessionId = message.sessionId;
+	_connection = hdl;
+	_connecting = false;
+	if (message.keepaliveTimeout) {
+		_keepaliveTimeout = *message.keepaliveTimeout;
+	}
+
+	// Subscriptions were moved to the new connection
+	Close(_oldConnection);
+	_oldConnection.reset();
+	vblog(LOG_INFO, "EventSub session '%s' started", _sessionId.c_str());
+}
+
+// Must be called while holding _mutex
+void EventSub::HandleNotification(const EventSubMessage &message)
+{
+	vblog(LOG_INFO, "received EventSub event '%s'",
+	      message.subscriptionType.c_str());
+	_events.Push({message.subscriptionType, message.event});
+
+	// Check the macros right away instead of waiting for the next interval.
+	// Multiple events received in quick succession only cause one check.
+	auto switcher = GetSwitcher();
+	if (switcher) {
+		switcher->RequestMacroCheck();
+	}
+}
+
+// Must be called while holding _mutex
+void EventSub::HandleReconnect(const EventSubMessage &message)
+{
+	if (message.reconnectURL.empty()) {
+		return;
+	}
+	// The old connection is kept open until the new one is welcomed, so
+	// no events are lost
+	vblog(LOG_INFO, "EventSub requested reconnect to '%s'",
+	      message.reconnectURL.c_str());
+	_oldConnection = _connection;
+	ConnectNow(message.reconnectURL);
+}
+
+// Must be called while holding _mutex
+void EventSub::HandleRevocation(const EventSubMessage &message)
+{
+	blog(LOG_WARNING, "EventSub subscription '%s' was revoked (%s)",
+	     message.subscriptionType.c_str(),
+	     message.subscriptionStatus.c_str());
+	_subscribedTypes.erase(message.subscriptionType);
+}
+
+} // namespace advss
@@ -0,0 +1,126 @@
+#pragma once
+#include "event-sub-message.hpp"
+
+#include <message-buffer.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include <websocketpp/client.hpp>
+#include <websocketpp/config/asio_client.hpp>
+#include <websocketpp/config/asio_no_tls_client.hpp>
+
+namespace advss {
+
+class TwitchToken;
+
+struct TwitchEvent {
+	// EventSub subscription type, e.g. "stream.online"
+	std::string type;
+	// JSON representation of the event data
+	std::string data;
+};
+
+// Session of the Twitch EventSub websocket transport.
+// The session is connected once events are requested via AddSubscription()
+// and closed again once no events were requested for a while.
+// Received events are stored in a message buffer, which can be read by any
+// number of consumers.
+//
+// The server URLs can be overridden using the environment variables
+// ADVSS_TWITCH_EVENTSUB_URL and ADVSS_TWITCH_EVENTSUB_SUBSCRIPTION_URL to test
+// against a local stand-in server, e.g. the one of the Twitch CLI:
+//
+//   twitch event websocket start-server
+//   ADVSS_TWITCH_EVENTSUB_URL=ws://127.0.0.1:8080/ws \
+//   ADVSS_TWITCH_EVENTSUB_SUBSCRIPTION_URL=\
+//   http://127.0.0.1:8080/eventsub/subscriptions obs
+//
+// Events can then be sent using "twitch event trigger channel.follow
+// --transport=websocket" and a session reconnect can be requested using
+// "twitch event websocket reconnect".
+class EventSub : public std::enable_shared_from_this<EventSub> {
+public:
+	EventSub();
+	~EventSub();
+	EventSub(const EventSub &) = delete;
+	EventSub &operator=(const EventSub &) = delete;
+
+	// Requests events of the given subscription type to be received.
+	// Has to be called regularly for as long as the events are needed.
+	// The subscription is created in the background and is skipped if the
+	// token lacks the required permissions.
+	void AddSubscription(const std::shared_ptr<TwitchToken> &,
+			     const std::string &type);
+	static bool TokenSupportsType(const TwitchToken &,
+				      const std::string &type);
+	MessageBuffer<TwitchEvent> &Events() { return _events; }
+
+private:
+	using TlsClient =
+		websocketpp::client<websocketpp::config::asio_tls_client>;
+	using PlainClient =
+		websocketpp::client<websocketpp::config::asio_client>;
+	using Clock = std::chrono::steady_clock;
+
+	template<typename Client> void SetupClient(Client &);
+	template<typename Client>
+	bool Connect(Client &, const std::string &uri);
+	void ConnectNow(const std::string &uri);
+	void Close(websocketpp::connection_hdl);
+	void ScheduleReconnect();
+	void ResetKeepaliveTimer();
+	bool InUse() const;
+	void Subscribe(const TwitchToken &, const std::string &type,
+		       const std::string &sessionId);
+	void OnSubscribed(const std::string &type, const std::string &sessionId,
+			  long status, const std::string &error);
+
+	void OnMessage(websocketpp::connection_hdl, const std::string &);
+	void OnClose(websocketpp::connection_hdl);
+	void HandleWelcome(websocketpp::connection_hdl,
+			   const EventSubMessage &);
+	void HandleNotification(const EventSubMessage &);
+	void HandleReconnect(const EventSubMessage &);
+	void HandleRevocation(const EventSubMessage &);
+
+	TlsClient _tlsClient;
+	PlainClient _plainClient;
+
+	mutable std::mutex _mutex;
+	bool _useTls = true;
+	std::string _host;
+	websocketpp::connection_hdl _connection;
+	// Connection replaced by a reconnect, which is kept open until the
+	// new connection is established
+	websocketpp::connection_hdl _oldConnection;
+	bool _connecting = false;
+	bool _disconnect = false;
+	std::string _sessionId;
+	std::set<std::string> _subscribedTypes;
+	std::set<std::string> _pendingSubscriptions;
+	struct SubscribeRetry {
+		Clock::time_point next;
+		std::chrono::seconds delay{0};
+	};
+	std::map<std::string, SubscribeRetry> _subscribeRetries;
+	Clock::time_point _lastUse;
+	std::chrono::seconds _keepaliveTimeout{10};
+	TlsClient::timer_ptr _keepaliveTimer;
+	TlsClient::timer_ptr _reconnectTimer;
+	MessageIdFilter _messageIds;
+
+	// Handlers and connections on the shared event loop referring to this
+	// object
+	std::atomic_int _pendingHandlers{0};
+	std::atomic_int _openConnections{0};
+
+	MessageBuffer<TwitchEvent> _events;
+};
+
+} // namespace advss
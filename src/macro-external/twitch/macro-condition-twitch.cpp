@@ -0,0 +1,178 @@
+#include "macro-condition-twitch.hpp"
+
+#include <log-helper.hpp>
+#include <utility.hpp>
+
+namespace advss {
+
+const std::string MacroConditionTwitch::id = "twitch";
+
+bool MacroConditionTwitch::_registered = MacroConditionFactory::Register(
+	MacroConditionTwitch::id,
+	{MacroConditionTwitch::Create, MacroConditionTwitchEdit::Create,
+	 "AdvSceneSwitcher.condition.twitch"});
+
+const static std::map<MacroConditionTwitch::Event, std::string> eventTypes = {
+	{MacroConditionTwitch::Event::FOLLOW,
+	 "AdvSceneSwitcher.condition.twitch.type.follow"},
+	{MacroConditionTwitch::Event::RAID,
+	 "AdvSceneSwitcher.condition.twitch.type.raid"},
+	{MacroConditionTwitch::Event::CHANNEL_POINTS_REDEMPTION,
+	 "AdvSceneSwitcher.condition.twitch.type.channelPointsRedemption"},
+	{MacroConditionTwitch::Event::STREAM_ONLINE,
+	 "AdvSceneSwitcher.condition.twitch.type.streamOnline"},
+	{MacroConditionTwitch::Event::STREAM_OFFLINE,
+	 "AdvSceneSwitcher.condition.twitch.type.streamOffline"},
+};
+
+// EventSub subscription types
+const static std::map<MacroConditionTwitch::Event, std::string>
+	subscriptionTypes = {
+		{MacroConditionTwitch::Event::FOLLOW, "channel.follow"},
+		{MacroConditionTwitch::Event::RAID, "channel.raid"},
+		{MacroConditionTwitch::Event::CHANNEL_POINTS_REDEMPTION,
+		 "channel.channel_points_custom_reward_redemption.add"},
+		{MacroConditionTwitch::Event::STREAM_ONLINE, "stream.online"},
+		{MacroConditionTwitch::Event::STREAM_OFFLINE, "stream.offline"},
+};
+
+bool MacroConditionTwitch::CheckCondition()
+{
+	auto token = _token.lock();
+	auto type = subscriptionTypes.find(_event);
+	if (!token || type == subscriptionTypes.end()) {
+		SetVariableValue("");
+		return false;
+	}
+
+	auto eventSub = token->GetEventSub();
+	eventSub->AddSubscription(token, type->second);
+
+	// Only the events received since the last check are considered
+	for (const auto &event : eventSub->Events().Read(_eventCursor)) {
+		if (event.type == type->second) {
+			SetVariableValue(event.data);
+			return true;
+		}
+	}
+	SetVariableValue("");
+	return false;
+}
+
+bool MacroConditionTwitch::Save(obs_data_t *obj) const
+{
+	MacroCondition::Save(obj);
+	obs_data_set_int(obj, "event", static_cast<int>(_event));
+	obs_data_set_string(obj, "token",
+			    GetWeakTwitchTokenName(_token).c_str());
+	return true;
+}
+
+bool MacroConditionTwitch::Load(obs_data_t *obj)
+{
+	MacroCondition::Load(obj);
+	_event = static_cast<Event>(obs_data_get_int(obj, "event"));
+	_token = GetWeakTwitchTokenByName(obs_data_get_string(obj, "token"));
+	return true;
+}
+
+std::string MacroConditionTwitch::GetShortDesc() const
+{
+	return GetWeakTwitchTokenName(_token);
+}
+
+bool MacroConditionTwitch::ConditionIsSupportedByToken()
+{
+	auto token = _token.lock();
+	auto type = subscriptionTypes.find(_event);
+	if (!token || type == subscriptionTypes.end()) {
+		return false;
+	}
+	return EventSub::TokenSupportsType(*token, type->second);
+}
+
+static inline void populateEventSelection(QComboBox *list)
+{
+	for (const auto &[_, name] : eventTypes) {
+		list->addItem(obs_module_text(name.c_str()));
+	}
+}
+
+MacroConditionTwitchEdit::MacroConditionTwitchEdit(
+	QWidget *parent, std::shared_ptr<MacroConditionTwitch> entryData)
+	: QWidget(parent),
+	  _events(new QComboBox()),
+	  _tokens(new TwitchConnectionSelection()),
+	  _tokenPermissionWarning(new QLabel(obs_module_text(
+		  "AdvSceneSwitcher.condition.twitch.tokenPermissionsInsufficient")))
+{
+	populateEventSelection(_events);
+
+	QWidget::connect(_events, SIGNAL(currentIndexChanged(int)), this,
+			 SLOT(EventChanged(int)));
+	QWidget::connect(_tokens, SIGNAL(SelectionChanged(const QString &)),
+			 this, SLOT(TwitchTokenChanged(const QString &)));
+	QWidget::connect(&_tokenPermissionCheckTimer, SIGNAL(timeout()), this,
+			 SLOT(CheckTokenPermissions()));
+
+	auto layout = new QHBoxLayout();
+	PlaceWidgets(obs_module_text("AdvSceneSwitcher.condition.twitch.entry"),
+		     layout,
+		     {{"{{account}}", _tokens}, {"{{events}}", _events}});
+	layout->setContentsMargins(0, 0, 0, 0);
+
+	auto mainLayout = new QVBoxLayout();
+	mainLayout->addLayout(layout);
+	mainLayout->addWidget(_tokenPermissionWarning);
+	setLayout(mainLayout);
+
+	_tokenPermissionCheckTimer.start(1000);
+
+	_entryData = entryData;
+	UpdateEntryData();
+	_loading = false;
+}
+
+void MacroConditionTwitchEdit::EventChanged(int value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_event = static_cast<MacroConditionTwitch::Event>(value);
+	CheckTokenPermissions();
+}
+
+void MacroConditionTwitchEdit::TwitchTokenChanged(const QString &token)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_token = GetWeakTwitchTokenByQString(token);
+	CheckTokenPermissions();
+	emit(HeaderInfoChanged(token));
+}
+
+void MacroConditionTwitchEdit::CheckTokenPermissions()
+{
+	_tokenPermissionWarning->setVisible(
+		_entryData && !_entryData->ConditionIsSupportedByToken());
+	adjustSize();
+	updateGeometry();
+}
+
+void MacroConditionTwitchEdit::UpdateEntryData()
+{
+	if (!_entryData) {
+		return;
+	}
+
+	_events->setCurrentIndex(static_cast<int>(_entryData->_event));
+	_tokens->SetToken(_entryData->_token);
+	CheckTokenPermissions();
+}
+
+} // namespace advss
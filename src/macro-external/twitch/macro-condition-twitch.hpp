@@ -0,0 +1,77 @@
+#pragma once
+#include "macro-condition-edit.hpp"
+#include "event-sub.hpp"
+#include "token.hpp"
+
+#include <QTimer>
+
+namespace advss {
+
+class MacroConditionTwitch : public MacroCondition {
+public:
+	MacroConditionTwitch(Macro *m) : MacroCondition(m, true) {}
+	bool CheckCondition();
+	bool Save(obs_data_t *obj) const;
+	bool Load(obs_data_t *obj);
+	std::string GetShortDesc() const;
+	std::string GetId() const { return id; };
+	static std::shared_ptr<MacroCondition> Create(Macro *m)
+	{
+		return std::make_shared<MacroConditionTwitch>(m);
+	}
+	bool ConditionIsSupportedByToken();
+
+	enum class Event {
+		FOLLOW,
+		RAID,
+		CHANNEL_POINTS_REDEMPTION,
+		STREAM_ONLINE,
+		STREAM_OFFLINE,
+	};
+
+	Event _event = Event::FOLLOW;
+	std::weak_ptr<TwitchToken> _token;
+
+private:
+	MessageBuffer<TwitchEvent>::Cursor _eventCursor;
+
+	static bool _registered;
+	static const std::string id;
+};
+
+class MacroConditionTwitchEdit : public QWidget {
+	Q_OBJECT
+
+public:
+	MacroConditionTwitchEdit(
+		QWidget *parent,
+		std::shared_ptr<MacroConditionTwitch> cond = nullptr);
+	void UpdateEntryData();
+	static QWidget *Create(QWidget *parent,
+			       std::shared_ptr<MacroCondition> cond)
+	{
+		return new MacroConditionTwitchEdit(
+			parent,
+			std::dynamic_pointer_cast<MacroConditionTwitch>(cond));
+	}
+
+private slots:
+	void EventChanged(int);
+	void TwitchTokenChanged(const QString &);
+	void CheckTokenPermissions();
+
+signals:
+	void HeaderInfoChanged(const QString &);
+
+protected:
+	std::shared_ptr<MacroConditionTwitch> _entryData;
+
+private:
+	QComboBox *_events;
+	TwitchConnectionSelection *_tokens;
+	QLabel *_tokenPermissionWarning;
+	QTimer _tokenPermissionCheckTimer;
+	bool _loading = true;
+};
+
+} // namespace advss
@@ -24,6 +24,10 @@ const std::unordered_map<std::string, std::string> TokenOption::apiIdToLocale{
 	 "AdvSceneSwitcher.twitchToken.channel.manageBroadcast"},
 	{"channel:edit:commercial",
 	 "AdvSceneSwitcher.twitchToken.channel.startCommercial"},
+	{"channel:read:redemptions",
+	 "AdvSceneSwitcher.twitchToken.channel.readRedemptions"},
+	{"moderator:read:followers",
+	 "AdvSceneSwitcher.twitchToken.moderator.readFollowers"},
 };
 
 static void saveConnections(obs_data_t *obj);
@@ -131,8 +135,24 @@ bool TwitchToken::OptionIsEnabled(const TokenOption &option) const
 	return false;
 }
 
+static std::mutex eventSubMutex;
+
+std::shared_ptr<EventSub> TwitchToken::GetEventSub()
+{
+	std::lock_guard<std::mutex> lock(eventSubMutex);
+	if (!_eventSub) {
+		_eventSub = std::make_shared<EventSub>();
+	}
+	return _eventSub;
+}
+
 void TwitchToken::SetToken(const std::string &value)
 {
+	{
+		// Subscriptions of the old token cannot be reused
+		std::lock_guard<std::mutex> lock(eventSubMutex);
+		_eventSub.reset();
+	}
 	_token = value;
 	auto res =
 		SendGetRequest("https://api.twitch.tv", "/helix/users", *this);
@@ -1,10 +1,45 @@
 #include "twitch-helpers.hpp"
 #include "token.hpp"
 
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+
 namespace advss {
 
 static constexpr std::string_view clientID = "ds5tt4ogliifsqc04mz3d3etnck3e5";
 
+namespace {
+
+// Long-lived client per API host, so the connection (including the TLS
+// session) is kept alive and reused by subsequent requests
+struct HttpSession {
+	explicit HttpSession(const std::string &uri) : client(uri)
+	{
+		client.set_keep_alive(true);
+	}
+
+	// httplib::Client must not be used by multiple threads at once
+	std::mutex mutex;
+	httplib::Client client;
+};
+
+} // namespace
+
+static HttpSession &getSession(const std::string &uri)
+{
+	static std::mutex mutex;
+	static std::map<std::string, std::unique_ptr<HttpSession>> sessions;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	auto &session = sessions[uri];
+	if (!session) {
+		session = std::make_unique<HttpSession>(uri);
+	}
+	return *session;
+}
+
 static httplib::Headers getTokenRequestHeaders(const TwitchToken &token)
 {
 	return {
@@ -13,16 +48,12 @@ static httplib::Headers getTokenRequestHeaders(const TwitchToken &token)
 	};
 }
 
-RequestResult SendGetRequest(const std::string &uri, const std::string &path,
-			     const TwitchToken &token,
-			     const httplib::Params &params)
+static RequestResult parseResponse(const httplib::Result &response,
+				   const char *func)
 {
-	httplib::Client cli(uri);
-	auto headers = getTokenRequestHeaders(token);
-	auto response = cli.Get(path, params, headers);
 	if (!response) {
 		auto err = response.error();
-		blog(LOG_INFO, "%s failed - %s", __func__,
+		blog(LOG_INFO, "%s failed - %s", func,
 		     httplib::to_string(err).c_str());
 		return {};
 	}
@@ -37,54 +68,90 @@ RequestResult SendGetRequest(const std::string &uri, const std::string &path,
 	return result;
 }
 
+static RequestResult performGetRequest(const std::string &uri,
+				       const std::string &path,
+				       const TwitchToken &token,
+				       const httplib::Params &params)
+{
+	auto &session = getSession(uri);
+	auto headers = getTokenRequestHeaders(token);
+	std::lock_guard<std::mutex> lock(session.mutex);
+	auto response = session.client.Get(path, params, headers);
+	return parseResponse(response, "SendGetRequest");
+}
+
+static std::string getRequestKey(const std::string &uri,
+				 const std::string &path,
+				 const TwitchToken &token,
+				 const httplib::Params &params)
+{
+	std::string key = token.GetToken() + " " + uri + path + "?";
+	for (const auto &[name, value] : params) {
+		key += name + "=" + value + "&";
+	}
+	return key;
+}
+
+RequestResult SendGetRequest(const std::string &uri, const std::string &path,
+			     const TwitchToken &token,
+			     const httplib::Params &params)
+{
+	// Identical requests, which are already in progress, are not sent
+	// again, but share the result of the first request instead
+	static std::mutex mutex;
+	static std::map<std::string, std::shared_future<RequestResult>>
+		pendingRequests;
+
+	const auto key = getRequestKey(uri, path, token, params);
+	std::promise<RequestResult> promise;
+	std::shared_future<RequestResult> pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = pendingRequests.find(key);
+		if (it != pendingRequests.end()) {
+			pending = it->second;
+		} else {
+			pendingRequests.emplace(key,
+						promise.get_future().share());
+		}
+	}
+	if (pending.valid()) {
+		return pending.get();
+	}
+
+	auto result = performGetRequest(uri, path, token, params);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pendingRequests.erase(key);
+	}
+	promise.set_value(result);
+	return result;
+}
+
 RequestResult SendPostRequest(const std::string &uri, const std::string &path,
 			      const TwitchToken &token, const OBSData &data)
 {
-	httplib::Client cli(uri);
+	auto &session = getSession(uri);
 	auto headers = getTokenRequestHeaders(token);
 	auto json = obs_data_get_json(data);
 	std::string body = json ? json : "";
-	auto response = cli.Post(path, headers, body, "application/json");
-	if (!response) {
-		auto err = response.error();
-		blog(LOG_INFO, "%s failed - %s", __func__,
-		     httplib::to_string(err).c_str());
-		return {};
-	}
-	RequestResult result;
-	result.status = response->status;
-	if (response->body.empty()) {
-		return result;
-	}
-	OBSDataAutoRelease replyData =
-		obs_data_create_from_json(response->body.c_str());
-	result.data = replyData;
-	return result;
+	std::lock_guard<std::mutex> lock(session.mutex);
+	auto response =
+		session.client.Post(path, headers, body, "application/json");
+	return parseResponse(response, __func__);
 }
 
 RequestResult SendPatchRequest(const std::string &uri, const std::string &path,
 			       const TwitchToken &token, const OBSData &data)
 {
-	httplib::Client cli(uri);
+	auto &session = getSession(uri);
 	auto headers = getTokenRequestHeaders(token);
 	auto json = obs_data_get_json(data);
 	std::string body = json ? json : "";
-	auto response = cli.Patch(path, headers, body, "application/json");
-	if (!response) {
-		auto err = response.error();
-		blog(LOG_INFO, "%s failed - %s", __func__,
-		     httplib::to_string(err).c_str());
-		return {};
-	}
-	RequestResult result;
-	result.status = response->status;
-	if (response->body.empty()) {
-		return result;
-	}
-	OBSDataAutoRelease replyData =
-		obs_data_create_from_json(response->body.c_str());
-	result.data = replyData;
-	return result;
+	std::lock_guard<std::mutex> lock(session.mutex);
+	auto response =
+		session.client.Patch(path, headers, body, "application/json");
+	return parseResponse(response, __func__);
 }
 
 const char *GetClientID()
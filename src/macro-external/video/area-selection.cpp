@@ -34,6 +34,11 @@ cv::Size Size::CV()
 	return {width, height};
 }
 
+QRect Area::Qt() const
+{
+	return QRect(x, y, width, height);
+}
+
 void Area::Save(obs_data_t *obj, const char *name) const
 {
 	auto data = obs_data_create();
@@ -3,6 +3,7 @@
 
 #include <QWidget>
 #include <QSpinBox>
+#include <QRect>
 #include <obs-data.h>
 #include <opencv2/opencv.hpp>
 
@@ -20,6 +21,7 @@ struct Size {
 struct Area {
 	void Save(obs_data_t *obj, const char *name) const;
 	void Load(obs_data_t *obj, const char *name);
+	QRect Qt() const;
 
 	NumberVariable<int> x;
 	NumberVariable<int> y;
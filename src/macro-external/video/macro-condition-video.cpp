@@ -53,6 +53,15 @@ const static std::map<VideoInput::Type, std::string> videoInputTypes = {
 	 "AdvSceneSwitcher.condition.video.type.scene"},
 };
 
+const static std::map<ScaleParameters::Type, std::string> scaleTypes = {
+	{ScaleParameters::Type::FULL_RESOLUTION,
+	 "AdvSceneSwitcher.condition.video.scale.fullResolution"},
+	{ScaleParameters::Type::FACTOR,
+	 "AdvSceneSwitcher.condition.video.scale.factor"},
+	{ScaleParameters::Type::FIXED_WIDTH,
+	 "AdvSceneSwitcher.condition.video.scale.fixedWidth"},
+};
+
 const static std::map<cv::TemplateMatchModes, std::string> patternMatchModes = {
 	{cv::TemplateMatchModes::TM_CCOEFF_NORMED,
 	 "AdvSceneSwitcher.condition.video.patternMatchMode.correlationCoefficient"},
@@ -83,22 +92,37 @@ const static std::map<tesseract::PageSegMode, std::string> pageSegModes = {
 	 "AdvSceneSwitcher.condition.video.ocrMode.sparseTextOSD"},
 };
 
-cv::CascadeClassifier initObjectCascade(std::string &path)
+static bool requiresFileInput(VideoCondition t)
 {
-	cv::CascadeClassifier cascade;
-	try {
-		cascade.load(path);
-	} catch (...) {
-		blog(LOG_WARNING, "failed to load model data \"%s\"",
-		     path.c_str());
-	}
-	return cascade;
+	return t == VideoCondition::MATCH || t == VideoCondition::DIFFER ||
+	       t == VideoCondition::PATTERN;
 }
 
-static bool requiresFileInput(VideoCondition t)
+// Exact comparisons, object detection size limits and OCR results would be
+// affected by analysing a downscaled image, so scaling is only supported for
+// conditions which are not sensitive to the exact pixel data
+static bool supportsScaling(VideoCondition t)
+{
+	return t == VideoCondition::PATTERN ||
+	       t == VideoCondition::HAS_CHANGED ||
+	       t == VideoCondition::HAS_NOT_CHANGED ||
+	       t == VideoCondition::BRIGHTNESS || t == VideoCondition::COLOR;
+}
+
+// Conditions comparing the video to a reference image
+static bool supportsSimilarity(VideoCondition t)
 {
 	return t == VideoCondition::MATCH || t == VideoCondition::DIFFER ||
-	       t == VideoCondition::PATTERN;
+	       t == VideoCondition::HAS_CHANGED ||
+	       t == VideoCondition::HAS_NOT_CHANGED;
+}
+
+// Conditions for which the analysis is expensive enough that it is worth
+// checking whether the frame has changed at all first
+static bool supportsFrameChangeCheck(VideoCondition t)
+{
+	return t == VideoCondition::PATTERN || t == VideoCondition::OBJECT ||
+	       t == VideoCondition::OCR;
 }
 
 bool MacroConditionVideo::CheckShouldBeSkipped()
@@ -121,35 +145,265 @@ bool MacroConditionVideo::CheckShouldBeSkipped()
 
 bool MacroConditionVideo::CheckCondition()
 {
-	if (!_video.ValidSelection()) {
+	if (!_video.ValidSelection() || !ResourcesLoaded()) {
 		return false;
 	}
 
-	bool match = false;
 	if (CheckShouldBeSkipped()) {
 		return _lastMatchResult;
 	}
 
-	if (_blockUntilScreenshotDone) {
-		GetScreenshot(true);
+	if (_condition == VideoCondition::PATTERN &&
+	    _patternMatchParameters.batch) {
+		return CheckBatchedPattern();
 	}
+	_batchedPattern.reset();
 
-	if (_screenshotData.done) {
-		match = Compare();
-		_lastMatchResult = match;
+	UpdateLastResult();
 
-		if (!requiresFileInput(_condition)) {
-			_matchImage = std::move(_screenshotData.image);
-		}
-		_getNextScreenshot = true;
+	if (UsesRawVideoOutput()) {
+		AnalyzeRawVideoFrame();
 	} else {
-		match = _lastMatchResult;
+		_rawVideoTap.reset();
+		AnalyzeScreenshot();
 	}
 
-	if (!_blockUntilScreenshotDone && _getNextScreenshot) {
+	if (_blockUntilScreenshotDone && ResultIsStale()) {
+		return false;
+	}
+	return _lastMatchResult;
+}
+
+void MacroConditionVideo::AnalyzeScreenshot()
+{
+	// The screenshot is analyzed in the background while the next one is
+	// being captured
+	if (_screenshotData.done) {
+		if (!_analysis.Busy()) {
+			// The previous result is required as the reference
+			// for the next analysis
+			UpdateLastResult();
+			_analysis.Submit(CreateAnalysisInput(
+				std::move(_screenshotData.image),
+				_screenshotData.time));
+			_getNextScreenshot = true;
+		} else if (_blockUntilScreenshotDone) {
+			// Replace the screenshot, which is waiting to be
+			// analyzed, to make sure the most recent frame is used
+			_getNextScreenshot = true;
+		}
+	}
+
+	if (_getNextScreenshot) {
 		GetScreenshot();
 	}
-	return match;
+}
+
+bool MacroConditionVideo::UsesRawVideoOutput() const
+{
+	return _useRawVideoOutput &&
+	       _video.type == VideoInput::Type::OBS_MAIN_OUTPUT;
+}
+
+static uint32_t getFrameRateDivisor(const obs_video_info &ovi)
+{
+	if (ovi.fps_den == 0) {
+		return 1;
+	}
+
+	// Deliver about two frames per interval, so a recent frame is always
+	// available when the condition is checked
+	const double fps = static_cast<double>(ovi.fps_num) / ovi.fps_den;
+	const double framesPerInterval = fps * GetSwitcher()->interval / 1000.0;
+	return std::max(1u, static_cast<uint32_t>(framesPerInterval / 2));
+}
+
+void MacroConditionVideo::AnalyzeRawVideoFrame()
+{
+	obs_video_info ovi;
+	if (!obs_get_video_info(&ovi)) {
+		return;
+	}
+
+	const double scale = GetScaleFactor(nullptr);
+	const auto width = static_cast<uint32_t>(
+		std::max(1L, std::lround(ovi.base_width * scale)));
+	const auto height = static_cast<uint32_t>(
+		std::max(1L, std::lround(ovi.base_height * scale)));
+	const auto divisor = getFrameRateDivisor(ovi);
+	if (!_rawVideoTap || !_rawVideoTap->Uses(width, height, divisor)) {
+		_rawVideoTap = RawVideoTap::Get(width, height, divisor);
+		_lastRawFrameIndex = 0;
+	}
+
+	if (_analysis.Busy()) {
+		return;
+	}
+	auto frame = _rawVideoTap->GetLatestFrame();
+	if (!frame || frame->index == _lastRawFrameIndex) {
+		return;
+	}
+	_lastRawFrameIndex = frame->index;
+
+	QImage image = std::move(frame->image);
+	if (_areaParameters.enable && _condition != VideoCondition::NO_IMAGE) {
+		const auto &area = _areaParameters.area;
+		image = image.copy(
+			qRound(area.x * scale), qRound(area.y * scale),
+			std::max(1, qRound(area.width * scale)),
+			std::max(1, qRound(area.height * scale)));
+	}
+
+	// The previous result is required as the reference for the next
+	// analysis
+	UpdateLastResult();
+	_screenshotScale = scale;
+	_analysis.Submit(CreateAnalysisInput(std::move(image), frame->time));
+}
+
+bool MacroConditionVideo::CheckBatchedPattern()
+{
+	auto source = obs_weak_source_get_source(_video.GetVideo());
+	const double scale = GetScaleFactor(source);
+	obs_source_release(source);
+	const QRect area = _areaParameters.enable ? _areaParameters.area.Qt()
+						  : QRect();
+	if (!_batchedPattern ||
+	    !_batchedPattern->UsesInput(_video.GetVideo(), area, scale)) {
+		_batchedPattern = std::make_unique<BatchedPattern>(
+			_video.GetVideo(), area, scale);
+	}
+
+	ScalePatternData(scale);
+	_batchedPattern->SetPattern(_patternImageData,
+				    _patternMatchParameters.threshold,
+				    _patternMatchParameters.useAlphaAsMask,
+				    _patternMatchParameters.matchMode);
+	_batchedPattern->Update();
+
+	auto result = _batchedPattern->TakeResult();
+	if (!result) {
+		return _lastMatchResult;
+	}
+
+	_lastMatchResult = result->match;
+	_lastResultTime = result->captureTime;
+	_lastVariableValue = "";
+	if (result->match && IsReferencedInVars()) {
+		_lastVariableValue = GetMatchPosition(result->location, scale,
+						      area.topLeft());
+	}
+	SetVariableValue(_lastVariableValue);
+	return _lastMatchResult;
+}
+
+VideoAnalysisInput MacroConditionVideo::CreateAnalysisInput(
+	QImage &&image,
+	const std::chrono::high_resolution_clock::time_point &captureTime)
+{
+	VideoAnalysisInput input;
+	input.condition = _condition;
+	input.image = std::move(image);
+	input.captureTime = captureTime;
+
+	input.scale = _screenshotScale;
+	if (_areaParameters.enable) {
+		input.offset = QPoint(_areaParameters.area.x,
+				      _areaParameters.area.y);
+	}
+	input.reportPosition = IsReferencedInVars();
+
+	input.matchImage = _matchImage;
+	input.usePatternForChangedCheck =
+		_patternMatchParameters.useForChangedCheck;
+	if (input.usePatternForChangedCheck) {
+		input.matchPatternData = _matchPatternData;
+	}
+	input.useSimilarity = _similarityParameters.enable &&
+			      supportsSimilarity(_condition);
+	input.similarityTolerance = _similarityParameters.tolerance;
+	input.matchBlockMeans = _matchBlockMeans;
+
+	if (_condition == VideoCondition::PATTERN) {
+		ScalePatternData(_screenshotScale);
+		input.patternData = _patternImageData;
+	}
+	input.patternThreshold = _patternMatchParameters.threshold;
+	input.useAlphaAsMask = _patternMatchParameters.useAlphaAsMask;
+	input.matchMode = _patternMatchParameters.matchMode;
+	input.fullScalePatternSearch =
+		_patternMisses == fullScalePatternSearchInterval - 1;
+
+	input.cascade = _objMatchParameters.cascade;
+	input.objectScaleFactor = _objMatchParameters.scaleFactor;
+	input.minNeighbors = _objMatchParameters.minNeighbors;
+	input.minSize = _objMatchParameters.minSize.CV();
+	input.maxSize = _objMatchParameters.maxSize.CV();
+
+	input.brightnessThreshold = _brightnessThreshold;
+
+	if (_condition == VideoCondition::OCR) {
+		input.ocrLanguage = _ocrParameters.GetLanguageCode();
+		input.pageSegMode = _ocrParameters.GetPageMode();
+		input.ocrColor = _ocrParameters.color;
+		input.ocrColorThreshold = _ocrParameters.colorThreshold;
+		input.ocrText = _ocrParameters.text;
+		input.ocrUseRegex = _ocrParameters.regex.Enabled();
+		if (input.ocrUseRegex) {
+			input.ocrRegex =
+				_ocrParameters.regex.GetRegularExpression(
+					_ocrParameters.text);
+		}
+	}
+
+	input.color = _colorParameters.color;
+	input.colorThreshold = _colorParameters.colorThreshold;
+	input.colorMatchThreshold = _colorParameters.matchThreshold;
+
+	input.skipUnchangedFrames = _skipUnchangedFrames &&
+				    supportsFrameChangeCheck(_condition);
+	input.unchangedFrameTolerance = _unchangedFrameTolerance;
+	input.frameSignature = _frameSignature;
+	input.frameParameters = _frameParameters;
+	input.lastMatch = _lastMatchResult;
+	input.lastVariableValue = _lastVariableValue;
+	return input;
+}
+
+void MacroConditionVideo::UpdateLastResult()
+{
+	auto result = _analysis.TakeResult();
+	if (!result) {
+		return;
+	}
+
+	_lastMatchResult = result->match;
+	_lastVariableValue = result->variableValue;
+	_lastResultTime = result->captureTime;
+	_frameSignature = result->frameSignature;
+	_frameParameters = result->frameParameters;
+	if (_condition == VideoCondition::PATTERN) {
+		_patternMisses = result->match ? 0 : _patternMisses + 1;
+		_patternMisses %= fullScalePatternSearchInterval;
+	}
+	if (_condition == VideoCondition::BRIGHTNESS) {
+		_currentBrightness = result->brightness;
+	}
+	if (!requiresFileInput(_condition)) {
+		_matchImage = std::move(result->image);
+		_matchPatternData = std::move(result->patternData);
+		_matchBlockMeans = std::move(result->blockMeans);
+	}
+	SetVariableValue(_lastVariableValue);
+}
+
+bool MacroConditionVideo::ResultIsStale() const
+{
+	// Capturing and analyzing a frame takes at least two intervals
+	const auto maxAge =
+		std::chrono::milliseconds(3 * GetSwitcher()->interval);
+	return std::chrono::high_resolution_clock::now() - _lastResultTime >
+	       maxAge;
 }
 
 bool MacroConditionVideo::Save(obs_data_t *obj) const
@@ -160,6 +414,7 @@ bool MacroConditionVideo::Save(obs_data_t *obj) const
 	obs_data_set_string(obj, "filePath", _file.c_str());
 	obs_data_set_bool(obj, "blockUntilScreenshotDone",
 			  _blockUntilScreenshotDone);
+	obs_data_set_bool(obj, "useRawVideoOutput", _useRawVideoOutput);
 	_brightnessThreshold.Save(obj, "brightnessThreshold");
 	_patternMatchParameters.Save(obj);
 	_objMatchParameters.Save(obj);
@@ -167,7 +422,12 @@ bool MacroConditionVideo::Save(obs_data_t *obj) const
 	_colorParameters.Save(obj);
 	obs_data_set_bool(obj, "throttleEnabled", _throttleEnabled);
 	obs_data_set_int(obj, "throttleCount", _throttleCount);
+	obs_data_set_bool(obj, "skipUnchangedFrames", _skipUnchangedFrames);
+	obs_data_set_double(obj, "unchangedFrameTolerance",
+			    _unchangedFrameTolerance);
 	_areaParameters.Save(obj);
+	_scaleParameters.Save(obj);
+	_similarityParameters.Save(obj);
 	return true;
 }
 
@@ -180,6 +440,7 @@ bool MacroConditionVideo::Load(obs_data_t *obj)
 	_file = obs_data_get_string(obj, "filePath");
 	_blockUntilScreenshotDone =
 		obs_data_get_bool(obj, "blockUntilScreenshotDone");
+	_useRawVideoOutput = obs_data_get_bool(obj, "useRawVideoOutput");
 	// TODO: Remove this fallback in a future version
 	if (obs_data_has_user_value(obj, "brightness")) {
 		_brightnessThreshold = obs_data_get_double(obj, "brightness");
@@ -192,13 +453,24 @@ bool MacroConditionVideo::Load(obs_data_t *obj)
 	_colorParameters.Load(obj);
 	_throttleEnabled = obs_data_get_bool(obj, "throttleEnabled");
 	_throttleCount = obs_data_get_int(obj, "throttleCount");
+	_skipUnchangedFrames = obs_data_get_bool(obj, "skipUnchangedFrames");
+	obs_data_set_default_double(obj, "unchangedFrameTolerance", 0.01);
+	_unchangedFrameTolerance =
+		obs_data_get_double(obj, "unchangedFrameTolerance");
 	_areaParameters.Load(obj);
+	_scaleParameters.Load(obj);
+	_similarityParameters.Load(obj);
+	// Loading the files might take a while, which should not block loading
+	// the remaining settings
+	_patternImageLoad = {};
+	_cascadeModelLoad = {};
 	if (requiresFileInput(_condition)) {
-		(void)LoadImageFromFile();
+		_patternImageLoad = LoadPatternImageAsync(_file);
 	}
 
 	if (_condition == VideoCondition::OBJECT) {
-		LoadModelData(_objMatchParameters.modelPath);
+		_cascadeModelLoad =
+			LoadCascadeModelAsync(_objMatchParameters.modelPath);
 	}
 
 	return true;
@@ -209,171 +481,143 @@ std::string MacroConditionVideo::GetShortDesc() const
 	return _video.ToString();
 }
 
-void MacroConditionVideo::GetScreenshot(bool blocking)
+void MacroConditionVideo::GetScreenshot()
 {
 	auto source = obs_weak_source_get_source(_video.GetVideo());
+	const QRect area = (_areaParameters.enable &&
+			    _condition != VideoCondition::NO_IMAGE)
+				   ? _areaParameters.area.Qt()
+				   : QRect();
+	_screenshotScale = GetScaleFactor(source);
 	_screenshotData.~ScreenshotHelper();
 	new (&_screenshotData)
-		ScreenshotHelper(source, blocking, GetSwitcher()->interval);
+		ScreenshotHelper(source, area, false, 0, false, "",
+				 _screenshotScale);
 	obs_source_release(source);
 	_getNextScreenshot = false;
 }
 
+double MacroConditionVideo::GetScaleFactor(obs_source_t *source) const
+{
+	if (!supportsScaling(_condition)) {
+		return 1.0;
+	}
+
+	uint32_t width = 0;
+	if (_areaParameters.enable) {
+		width = std::max(0,
+				 static_cast<int>(_areaParameters.area.width));
+	} else if (source) {
+		width = obs_source_get_base_width(source);
+	} else {
+		obs_video_info ovi;
+		obs_get_video_info(&ovi);
+		width = ovi.base_width;
+	}
+	return _scaleParameters.GetScaleFactor(width);
+}
+
+void MacroConditionVideo::ScalePatternData(double scale)
+{
+	if (scale == _patternScale) {
+		return;
+	}
+	_patternScale = scale;
+	_patternImageData = _patternImage
+				    ? _patternImage->GetPatternData(scale)
+				    : PatternImageData{};
+}
+
 bool MacroConditionVideo::LoadImageFromFile()
 {
-	if (!_matchImage.load(QString::fromStdString(_file))) {
+	_patternImageLoad = {};
+	return SetPatternImage(GetPatternImage(_file));
+}
+
+bool MacroConditionVideo::SetPatternImage(
+	const std::shared_ptr<const PatternImage> &image)
+{
+	_patternImage = image;
+	_matchPatternData = {};
+	if (!_patternImage) {
 		blog(LOG_WARNING, "Cannot load image data from file '%s'",
 		     _file.c_str());
 		(&_matchImage)->~QImage();
 		new (&_matchImage) QImage();
+		_matchBlockMeans = {};
 		_patternImageData = {};
 		return false;
 	}
 
-	_matchImage =
-		_matchImage.convertToFormat(QImage::Format::Format_RGBA8888);
+	_matchImage = _patternImage->Image();
+	_matchBlockMeans = _patternImage->BlockMeans();
 	_patternMatchParameters.image = _matchImage;
-	_patternImageData = CreatePatternData(_matchImage);
+	_patternImageData = _patternImage->GetPatternData();
+	_patternScale = 1.0;
 	return true;
 }
 
 bool MacroConditionVideo::LoadModelData(std::string &path)
 {
+	_cascadeModelLoad = {};
 	_objMatchParameters.modelPath = path;
-	_objMatchParameters.cascade = initObjectCascade(path);
-	return !_objMatchParameters.cascade.empty();
+	_objMatchParameters.cascade = GetCascadeModel(path);
+	return !!_objMatchParameters.cascade;
 }
 
-std::string MacroConditionVideo::GetModelDataPath() const
+template<typename T> static bool isPending(const std::shared_future<T> &load)
 {
-	return _objMatchParameters.modelPath;
+	return load.valid() && load.wait_for(std::chrono::seconds(0)) !=
+				       std::future_status::ready;
 }
 
-void MacroConditionVideo::SetPageSegMode(tesseract::PageSegMode mode)
+bool MacroConditionVideo::ResourcesLoaded()
 {
-	_ocrParameters.SetPageMode(mode);
-}
-
-bool MacroConditionVideo::SetLanguage(const std::string &language)
-{
-	return _ocrParameters.SetLanguageCode(language);
-}
-
-bool MacroConditionVideo::ScreenshotContainsPattern()
-{
-	cv::Mat result;
-	MatchPattern(_screenshotData.image, _patternImageData,
-		     _patternMatchParameters.threshold, result,
-		     _patternMatchParameters.useAlphaAsMask,
-		     _patternMatchParameters.matchMode);
-	if (result.total() == 0) {
+	if (isPending(_patternImageLoad) || isPending(_cascadeModelLoad)) {
 		return false;
 	}
-	return countNonZero(result) > 0;
-}
 
-bool MacroConditionVideo::OutputChanged()
-{
-	if (!_patternMatchParameters.useForChangedCheck) {
-		return _screenshotData.image != _matchImage;
+	if (_patternImageLoad.valid()) {
+		(void)SetPatternImage(_patternImageLoad.get());
+		_patternImageLoad = {};
+		ResetLastMatch();
 	}
-
-	cv::Mat result;
-	_patternImageData = CreatePatternData(_matchImage);
-	MatchPattern(_screenshotData.image, _patternImageData,
-		     _patternMatchParameters.threshold, result,
-		     _patternMatchParameters.useAlphaAsMask,
-		     _patternMatchParameters.matchMode);
-	if (result.total() == 0) {
-		return false;
+	if (_cascadeModelLoad.valid()) {
+		_objMatchParameters.cascade = _cascadeModelLoad.get();
+		if (!_objMatchParameters.cascade) {
+			blog(LOG_WARNING, "failed to load model data \"%s\"",
+			     _objMatchParameters.modelPath.c_str());
+		}
+		_cascadeModelLoad = {};
+		ResetLastMatch();
 	}
-	return countNonZero(result) == 0;
-}
-
-bool MacroConditionVideo::ScreenshotContainsObject()
-{
-	auto objects = MatchObject(_screenshotData.image,
-				   _objMatchParameters.cascade,
-				   _objMatchParameters.scaleFactor,
-				   _objMatchParameters.minNeighbors,
-				   _objMatchParameters.minSize.CV(),
-				   _objMatchParameters.maxSize.CV());
-	return objects.size() > 0;
+	return true;
 }
 
-bool MacroConditionVideo::CheckBrightnessThreshold()
+void MacroConditionVideo::WaitUntilResourcesLoaded()
 {
-	_currentBrightness = GetAvgBrightness(_screenshotData.image) / 255.;
-	return _currentBrightness > _brightnessThreshold;
+	if (_patternImageLoad.valid()) {
+		_patternImageLoad.wait();
+	}
+	if (_cascadeModelLoad.valid()) {
+		_cascadeModelLoad.wait();
+	}
+	(void)ResourcesLoaded();
 }
 
-bool MacroConditionVideo::CheckOCR()
+std::string MacroConditionVideo::GetModelDataPath() const
 {
-	if (!_ocrParameters.Initialized()) {
-		return false;
-	}
-
-	auto text = RunOCR(_ocrParameters.GetOCR(), _screenshotData.image,
-			   _ocrParameters.color, _ocrParameters.colorThreshold);
-	SetVariableValue(text);
-	if (!_ocrParameters.regex.Enabled()) {
-		return text == std::string(_ocrParameters.text);
-	}
-	auto expr =
-		_ocrParameters.regex.GetRegularExpression(_ocrParameters.text);
-	if (!expr.isValid()) {
-		return false;
-	}
-	auto match = expr.match(QString::fromStdString(text));
-	return match.hasMatch();
+	return _objMatchParameters.modelPath;
 }
 
-bool MacroConditionVideo::CheckColor()
+void MacroConditionVideo::SetPageSegMode(tesseract::PageSegMode mode)
 {
-	return ContainsPixelsInColorRange(_screenshotData.image,
-					  _colorParameters.color,
-					  _colorParameters.colorThreshold,
-					  _colorParameters.matchThreshold);
+	_ocrParameters.SetPageMode(mode);
 }
 
-bool MacroConditionVideo::Compare()
+bool MacroConditionVideo::SetLanguage(const std::string &language)
 {
-	if (_areaParameters.enable && _condition != VideoCondition::NO_IMAGE) {
-		_screenshotData.image = _screenshotData.image.copy(
-			_areaParameters.area.x, _areaParameters.area.y,
-			_areaParameters.area.width,
-			_areaParameters.area.height);
-	}
-
-	if (_condition != VideoCondition::OCR) {
-		SetVariableValue("");
-	}
-
-	switch (_condition) {
-	case VideoCondition::MATCH:
-		return _screenshotData.image == _matchImage;
-	case VideoCondition::DIFFER:
-		return _screenshotData.image != _matchImage;
-	case VideoCondition::HAS_CHANGED:
-		return OutputChanged();
-	case VideoCondition::HAS_NOT_CHANGED:
-		return !OutputChanged();
-	case VideoCondition::NO_IMAGE:
-		return _screenshotData.image.isNull();
-	case VideoCondition::PATTERN:
-		return ScreenshotContainsPattern();
-	case VideoCondition::OBJECT:
-		return ScreenshotContainsObject();
-	case VideoCondition::BRIGHTNESS:
-		return CheckBrightnessThreshold();
-	case VideoCondition::OCR:
-		return CheckOCR();
-	case VideoCondition::COLOR:
-		return CheckColor();
-	default:
-		break;
-	}
-	return false;
+	return _ocrParameters.SetLanguageCode(language);
 }
 
 static inline void populateVideoInputSelection(QComboBox *list)
@@ -406,6 +650,14 @@ static inline void populatePatternMatchModeSelection(QComboBox *list)
 	}
 }
 
+static inline void populateScaleTypeSelection(QComboBox *list)
+{
+	for (const auto &[type, name] : scaleTypes) {
+		list->addItem(obs_module_text(name.c_str()),
+			      static_cast<int>(type));
+	}
+}
+
 BrightnessEdit::BrightnessEdit(QWidget *parent,
 			       const std::shared_ptr<MacroConditionVideo> &data)
 	: QWidget(parent),
@@ -563,6 +815,7 @@ void OCREdit::SelectColorClicked()
 	SetupColorLabel(color);
 	auto lock = LockContext();
 	_data->_ocrParameters.color = color;
+	_data->ResetFrameSignature();
 
 	_previewDialog->OCRParametersChanged(_data->_ocrParameters);
 }
@@ -575,6 +828,7 @@ void OCREdit::ColorThresholdChanged(const DoubleVariable &value)
 
 	auto lock = LockContext();
 	_data->_ocrParameters.colorThreshold = value;
+	_data->ResetFrameSignature();
 
 	_previewDialog->OCRParametersChanged(_data->_ocrParameters);
 }
@@ -588,6 +842,7 @@ void OCREdit::MatchTextChanged()
 	auto lock = LockContext();
 	_data->_ocrParameters.text =
 		_matchText->toPlainText().toUtf8().constData();
+	_data->ResetFrameSignature();
 
 	adjustSize();
 	updateGeometry();
@@ -603,6 +858,7 @@ void OCREdit::RegexChanged(RegexConfig conf)
 
 	auto lock = LockContext();
 	_data->_ocrParameters.regex = conf;
+	_data->ResetFrameSignature();
 	adjustSize();
 	updateGeometry();
 
@@ -618,6 +874,7 @@ void OCREdit::PageSegModeChanged(int idx)
 	auto lock = LockContext();
 	_data->SetPageSegMode(static_cast<tesseract::PageSegMode>(
 		_pageSegMode->itemData(idx).toInt()));
+	_data->ResetFrameSignature();
 
 	_previewDialog->OCRParametersChanged(_data->_ocrParameters);
 }
@@ -642,6 +899,7 @@ void OCREdit::LanguageChanged()
 		_languageCode->setText(_data->_ocrParameters.GetLanguageCode());
 		return;
 	}
+	_data->ResetFrameSignature();
 	_previewDialog->OCRParametersChanged(_data->_ocrParameters);
 }
 
@@ -743,6 +1001,7 @@ void ObjectDetectEdit::ObjectScaleThresholdChanged(const DoubleVariable &value)
 
 	auto lock = LockContext();
 	_data->_objMatchParameters.scaleFactor = value;
+	_data->ResetFrameSignature();
 	_previewDialog->ObjDetectParametersChanged(_data->_objMatchParameters);
 }
 
@@ -754,6 +1013,7 @@ void ObjectDetectEdit::MinNeighborsChanged(int value)
 
 	auto lock = LockContext();
 	_data->_objMatchParameters.minNeighbors = value;
+	_data->ResetFrameSignature();
 	_previewDialog->ObjDetectParametersChanged(_data->_objMatchParameters);
 }
 
@@ -765,6 +1025,7 @@ void ObjectDetectEdit::MinSizeChanged(advss::Size value)
 
 	auto lock = LockContext();
 	_data->_objMatchParameters.minSize = value;
+	_data->ResetFrameSignature();
 	_previewDialog->ObjDetectParametersChanged(_data->_objMatchParameters);
 }
 
@@ -776,6 +1037,7 @@ void ObjectDetectEdit::MaxSizeChanged(advss::Size value)
 
 	auto lock = LockContext();
 	_data->_objMatchParameters.maxSize = value;
+	_data->ResetFrameSignature();
 	_previewDialog->ObjDetectParametersChanged(_data->_objMatchParameters);
 }
 
@@ -790,6 +1052,7 @@ void ObjectDetectEdit::ModelPathChanged(const QString &text)
 		auto lock = LockContext();
 		std::string path = text.toStdString();
 		dataLoaded = _data->LoadModelData(path);
+		_data->ResetFrameSignature();
 	}
 	if (!dataLoaded) {
 		DisplayMessage(obs_module_text(
@@ -967,6 +1230,7 @@ void AreaEdit::CheckAreaEnableChanged(int value)
 
 	auto lock = LockContext();
 	_data->_areaParameters.enable = value;
+	_data->ResetFrameSignature();
 	SetWidgetVisibility();
 	_previewDialog->AreaParametersChanged(_data->_areaParameters);
 	emit Resized();
@@ -980,6 +1244,7 @@ void AreaEdit::CheckAreaChanged(Area value)
 
 	auto lock = LockContext();
 	_data->_areaParameters.area = value;
+	_data->ResetFrameSignature();
 	_previewDialog->AreaParametersChanged(_data->_areaParameters);
 }
 
@@ -991,6 +1256,102 @@ void AreaEdit::CheckAreaChanged(QRect rect)
 	CheckAreaChanged(area);
 }
 
+ScaleEdit::ScaleEdit(QWidget *parent,
+		     const std::shared_ptr<MacroConditionVideo> &data)
+	: QWidget(parent),
+	  _type(new QComboBox()),
+	  _factor(new VariableDoubleSpinBox()),
+	  _width(new VariableSpinBox()),
+	  _data(data)
+{
+	populateScaleTypeSelection(_type);
+	_type->setToolTip(obs_module_text(
+		"AdvSceneSwitcher.condition.video.scale.tooltip"));
+	_factor->setMinimum(0.01);
+	_factor->setMaximum(1.0);
+	_factor->setDecimals(2);
+	_factor->SpinBox()->setSingleStep(0.05);
+	_width->setMinimum(1);
+	_width->setMaximum(99999);
+	_width->setSuffix("px");
+
+	QWidget::connect(_type, SIGNAL(currentIndexChanged(int)), this,
+			 SLOT(TypeChanged(int)));
+	QWidget::connect(
+		_factor,
+		SIGNAL(NumberVariableChanged(const NumberVariable<double> &)),
+		this, SLOT(FactorChanged(const NumberVariable<double> &)));
+	QWidget::connect(
+		_width,
+		SIGNAL(NumberVariableChanged(const NumberVariable<int> &)),
+		this, SLOT(WidthChanged(const NumberVariable<int> &)));
+
+	std::unordered_map<std::string, QWidget *> widgetPlaceholders = {
+		{"{{scaleType}}", _type},
+		{"{{scaleFactor}}", _factor},
+		{"{{scaleWidth}}", _width},
+	};
+
+	auto layout = new QHBoxLayout;
+	layout->setContentsMargins(0, 0, 0, 0);
+	PlaceWidgets(
+		obs_module_text("AdvSceneSwitcher.condition.video.entry.scale"),
+		layout, widgetPlaceholders);
+	setLayout(layout);
+
+	_type->setCurrentIndex(_type->findData(
+		static_cast<int>(_data->_scaleParameters.type)));
+	_factor->SetValue(_data->_scaleParameters.factor);
+	_width->SetValue(_data->_scaleParameters.width);
+	SetWidgetVisibility();
+	_loading = false;
+}
+
+void ScaleEdit::TypeChanged(int idx)
+{
+	if (_loading || !_data) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_data->_scaleParameters.type = static_cast<ScaleParameters::Type>(
+		_type->itemData(idx).toInt());
+	_data->ResetLastMatch();
+	SetWidgetVisibility();
+}
+
+void ScaleEdit::FactorChanged(const NumberVariable<double> &value)
+{
+	if (_loading || !_data) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_data->_scaleParameters.factor = value;
+	_data->ResetLastMatch();
+}
+
+void ScaleEdit::WidthChanged(const NumberVariable<int> &value)
+{
+	if (_loading || !_data) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_data->_scaleParameters.width = value;
+	_data->ResetLastMatch();
+}
+
+void ScaleEdit::SetWidgetVisibility()
+{
+	_factor->setVisible(_data->_scaleParameters.type ==
+			    ScaleParameters::Type::FACTOR);
+	_width->setVisible(_data->_scaleParameters.type ==
+			   ScaleParameters::Type::FIXED_WIDTH);
+	adjustSize();
+	updateGeometry();
+}
+
 MacroConditionVideoEdit::MacroConditionVideoEdit(
 	QWidget *parent, std::shared_ptr<MacroConditionVideo> entryData)
 	: QWidget(parent),
@@ -1001,8 +1362,18 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 	  _condition(new QComboBox()),
 	  _reduceLatency(new QCheckBox(obs_module_text(
 		  "AdvSceneSwitcher.condition.video.reduceLatency"))),
+	  _useRawVideoOutput(new QCheckBox(obs_module_text(
+		  "AdvSceneSwitcher.condition.video.useRawVideoOutput"))),
 	  _usePatternForChangedCheck(new QCheckBox(obs_module_text(
 		  "AdvSceneSwitcher.condition.video.usePatternForChangedCheck"))),
+	  _useSimilarity(new QCheckBox(obs_module_text(
+		  "AdvSceneSwitcher.condition.video.useSimilarity"))),
+	  _similarityTolerance(new SliderSpinBox(
+		  0., 1.,
+		  obs_module_text(
+			  "AdvSceneSwitcher.condition.video.similarityTolerance"),
+		  obs_module_text(
+			  "AdvSceneSwitcher.condition.video.similarityToleranceDescription"))),
 	  _imagePath(new FileSelection()),
 	  _patternThreshold(new SliderSpinBox(
 		  0., 1.,
@@ -1014,6 +1385,8 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 		  "AdvSceneSwitcher.condition.video.patternThresholdUseAlphaAsMask"))),
 	  _patternMatchModeLayout(new QHBoxLayout()),
 	  _patternMatchMode(new QComboBox()),
+	  _batchPatternMatching(new QCheckBox(obs_module_text(
+		  "AdvSceneSwitcher.condition.video.batchPatternMatching"))),
 	  _showMatch(new QPushButton(obs_module_text(
 		  "AdvSceneSwitcher.condition.video.showMatch"))),
 	  _previewDialog(this),
@@ -1022,23 +1395,41 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 	  _objectDetect(new ObjectDetectEdit(this, &_previewDialog, entryData)),
 	  _color(new ColorEdit(this, entryData)),
 	  _area(new AreaEdit(this, &_previewDialog, entryData)),
+	  _scale(new ScaleEdit(this, entryData)),
 	  _throttleControlLayout(new QHBoxLayout),
 	  _throttleEnable(new QCheckBox()),
-	  _throttleCount(new QSpinBox())
+	  _throttleCount(new QSpinBox()),
+	  _skipUnchangedLayout(new QHBoxLayout),
+	  _skipUnchanged(new QCheckBox()),
+	  _unchangedTolerance(new QDoubleSpinBox())
 {
 	_reduceLatency->setToolTip(obs_module_text(
 		"AdvSceneSwitcher.condition.video.reduceLatency.tooltip"));
+	_useRawVideoOutput->setToolTip(obs_module_text(
+		"AdvSceneSwitcher.condition.video.useRawVideoOutput.tooltip"));
 	_imagePath->Button()->disconnect();
 	_usePatternForChangedCheck->setToolTip(obs_module_text(
 		"AdvSceneSwitcher.condition.video.usePatternForChangedCheck.tooltip"));
+	_useSimilarity->setToolTip(obs_module_text(
+		"AdvSceneSwitcher.condition.video.useSimilarity.tooltip"));
 	_patternMatchMode->setToolTip(obs_module_text(
 		"AdvSceneSwitcher.condition.video.patternMatchMode.tip"));
 	populatePatternMatchModeSelection(_patternMatchMode);
+	_batchPatternMatching->setToolTip(obs_module_text(
+		"AdvSceneSwitcher.condition.video.batchPatternMatching.tooltip"));
 
 	_throttleCount->setMinimum(1 * GetSwitcher()->interval);
 	_throttleCount->setMaximum(10 * GetSwitcher()->interval);
 	_throttleCount->setSingleStep(GetSwitcher()->interval);
 
+	_skipUnchanged->setToolTip(obs_module_text(
+		"AdvSceneSwitcher.condition.video.skipUnchanged.tooltip"));
+	_unchangedTolerance->setMinimum(0.0);
+	_unchangedTolerance->setMaximum(100.0);
+	_unchangedTolerance->setDecimals(1);
+	_unchangedTolerance->setSingleStep(0.5);
+	_unchangedTolerance->setSuffix("%");
+
 	_brightness->setSizePolicy(QSizePolicy::MinimumExpanding,
 				   QSizePolicy::Preferred);
 	_ocr->setSizePolicy(QSizePolicy::MinimumExpanding,
@@ -1049,6 +1440,8 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 			      QSizePolicy::Preferred);
 	_area->setSizePolicy(QSizePolicy::MinimumExpanding,
 			     QSizePolicy::Preferred);
+	_scale->setSizePolicy(QSizePolicy::MinimumExpanding,
+			      QSizePolicy::Preferred);
 
 	auto sources = GetVideoSourceNames();
 	sources.sort();
@@ -1065,12 +1458,21 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 			 SLOT(ConditionChanged(int)));
 	QWidget::connect(_reduceLatency, SIGNAL(stateChanged(int)), this,
 			 SLOT(ReduceLatencyChanged(int)));
+	QWidget::connect(_useRawVideoOutput, SIGNAL(stateChanged(int)), this,
+			 SLOT(UseRawVideoOutputChanged(int)));
 	QWidget::connect(_imagePath, SIGNAL(PathChanged(const QString &)), this,
 			 SLOT(ImagePathChanged(const QString &)));
 	QWidget::connect(_imagePath->Button(), SIGNAL(clicked()), this,
 			 SLOT(ImageBrowseButtonClicked()));
 	QWidget::connect(_usePatternForChangedCheck, SIGNAL(stateChanged(int)),
 			 this, SLOT(UsePatternForChangedCheckChanged(int)));
+	QWidget::connect(_useSimilarity, SIGNAL(stateChanged(int)), this,
+			 SLOT(UseSimilarityChanged(int)));
+	QWidget::connect(
+		_similarityTolerance,
+		SIGNAL(DoubleValueChanged(const NumberVariable<double> &)),
+		this,
+		SLOT(SimilarityToleranceChanged(const NumberVariable<double> &)));
 	QWidget::connect(
 		_patternThreshold,
 		SIGNAL(DoubleValueChanged(const NumberVariable<double> &)),
@@ -1080,11 +1482,17 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 			 SLOT(UseAlphaAsMaskChanged(int)));
 	QWidget::connect(_patternMatchMode, SIGNAL(currentIndexChanged(int)),
 			 this, SLOT(PatternMatchModeChanged(int)));
+	QWidget::connect(_batchPatternMatching, SIGNAL(stateChanged(int)),
+			 this, SLOT(BatchPatternMatchingChanged(int)));
 
 	QWidget::connect(_throttleEnable, SIGNAL(stateChanged(int)), this,
 			 SLOT(ThrottleEnableChanged(int)));
 	QWidget::connect(_throttleCount, SIGNAL(valueChanged(int)), this,
 			 SLOT(ThrottleCountChanged(int)));
+	QWidget::connect(_skipUnchanged, SIGNAL(stateChanged(int)), this,
+			 SLOT(SkipUnchangedFramesChanged(int)));
+	QWidget::connect(_unchangedTolerance, SIGNAL(valueChanged(double)),
+			 this, SLOT(UnchangedFrameToleranceChanged(double)));
 	QWidget::connect(_showMatch, SIGNAL(clicked()), this,
 			 SLOT(ShowMatchClicked()));
 	QWidget::connect(this,
@@ -1100,6 +1508,7 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 
 	_patternMatchModeLayout->setContentsMargins(0, 0, 0, 0);
 	_throttleControlLayout->setContentsMargins(0, 0, 0, 0);
+	_skipUnchangedLayout->setContentsMargins(0, 0, 0, 0);
 
 	QHBoxLayout *entryLine1Layout = new QHBoxLayout;
 	std::unordered_map<std::string, QWidget *> widgetPlaceholders = {
@@ -1112,6 +1521,8 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 		{"{{throttleEnable}}", _throttleEnable},
 		{"{{throttleCount}}", _throttleCount},
 		{"{{patternMatchingModes}}", _patternMatchMode},
+		{"{{skipUnchanged}}", _skipUnchanged},
+		{"{{unchangedTolerance}}", _unchangedTolerance},
 	};
 	PlaceWidgets(obs_module_text("AdvSceneSwitcher.condition.video.entry"),
 		     entryLine1Layout, widgetPlaceholders);
@@ -1122,6 +1533,10 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 	PlaceWidgets(obs_module_text(
 			     "AdvSceneSwitcher.condition.video.entry.throttle"),
 		     _throttleControlLayout, widgetPlaceholders);
+	PlaceWidgets(
+		obs_module_text(
+			"AdvSceneSwitcher.condition.video.entry.skipUnchanged"),
+		_skipUnchangedLayout, widgetPlaceholders);
 
 	QHBoxLayout *showMatchLayout = new QHBoxLayout;
 	showMatchLayout->addWidget(_showMatch);
@@ -1129,16 +1544,22 @@ MacroConditionVideoEdit::MacroConditionVideoEdit(
 	auto mainLayout = new QVBoxLayout;
 	mainLayout->addLayout(entryLine1Layout);
 	mainLayout->addWidget(_usePatternForChangedCheck);
+	mainLayout->addWidget(_useSimilarity);
+	mainLayout->addWidget(_similarityTolerance);
 	mainLayout->addWidget(_patternThreshold);
 	mainLayout->addWidget(_useAlphaAsMask);
 	mainLayout->addLayout(_patternMatchModeLayout);
+	mainLayout->addWidget(_batchPatternMatching);
 	mainLayout->addWidget(_brightness);
 	mainLayout->addWidget(_ocr);
 	mainLayout->addWidget(_objectDetect);
 	mainLayout->addWidget(_color);
 	mainLayout->addLayout(_throttleControlLayout);
+	mainLayout->addLayout(_skipUnchangedLayout);
 	mainLayout->addWidget(_area);
+	mainLayout->addWidget(_scale);
 	mainLayout->addWidget(_reduceLatency);
+	mainLayout->addWidget(_useRawVideoOutput);
 	mainLayout->addLayout(showMatchLayout);
 	setLayout(mainLayout);
 
@@ -1239,8 +1660,7 @@ void MacroConditionVideoEdit::ConditionChanged(int cond)
 
 	if (_entryData->_condition == VideoCondition::OBJECT) {
 		auto path = _entryData->GetModelDataPath();
-		_entryData->_objMatchParameters.cascade =
-			initObjectCascade(path);
+		_entryData->LoadModelData(path);
 	}
 
 	SetupPreviewDialogParams();
@@ -1317,7 +1737,10 @@ void MacroConditionVideoEdit::ImageBrowseButtonClicked()
 	} else {
 		auto source = obs_weak_source_get_source(
 			_entryData->_video.GetVideo());
-		ScreenshotHelper screenshot(source);
+		ScreenshotHelper screenshot(
+			source, _entryData->_areaParameters.enable
+					? _entryData->_areaParameters.area.Qt()
+					: QRect());
 		obs_source_release(source);
 
 		path = QFileDialog::getSaveFileName(
@@ -1340,13 +1763,6 @@ void MacroConditionVideoEdit::ImageBrowseButtonClicked()
 				"AdvSceneSwitcher.condition.video.screenshotFail"));
 			return;
 		}
-		if (_entryData->_areaParameters.enable) {
-			screenshot.image = screenshot.image.copy(
-				_entryData->_areaParameters.area.x,
-				_entryData->_areaParameters.area.y,
-				_entryData->_areaParameters.area.width,
-				_entryData->_areaParameters.area.height);
-		}
 		screenshot.image.save(path);
 	}
 	_imagePath->SetPath(path);
@@ -1364,6 +1780,30 @@ void MacroConditionVideoEdit::UsePatternForChangedCheckChanged(int value)
 	SetWidgetVisibility();
 }
 
+void MacroConditionVideoEdit::UseSimilarityChanged(int value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_similarityParameters.enable = value;
+	_entryData->ResetLastMatch();
+	SetWidgetVisibility();
+}
+
+void MacroConditionVideoEdit::SimilarityToleranceChanged(
+	const NumberVariable<double> &value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_similarityParameters.tolerance = value;
+	_entryData->ResetFrameSignature();
+}
+
 void MacroConditionVideoEdit::PatternThresholdChanged(
 	const DoubleVariable &value)
 {
@@ -1373,6 +1813,7 @@ void MacroConditionVideoEdit::PatternThresholdChanged(
 
 	auto lock = LockContext();
 	_entryData->_patternMatchParameters.threshold = value;
+	_entryData->ResetFrameSignature();
 	_previewDialog.PatternMatchParametersChanged(
 		_entryData->_patternMatchParameters);
 }
@@ -1387,6 +1828,17 @@ void MacroConditionVideoEdit::ReduceLatencyChanged(int value)
 	_entryData->_blockUntilScreenshotDone = value;
 }
 
+void MacroConditionVideoEdit::UseRawVideoOutputChanged(int value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_useRawVideoOutput = value;
+	_entryData->ResetLastMatch();
+}
+
 void MacroConditionVideoEdit::UseAlphaAsMaskChanged(int value)
 {
 	if (_loading || !_entryData) {
@@ -1395,6 +1847,7 @@ void MacroConditionVideoEdit::UseAlphaAsMaskChanged(int value)
 
 	auto lock = LockContext();
 	_entryData->_patternMatchParameters.useAlphaAsMask = value;
+	_entryData->ResetFrameSignature();
 	_entryData->LoadImageFromFile();
 	_previewDialog.PatternMatchParametersChanged(
 		_entryData->_patternMatchParameters);
@@ -1410,10 +1863,23 @@ void MacroConditionVideoEdit::PatternMatchModeChanged(int idx)
 	_entryData->_patternMatchParameters.matchMode =
 		static_cast<cv::TemplateMatchModes>(
 			_patternMatchMode->itemData(idx).toInt());
+	_entryData->ResetFrameSignature();
 	_previewDialog.PatternMatchParametersChanged(
 		_entryData->_patternMatchParameters);
 }
 
+void MacroConditionVideoEdit::BatchPatternMatchingChanged(int value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_patternMatchParameters.batch = value;
+	_entryData->ResetLastMatch();
+	SetWidgetVisibility();
+}
+
 void MacroConditionVideoEdit::ThrottleEnableChanged(int value)
 {
 	if (_loading || !_entryData) {
@@ -1435,6 +1901,29 @@ void MacroConditionVideoEdit::ThrottleCountChanged(int value)
 	_entryData->_throttleCount = value / GetSwitcher()->interval;
 }
 
+void MacroConditionVideoEdit::SkipUnchangedFramesChanged(int value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_skipUnchangedFrames = value;
+	_entryData->ResetFrameSignature();
+	_unchangedTolerance->setEnabled(value);
+}
+
+void MacroConditionVideoEdit::UnchangedFrameToleranceChanged(double value)
+{
+	if (_loading || !_entryData) {
+		return;
+	}
+
+	auto lock = LockContext();
+	_entryData->_unchangedFrameTolerance = value / 100.0;
+	_entryData->ResetFrameSignature();
+}
+
 void MacroConditionVideoEdit::ShowMatchClicked()
 {
 	_previewDialog.show();
@@ -1478,6 +1967,8 @@ void MacroConditionVideoEdit::SetWidgetVisibility()
 	_sources->setVisible(_entryData->_video.type ==
 			     VideoInput::Type::SOURCE);
 	_scenes->setVisible(_entryData->_video.type == VideoInput::Type::SCENE);
+	_useRawVideoOutput->setVisible(_entryData->_video.type ==
+				       VideoInput::Type::OBS_MAIN_OUTPUT);
 	_imagePath->setVisible(requiresFileInput(_entryData->_condition));
 	_usePatternForChangedCheck->setVisible(
 		patternControlIsOptional(_entryData->_condition));
@@ -1486,6 +1977,8 @@ void MacroConditionVideoEdit::SetWidgetVisibility()
 				    VideoCondition::PATTERN);
 	SetLayoutVisible(_patternMatchModeLayout,
 			 _entryData->_condition == VideoCondition::PATTERN);
+	_batchPatternMatching->setVisible(_entryData->_condition ==
+					  VideoCondition::PATTERN);
 	_brightness->setVisible(_entryData->_condition ==
 				VideoCondition::BRIGHTNESS);
 	_showMatch->setVisible(needsShowMatch(_entryData->_condition));
@@ -1495,7 +1988,21 @@ void MacroConditionVideoEdit::SetWidgetVisibility()
 	_color->setVisible(_entryData->_condition == VideoCondition::COLOR);
 	SetLayoutVisible(_throttleControlLayout,
 			 needsThrottleControls(_entryData->_condition));
+	SetLayoutVisible(
+		_skipUnchangedLayout,
+		supportsFrameChangeCheck(_entryData->_condition) &&
+			!(_entryData->_condition == VideoCondition::PATTERN &&
+			  _entryData->_patternMatchParameters.batch));
 	_area->setVisible(needsAreaControls(_entryData->_condition));
+	_scale->setVisible(supportsScaling(_entryData->_condition));
+
+	const bool useSimilarity =
+		supportsSimilarity(_entryData->_condition) &&
+		!(patternControlIsOptional(_entryData->_condition) &&
+		  _entryData->_patternMatchParameters.useForChangedCheck);
+	_useSimilarity->setVisible(useSimilarity);
+	_similarityTolerance->setVisible(
+		useSimilarity && _entryData->_similarityParameters.enable);
 
 	if (_entryData->_condition == VideoCondition::HAS_CHANGED ||
 	    _entryData->_condition == VideoCondition::HAS_NOT_CHANGED) {
@@ -1533,24 +2040,37 @@ void MacroConditionVideoEdit::UpdateEntryData()
 		return;
 	}
 
+	// The widget is usually only created long after the resources were
+	// loaded, so this should not block noticeably
+	_entryData->WaitUntilResourcesLoaded();
 	_videoInputTypes->setCurrentIndex(
 		static_cast<int>(_entryData->_video.type));
 	_scenes->SetScene(_entryData->_video.scene);
 	_sources->SetSource(_entryData->_video.source);
 	_condition->setCurrentIndex(static_cast<int>(_entryData->_condition));
 	_reduceLatency->setChecked(_entryData->_blockUntilScreenshotDone);
+	_useRawVideoOutput->setChecked(_entryData->_useRawVideoOutput);
 	_imagePath->SetPath(QString::fromStdString(_entryData->_file));
 	_usePatternForChangedCheck->setChecked(
 		_entryData->_patternMatchParameters.useForChangedCheck);
+	_useSimilarity->setChecked(_entryData->_similarityParameters.enable);
+	_similarityTolerance->SetDoubleValue(
+		_entryData->_similarityParameters.tolerance);
 	_patternThreshold->SetDoubleValue(
 		_entryData->_patternMatchParameters.threshold);
 	_useAlphaAsMask->setChecked(
 		_entryData->_patternMatchParameters.useAlphaAsMask);
 	_patternMatchMode->setCurrentIndex(_patternMatchMode->findData(
 		_entryData->_patternMatchParameters.matchMode));
+	_batchPatternMatching->setChecked(
+		_entryData->_patternMatchParameters.batch);
 	_throttleEnable->setChecked(_entryData->_throttleEnabled);
 	_throttleCount->setValue(_entryData->_throttleCount *
 				 GetSwitcher()->interval);
+	_skipUnchanged->setChecked(_entryData->_skipUnchangedFrames);
+	_unchangedTolerance->setValue(_entryData->_unchangedFrameTolerance *
+				      100.0);
+	_unchangedTolerance->setEnabled(_entryData->_skipUnchangedFrames);
 	UpdatePreviewTooltip();
 	SetupPreviewDialogParams();
 	SetWidgetVisibility();
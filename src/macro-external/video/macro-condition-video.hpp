@@ -3,11 +3,15 @@
 #include "area-selection.hpp"
 #include "preview-dialog.hpp"
 #include "paramerter-wrappers.hpp"
+#include "pattern-match-batch.hpp"
+#include "raw-video-tap.hpp"
+#include "video-analysis.hpp"
 
 #include <macro.hpp>
 #include <file-selection.hpp>
 #include <screenshot-helper.hpp>
 #include <slider-spinbox.hpp>
+#include <variable-spinbox.hpp>
 #include <variable-text-edit.hpp>
 #include <variable-line-edit.hpp>
 
@@ -36,11 +40,30 @@ public:
 		return std::make_shared<MacroConditionVideo>(m);
 	}
 	QImage GetMatchImage() const { return _matchImage; };
-	void GetScreenshot(bool blocking = false);
+	void GetScreenshot();
 	bool LoadImageFromFile();
 	bool LoadModelData(std::string &path);
+	// Resources are loaded in the background when the condition is loaded
+	// and the condition will not match until they are available
+	bool ResourcesLoaded();
+	void WaitUntilResourcesLoaded();
 	std::string GetModelDataPath() const;
-	void ResetLastMatch() { _lastMatchResult = false; }
+	void ResetLastMatch()
+	{
+		_lastMatchResult = false;
+		ResetFrameSignature();
+	}
+	// Forces the next frame to be analyzed even if it did not change and
+	// drops the result of analysis using the previous settings
+	void ResetFrameSignature()
+	{
+		_frameSignature = {};
+		_frameParameters.clear();
+		_analysis.DiscardPendingResult();
+		if (_batchedPattern) {
+			_batchedPattern->DiscardPendingResult();
+		}
+	}
 	double GetCurrentBrightness() const { return _currentBrightness; }
 	void SetPageSegMode(tesseract::PageSegMode);
 	bool SetLanguage(const std::string &);
@@ -48,38 +71,70 @@ public:
 	VideoInput _video;
 	VideoCondition _condition = VideoCondition::MATCH;
 	std::string _file = obs_module_text("AdvSceneSwitcher.enterPath");
-	// Enabling this will reduce matching latency, but slow down the
-	// the condition checks of all macros overall.
+	// Screenshots are analyzed in the background while the next one is
+	// being captured.
 	//
-	// If not set the screenshot will be gathered in one interval and
-	// checked in the next one.
-	// If set both operations will happen in the same interval.
+	// If set a new screenshot will be requested in every interval, so the
+	// most recent frame is analyzed as soon as the analysis of the
+	// previous one finished, and results which are older than a few
+	// intervals are not considered a match.
 	bool _blockUntilScreenshotDone = false;
+	// Use the frames of the main output instead of rendering it again
+	bool _useRawVideoOutput = false;
 	NumberVariable<double> _brightnessThreshold = 0.5;
 	PatternMatchParameters _patternMatchParameters;
 	ObjDetectParameters _objMatchParameters;
 	OCRParameters _ocrParameters;
 	ColorParameters _colorParameters;
 	AreaParameters _areaParameters;
+	ScaleParameters _scaleParameters;
+	SimilarityParameters _similarityParameters;
 	bool _throttleEnabled = false;
 	int _throttleCount = 3;
+	// Reuse the previous result if the frame did not change noticeably
+	bool _skipUnchangedFrames = false;
+	double _unchangedFrameTolerance = 0.01;
 
 private:
-	bool OutputChanged();
-	bool ScreenshotContainsPattern();
-	bool ScreenshotContainsObject();
-	bool CheckBrightnessThreshold();
-	bool CheckOCR();
-	bool CheckColor();
-	bool Compare();
+	bool CheckBatchedPattern();
+	void AnalyzeScreenshot();
+	bool UsesRawVideoOutput() const;
+	void AnalyzeRawVideoFrame();
+	VideoAnalysisInput CreateAnalysisInput(
+		QImage &&image,
+		const std::chrono::high_resolution_clock::time_point &);
+	void UpdateLastResult();
+	bool ResultIsStale() const;
 	bool CheckShouldBeSkipped();
+	double GetScaleFactor(obs_source_t *) const;
+	void ScalePatternData(double scale);
+	bool SetPatternImage(const std::shared_ptr<const PatternImage> &);
 
 	bool _getNextScreenshot = true;
 	ScreenshotHelper _screenshotData;
+	double _screenshotScale = 1.0;
 	QImage _matchImage;
+	PatternImageData _matchPatternData;
+	cv::Mat _matchBlockMeans;
+	std::shared_ptr<const PatternImage> _patternImage;
+	std::shared_future<std::shared_ptr<const PatternImage>>
+		_patternImageLoad;
+	std::shared_future<std::shared_ptr<CascadeModel>> _cascadeModelLoad;
 	PatternImageData _patternImageData;
+	double _patternScale = 1.0;
+	// Consecutive pattern checks without a match
+	int _patternMisses = 0;
+	cv::Mat1b _frameSignature;
+	// Resolved parameters used to analyze the frame of _frameSignature
+	std::string _frameParameters;
+	VideoAnalysisWorker _analysis;
+	std::unique_ptr<BatchedPattern> _batchedPattern;
+	std::shared_ptr<RawVideoTap> _rawVideoTap;
+	uint64_t _lastRawFrameIndex = 0;
 
 	bool _lastMatchResult = false;
+	std::string _lastVariableValue;
+	std::chrono::high_resolution_clock::time_point _lastResultTime{};
 	int _runCount = 0;
 
 	double _currentBrightness = 0.;
@@ -221,6 +276,29 @@ private:
 	bool _loading = true;
 };
 
+class ScaleEdit : public QWidget {
+	Q_OBJECT
+
+public:
+	ScaleEdit(QWidget *parent,
+		  const std::shared_ptr<MacroConditionVideo> &);
+
+private slots:
+	void TypeChanged(int);
+	void FactorChanged(const NumberVariable<double> &);
+	void WidthChanged(const NumberVariable<int> &);
+
+private:
+	void SetWidgetVisibility();
+
+	QComboBox *_type;
+	VariableDoubleSpinBox *_factor;
+	VariableSpinBox *_width;
+
+	std::shared_ptr<MacroConditionVideo> _data;
+	bool _loading = true;
+};
+
 class MacroConditionVideoEdit : public QWidget {
 	Q_OBJECT
 
@@ -245,6 +323,7 @@ private slots:
 	void SceneChanged(const SceneSelection &);
 	void ConditionChanged(int cond);
 	void ReduceLatencyChanged(int value);
+	void UseRawVideoOutputChanged(int value);
 
 	void ImagePathChanged(const QString &text);
 	void ImageBrowseButtonClicked();
@@ -253,9 +332,14 @@ private slots:
 	void PatternThresholdChanged(const NumberVariable<double> &);
 	void UseAlphaAsMaskChanged(int value);
 	void PatternMatchModeChanged(int value);
+	void UseSimilarityChanged(int value);
+	void SimilarityToleranceChanged(const NumberVariable<double> &);
+	void BatchPatternMatchingChanged(int value);
 
 	void ThrottleEnableChanged(int value);
 	void ThrottleCountChanged(int value);
+	void SkipUnchangedFramesChanged(int value);
+	void UnchangedFrameToleranceChanged(double value);
 	void ShowMatchClicked();
 
 	void SetWidgetVisibility();
@@ -275,14 +359,18 @@ private:
 	QComboBox *_condition;
 
 	QCheckBox *_reduceLatency;
+	QCheckBox *_useRawVideoOutput;
 
 	QCheckBox *_usePatternForChangedCheck;
+	QCheckBox *_useSimilarity;
+	SliderSpinBox *_similarityTolerance;
 	FileSelection *_imagePath;
 
 	SliderSpinBox *_patternThreshold;
 	QCheckBox *_useAlphaAsMask;
 	QHBoxLayout *_patternMatchModeLayout;
 	QComboBox *_patternMatchMode;
+	QCheckBox *_batchPatternMatching;
 
 	QPushButton *_showMatch;
 	PreviewDialog _previewDialog;
@@ -292,11 +380,16 @@ private:
 	ObjectDetectEdit *_objectDetect;
 	ColorEdit *_color;
 	AreaEdit *_area;
+	ScaleEdit *_scale;
 
 	QHBoxLayout *_throttleControlLayout;
 	QCheckBox *_throttleEnable;
 	QSpinBox *_throttleCount;
 
+	QHBoxLayout *_skipUnchangedLayout;
+	QCheckBox *_skipUnchanged;
+	QDoubleSpinBox *_unchangedTolerance;
+
 	std::shared_ptr<MacroConditionVideo> _entryData;
 	bool _loading = true;
 };
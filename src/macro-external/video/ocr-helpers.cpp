@@ -0,0 +1,261 @@
+#include "ocr-helpers.hpp"
+
+#include <log-helper.hpp>
+#include <obs-module.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace advss {
+
+namespace {
+
+using EngineKey = std::pair<std::string, tesseract::PageSegMode>;
+
+// The language data might be added while OBS is running, so initialization is
+// retried with increasing delays instead of giving up for good
+struct InitRetry {
+	std::chrono::steady_clock::time_point next;
+	std::chrono::seconds delay;
+};
+
+struct EnginePool {
+	~EnginePool();
+
+	std::mutex mutex;
+	std::map<EngineKey, std::vector<tesseract::TessBaseAPI *>> idle;
+	std::map<EngineKey, InitRetry> failed;
+};
+
+struct CachedText {
+	cv::Mat1b image;
+	std::string language;
+	tesseract::PageSegMode mode;
+	std::string text;
+	uint64_t lastUsed = 0;
+};
+
+} // namespace
+
+constexpr auto initRetryDelay = std::chrono::seconds(10);
+constexpr auto maxInitRetryDelay = std::chrono::seconds(600);
+
+EnginePool::~EnginePool()
+{
+	for (const auto &[_, engines] : idle) {
+		for (auto engine : engines) {
+			engine->End();
+			delete engine;
+		}
+	}
+}
+
+static std::shared_ptr<EnginePool> getEnginePool()
+{
+	static auto pool = std::make_shared<EnginePool>();
+	return pool;
+}
+
+static tesseract::TessBaseAPI *createEngine(const EngineKey &key)
+{
+	auto engine = new tesseract::TessBaseAPI();
+	std::string dataPath = obs_get_module_data_path(obs_current_module()) +
+			       std::string("/res/ocr");
+	if (engine->Init(dataPath.c_str(), key.first.c_str()) != 0) {
+		delete engine;
+		return nullptr;
+	}
+	engine->SetPageSegMode(key.second);
+	return engine;
+}
+
+std::shared_ptr<tesseract::TessBaseAPI>
+BorrowOCREngine(const std::string &language, tesseract::PageSegMode mode)
+{
+	auto pool = getEnginePool();
+	const EngineKey key(language, mode);
+	tesseract::TessBaseAPI *engine = nullptr;
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		auto retry = pool->failed.find(key);
+		if (retry != pool->failed.end() &&
+		    std::chrono::steady_clock::now() < retry->second.next) {
+			return nullptr;
+		}
+		auto &idle = pool->idle[key];
+		if (!idle.empty()) {
+			engine = idle.back();
+			idle.pop_back();
+		}
+	}
+
+	// Initialization is slow, so it should not block other users of
+	// the pool
+	if (!engine) {
+		engine = createEngine(key);
+	}
+	if (!engine) {
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		auto it = pool->failed.find(key);
+		std::chrono::seconds delay = initRetryDelay;
+		if (it != pool->failed.end()) {
+			const std::chrono::seconds doubled =
+				it->second.delay * 2;
+			delay = std::min(doubled, maxInitRetryDelay);
+		}
+		pool->failed[key] = {std::chrono::steady_clock::now() + delay,
+				     delay};
+		blog(LOG_WARNING,
+		     "failed to initialize OCR engine for language \"%s\" - retrying in %d seconds",
+		     language.c_str(), static_cast<int>(delay.count()));
+		return nullptr;
+	}
+	{
+		std::lock_guard<std::mutex> lock(pool->mutex);
+		pool->failed.erase(key);
+	}
+
+	std::weak_ptr<EnginePool> weakPool = pool;
+	return std::shared_ptr<tesseract::TessBaseAPI>(
+		engine, [weakPool, key](tesseract::TessBaseAPI *engine) {
+			auto pool = weakPool.lock();
+			if (!pool) {
+				engine->End();
+				delete engine;
+				return;
+			}
+			std::lock_guard<std::mutex> lock(pool->mutex);
+			pool->idle[key].push_back(engine);
+		});
+}
+
+#ifdef OCR_SUPPORT
+
+static uint64_t hashOCRInput(const cv::Mat1b &image,
+			     const std::string &language,
+			     tesseract::PageSegMode mode)
+{
+	// FNV-1a
+	constexpr uint64_t prime = 0x100000001b3;
+	uint64_t hash = 0xcbf29ce484222325;
+	auto add = [&hash](const uchar *data, size_t size) {
+		for (size_t i = 0; i < size; ++i) {
+			hash ^= data[i];
+			hash *= prime;
+		}
+	};
+	for (int row = 0; row < image.rows; ++row) {
+		add(image.ptr(row), image.cols);
+	}
+	add(reinterpret_cast<const uchar *>(language.data()), language.size());
+	const int values[] = {image.cols, image.rows, static_cast<int>(mode)};
+	add(reinterpret_cast<const uchar *>(values), sizeof(values));
+	return hash;
+}
+
+static std::mutex cacheMutex;
+static std::unordered_map<uint64_t, CachedText> textCache;
+static uint64_t cacheUseCount = 0;
+constexpr size_t maxCachedTexts = 64;
+
+static bool getCachedText(uint64_t hash, const cv::Mat1b &image,
+			  const std::string &language,
+			  tesseract::PageSegMode mode, std::string &text)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	auto it = textCache.find(hash);
+	if (it == textCache.end()) {
+		return false;
+	}
+
+	// Make sure this is not a hash collision
+	auto &entry = it->second;
+	if (entry.language != language || entry.mode != mode ||
+	    entry.image.size() != image.size() ||
+	    cv::norm(entry.image, image, cv::NORM_INF) != 0) {
+		return false;
+	}
+	entry.lastUsed = ++cacheUseCount;
+	text = entry.text;
+	return true;
+}
+
+static void cacheText(uint64_t hash, const cv::Mat1b &image,
+		      const std::string &language, tesseract::PageSegMode mode,
+		      const std::string &text)
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	if (textCache.size() >= maxCachedTexts &&
+	    textCache.find(hash) == textCache.end()) {
+		auto oldest = std::min_element(
+			textCache.begin(), textCache.end(),
+			[](const auto &a, const auto &b) {
+				return a.second.lastUsed < b.second.lastUsed;
+			});
+		textCache.erase(oldest);
+	}
+	textCache[hash] = {image, language, mode, text, ++cacheUseCount};
+}
+
+static cv::Mat1b scaleUpForOCR(const cv::Mat1b &image)
+{
+	// Scale image up if selected area is very small.
+	// Results will probably still be unsatisfying.
+	if (image.rows > 300 && image.cols > 300) {
+		return image;
+	}
+
+	double scale = 0.;
+	if (image.rows < image.cols) {
+		scale = 300. / image.rows;
+	} else {
+		scale = 300. / image.cols;
+	}
+	cv::Mat1b result;
+	cv::resize(image, result,
+		   cv::Size(image.cols * scale, image.rows * scale), 0, 0,
+		   cv::INTER_CUBIC);
+	return result;
+}
+
+#endif
+
+std::string RunOCR(const QImage &image, const QColor &color, double colorDiff,
+		   const std::string &language, tesseract::PageSegMode mode)
+{
+	if (image.isNull()) {
+		return "";
+	}
+
+#ifdef OCR_SUPPORT
+	const auto preprocessed = PreprocessForOCR(image, color, colorDiff);
+	const auto hash = hashOCRInput(preprocessed, language, mode);
+	std::string text;
+	if (getCachedText(hash, preprocessed, language, mode, text)) {
+		return text;
+	}
+
+	auto ocr = BorrowOCREngine(language, mode);
+	if (!ocr) {
+		return "";
+	}
+
+	const auto scaled = scaleUpForOCR(preprocessed);
+	ocr->SetImage(scaled.data, scaled.cols, scaled.rows, 1, scaled.step);
+	ocr->Recognize(0);
+	std::unique_ptr<char[]> detectedText(ocr->GetUTF8Text());
+	if (detectedText) {
+		text = detectedText.get();
+	}
+	cacheText(hash, preprocessed, language, mode, text);
+	return text;
+#else
+	return "";
+#endif
+}
+
+} // namespace advss
@@ -0,0 +1,24 @@
+#pragma once
+#include "opencv-helpers.hpp"
+
+#include <memory>
+#include <string>
+
+namespace advss {
+
+// Initializing a Tesseract engine loads the full language model, so
+// initialized engines are shared by all users of the same language and page
+// segmentation mode.
+// The returned engine can be used exclusively until the last reference to it
+// is released, at which point it is returned to the pool.
+// Returns nullptr if the engine could not be initialized, in which case
+// initialization is only attempted again after a delay.
+std::shared_ptr<tesseract::TessBaseAPI>
+BorrowOCREngine(const std::string &language, tesseract::PageSegMode);
+
+// Text which was already recognized in an identical preprocessed image will be
+// returned from a cache instead of running the recognition again
+std::string RunOCR(const QImage &, const QColor &, double colorDiff,
+		   const std::string &language, tesseract::PageSegMode);
+
+} // namespace advss
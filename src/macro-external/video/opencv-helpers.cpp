@@ -2,6 +2,8 @@
 
 #include <log-helper.hpp>
 
+#include <algorithm>
+
 namespace advss {
 
 PatternImageData CreatePatternData(const QImage &pattern)
@@ -11,7 +13,9 @@ PatternImageData CreatePatternData(const QImage &pattern)
 		return data;
 	}
 
-	data.rgbaPattern = QImageToMat(pattern);
+	// Copy the pattern data so it does not depend on the lifetime of the
+	// provided image, which might be a temporary scaled version
+	data.rgbaPattern = QImageToMat(pattern).clone();
 	std::vector<cv::Mat1b> rgbaChannelsPattern;
 	cv::split(data.rgbaPattern, rgbaChannelsPattern);
 	std::vector<cv::Mat1b> rgbChanlesPattern(
@@ -24,45 +28,52 @@ PatternImageData CreatePatternData(const QImage &pattern)
 
 static void invertPatternMatchResult(cv::Mat &mat)
 {
-	for (int r = 0; r < mat.rows; r++) {
-		for (int c = 0; c < mat.cols; c++) {
-			mat.at<float>(r, c) = 1.0 - mat.at<float>(r, c);
-		}
-	}
+	cv::subtract(1.0, mat, mat);
 }
 
-void MatchPattern(QImage &img, const PatternImageData &patternData,
-		  double threshold, cv::Mat &result, bool useAlphaAsMask,
-		  cv::TemplateMatchModes matchMode)
+PatternMatchFrame::PatternMatchFrame(const QImage &img) : _image(img) {}
+
+cv::Mat PatternMatchFrame::Get(bool useAlphaAsMask, int level)
 {
-	if (img.isNull() || patternData.rgbaPattern.empty()) {
-		return;
-	}
-	if (img.height() < patternData.rgbaPattern.rows ||
-	    img.width() < patternData.rgbaPattern.cols) {
-		return;
-	}
+	std::lock_guard<std::mutex> lock(_mutex);
+	return get(useAlphaAsMask, level);
+}
 
-	auto input = QImageToMat(img);
+cv::Mat PatternMatchFrame::get(bool useAlphaAsMask, int level)
+{
+	const auto key = std::make_pair(useAlphaAsMask, level);
+	auto it = _converted.find(key);
+	if (it != _converted.end()) {
+		return it->second;
+	}
 
-	if (useAlphaAsMask) {
+	cv::Mat result;
+	if (level > 0) {
+		const double scale = 1.0 / (1 << level);
+		cv::resize(get(useAlphaAsMask, 0), result, cv::Size(), scale,
+			   scale, cv::INTER_AREA);
+	} else if (useAlphaAsMask) {
 		// Remove alpha channel of input image as the alpha channel
 		// information is used as a stencil for the pattern instead and
 		// thus should not be used while matching the pattern as well
 		//
 		// Input format is Format_RGBA8888 so discard the 4th channel
-		std::vector<cv::Mat1b> inputChannels;
-		cv::split(input, inputChannels);
-		std::vector<cv::Mat1b> rgbChanlesImage(
-			inputChannels.begin(), inputChannels.begin() + 3);
-		cv::Mat3b rgbInput;
-		cv::merge(rgbChanlesImage, rgbInput);
-
-		cv::matchTemplate(rgbInput, patternData.rgbPattern, result,
-				  matchMode, patternData.mask);
+		cv::cvtColor(QImageToMat(_image), result, cv::COLOR_RGBA2RGB);
 	} else {
-		cv::matchTemplate(input, patternData.rgbaPattern, result,
-				  matchMode);
+		result = QImageToMat(_image);
+	}
+	_converted[key] = result;
+	return result;
+}
+
+static void matchTemplate(const cv::Mat &input, const cv::Mat &pattern,
+			  const cv::Mat &mask, cv::Mat &result,
+			  cv::TemplateMatchModes matchMode)
+{
+	if (mask.empty()) {
+		cv::matchTemplate(input, pattern, result, matchMode);
+	} else {
+		cv::matchTemplate(input, pattern, result, matchMode, mask);
 	}
 
 	// A perfect match is represented as "0" for TM_SQDIFF_NORMED
@@ -72,9 +83,207 @@ void MatchPattern(QImage &img, const PatternImageData &patternData,
 	if (matchMode == cv::TM_SQDIFF_NORMED) {
 		invertPatternMatchResult(result);
 	}
+}
+
+PatternImageData CreatePatternData(PatternMatchFrame &frame,
+				   bool useAlphaAsMask)
+{
+	PatternImageData data{};
+	if (frame.Image().isNull()) {
+		return data;
+	}
+
+	data.rgbaPattern = QImageToMat(frame.Image()).clone();
+	if (useAlphaAsMask) {
+		data.rgbPattern = frame.Get(true);
+		cv::Mat1b alpha;
+		cv::extractChannel(data.rgbaPattern, alpha, 3);
+		cv::threshold(alpha, data.mask, 0, 255, cv::THRESH_BINARY);
+	}
+	return data;
+}
+
+void MatchPattern(QImage &img, const PatternImageData &patternData,
+		  double threshold, cv::Mat &result, bool useAlphaAsMask,
+		  cv::TemplateMatchModes matchMode)
+{
+	PatternMatchFrame frame(img);
+	MatchPattern(frame, patternData, threshold, result, useAlphaAsMask,
+		     matchMode);
+}
+
+void MatchPattern(PatternMatchFrame &frame,
+		  const PatternImageData &patternData, double threshold,
+		  cv::Mat &result, bool useAlphaAsMask,
+		  cv::TemplateMatchModes matchMode)
+{
+	const auto &img = frame.Image();
+	if (img.isNull() || patternData.rgbaPattern.empty()) {
+		return;
+	}
+	if (img.height() < patternData.rgbaPattern.rows ||
+	    img.width() < patternData.rgbaPattern.cols) {
+		return;
+	}
+
+	const auto input = frame.Get(useAlphaAsMask);
+	if (useAlphaAsMask) {
+		matchTemplate(input, patternData.rgbPattern, patternData.mask,
+			      result, matchMode);
+	} else {
+		matchTemplate(input, patternData.rgbaPattern, cv::Mat(), result,
+			      matchMode);
+	}
 	cv::threshold(result, result, threshold, 0.0, cv::THRESH_TOZERO);
 }
 
+// The coarse search is performed on an image scaled down by 2^level, with the
+// level chosen such that the pattern keeps at least this size
+constexpr int minCoarsePatternSize = 16;
+constexpr int maxPyramidLevel = 3;
+// Scaling the images down will lower the match values so candidates of the
+// coarse search have to pass a slightly relaxed threshold
+constexpr double coarseThresholdMargin = 0.1;
+constexpr int maxCoarseCandidates = 16;
+
+static int getPyramidLevel(const cv::Mat &pattern)
+{
+	int level = 0;
+	while (level < maxPyramidLevel &&
+	       (pattern.cols >> (level + 1)) >= minCoarsePatternSize &&
+	       (pattern.rows >> (level + 1)) >= minCoarsePatternSize) {
+		level++;
+	}
+	return level;
+}
+
+static bool getMatchAboveThreshold(const cv::Mat &result, double threshold,
+				   cv::Point &location)
+{
+	if (result.total() == 0) {
+		return false;
+	}
+	double maxVal = 0.;
+	cv::minMaxLoc(result, nullptr, &maxVal, nullptr, &location);
+	return maxVal > threshold;
+}
+
+static bool findPatternFullScale(const cv::Mat &input, const cv::Mat &pattern,
+				 const cv::Mat &mask, double threshold,
+				 cv::TemplateMatchModes matchMode,
+				 cv::Point &location)
+{
+	cv::Mat result;
+	matchTemplate(input, pattern, mask, result, matchMode);
+	cv::patchNaNs(result, 0.0);
+	return getMatchAboveThreshold(result, threshold, location);
+}
+
+// Searches for the pattern on a downscaled version of the image first and
+// then only checks the regions of the most promising candidates at full
+// scale. Stops at the first location matching the pattern.
+//
+// Fine details of the pattern might get lost when scaling it down, so if
+// none of the candidates matches and fullScaleFallback is set, the whole image
+// is searched at full scale.
+// This is too expensive to be done for every frame not containing the
+// pattern, so callers only request it periodically.
+bool FindPattern(PatternMatchFrame &frame, const PatternImageData &patternData,
+		 double threshold, bool useAlphaAsMask,
+		 cv::TemplateMatchModes matchMode, cv::Point &location,
+		 bool fullScaleFallback)
+{
+	if (frame.Image().isNull() || patternData.rgbaPattern.empty()) {
+		return false;
+	}
+	if (frame.Image().height() < patternData.rgbaPattern.rows ||
+	    frame.Image().width() < patternData.rgbaPattern.cols) {
+		return false;
+	}
+
+	const auto input = frame.Get(useAlphaAsMask);
+	const cv::Mat pattern = useAlphaAsMask
+					? cv::Mat(patternData.rgbPattern)
+					: cv::Mat(patternData.rgbaPattern);
+	const cv::Mat mask = useAlphaAsMask ? cv::Mat(patternData.mask)
+					    : cv::Mat();
+
+	const int level = getPyramidLevel(pattern);
+	if (level == 0) {
+		return findPatternFullScale(input, pattern, mask, threshold,
+					    matchMode, location);
+	}
+
+	const double scale = 1.0 / (1 << level);
+	const auto coarseInput = frame.Get(useAlphaAsMask, level);
+	cv::Mat coarsePattern, coarseMask;
+	cv::resize(pattern, coarsePattern, cv::Size(), scale, scale,
+		   cv::INTER_AREA);
+	if (!mask.empty()) {
+		cv::resize(mask, coarseMask, coarsePattern.size(), 0, 0,
+			   cv::INTER_NEAREST);
+	}
+	if (coarseInput.cols < coarsePattern.cols ||
+	    coarseInput.rows < coarsePattern.rows) {
+		return findPatternFullScale(input, pattern, mask, threshold,
+					    matchMode, location);
+	}
+
+	cv::Mat coarseResult;
+	matchTemplate(coarseInput, coarsePattern, coarseMask, coarseResult,
+		      matchMode);
+	cv::patchNaNs(coarseResult, 0.0);
+
+	const int factor = 1 << level;
+	const int maxX = input.cols - pattern.cols;
+	const int maxY = input.rows - pattern.rows;
+	const double coarseThreshold = threshold - coarseThresholdMargin;
+
+	for (int i = 0; i < maxCoarseCandidates; i++) {
+		cv::Point candidate;
+		if (!getMatchAboveThreshold(coarseResult, coarseThreshold,
+					    candidate)) {
+			break;
+		}
+
+		// Do not revisit this candidate or its direct neighbours as
+		// they are covered by the refinement search area already
+		cv::rectangle(coarseResult,
+			      cv::Rect(candidate.x - 1, candidate.y - 1, 3, 3),
+			      cv::Scalar(-1.0), cv::FILLED);
+
+		// Refine the search in the area around the candidate
+		const int x0 =
+			std::clamp(candidate.x * factor - factor, 0, maxX);
+		const int y0 =
+			std::clamp(candidate.y * factor - factor, 0, maxY);
+		const int x1 =
+			std::clamp(candidate.x * factor + factor, 0, maxX);
+		const int y1 =
+			std::clamp(candidate.y * factor + factor, 0, maxY);
+		const cv::Rect region(x0, y0, x1 - x0 + pattern.cols,
+				      y1 - y0 + pattern.rows);
+		if (findPatternFullScale(input(region), pattern, mask,
+					 threshold, matchMode, location)) {
+			location += region.tl();
+			return true;
+		}
+	}
+	return fullScaleFallback &&
+	       findPatternFullScale(input, pattern, mask, threshold, matchMode,
+				    location);
+}
+
+bool FindPattern(QImage &img, const PatternImageData &patternData,
+		 double threshold, bool useAlphaAsMask,
+		 cv::TemplateMatchModes matchMode, cv::Point &location,
+		 bool fullScaleFallback)
+{
+	PatternMatchFrame frame(img);
+	return FindPattern(frame, patternData, threshold, useAlphaAsMask,
+			   matchMode, location, fullScaleFallback);
+}
+
 void MatchPattern(QImage &img, QImage &pattern, double threshold,
 		  cv::Mat &result, bool useAlphaAsMask,
 		  cv::TemplateMatchModes matchColor)
@@ -112,110 +321,120 @@ uchar GetAvgBrightness(QImage &img)
 		return 0;
 	}
 
+	// The value channel of the HSV color space is the maximum of the RGB
+	// channels, so there is no need to perform a full conversion
 	auto image = QImageToMat(img);
-	cv::Mat hsvImage, rgbImage;
-	cv::cvtColor(image, rgbImage, cv::COLOR_RGBA2RGB);
-	cv::cvtColor(rgbImage, hsvImage, cv::COLOR_RGB2HSV);
-	long long brightnessSum = 0;
-	for (int i = 0; i < hsvImage.rows; ++i) {
-		for (int j = 0; j < hsvImage.cols; ++j) {
-			brightnessSum += hsvImage.at<cv::Vec3b>(i, j)[2];
-		}
-	}
-	return brightnessSum / (hsvImage.rows * hsvImage.cols);
+	std::vector<cv::Mat1b> channels;
+	cv::split(image, channels);
+	cv::Mat1b value;
+	cv::max(channels[0], channels[1], value);
+	cv::max(value, channels[2], value);
+	const auto brightnessSum = static_cast<long long>(cv::sum(value)[0]);
+	return brightnessSum / (value.rows * value.cols);
 }
 
-static bool colorIsSimilar(const QColor &color1, const QColor &color2,
-			   int maxDiff)
+// Returns a mask in which all pixels of the RGBA input image are set, whose
+// RGB channels each differ by at most maxDiff from the given color
+static cv::Mat1b getColorRangeMask(const cv::Mat &image, const QColor &color,
+				   int maxDiff)
 {
-	const int diffRed = std::abs(color1.red() - color2.red());
-	const int diffGreen = std::abs(color1.green() - color2.green());
-	const int diffBlue = std::abs(color1.blue() - color2.blue());
-
-	return diffRed <= maxDiff && diffGreen <= maxDiff &&
-	       diffBlue <= maxDiff;
+	const cv::Scalar lower(color.red() - maxDiff, color.green() - maxDiff,
+			       color.blue() - maxDiff, 0);
+	const cv::Scalar upper(color.red() + maxDiff, color.green() + maxDiff,
+			       color.blue() + maxDiff, 255);
+	cv::Mat1b mask;
+	cv::inRange(image, lower, upper, mask);
+	return mask;
 }
 
-cv::Mat PreprocessForOCR(const QImage &image, const QColor &textColor,
-			 double colorDiff)
+cv::Mat1b PreprocessForOCR(const QImage &image, const QColor &textColor,
+			   double colorDiff)
 {
-	auto mat = QImageToMat(image);
-
 	// Tesseract works best when matching black text on a white background,
 	// so everything that matches the text color will be displayed black
 	// while the rest of the image should be white.
 	const int diff = colorDiff * 255;
-	for (int y = 0; y < image.height(); y++) {
-		for (int x = 0; x < image.width(); x++) {
-			if (colorIsSimilar(image.pixelColor(x, y), textColor,
-					   diff)) {
-				mat.at<cv::Vec4b>(y, x) = {0, 0, 0, 255};
-			} else {
-				mat.at<cv::Vec4b>(y, x) = {255, 255, 255, 255};
-			}
-		}
-	}
+	const auto mask =
+		getColorRangeMask(QImageToMat(image), textColor, diff);
+	cv::Mat1b mat(mask.size(), 255);
+	mat.setTo(0, mask);
+	return mat;
+}
 
-	// Scale image up if selected area is very small.
-	// Results will probably still be unsatisfying.
-	if (mat.rows <= 300 || mat.cols <= 300) {
-		double scale = 0.;
-		if (mat.rows < mat.cols) {
-			scale = 300. / mat.rows;
-		} else {
-			scale = 300. / mat.cols;
-		}
-		cv::resize(mat, mat,
-			   cv::Size(mat.cols * scale, mat.rows * scale),
-			   cv::INTER_CUBIC);
+// Grayscale means of blocks of 16x16 pixels, which can be used to cheaply
+// check whether the content of two frames differs.
+// Each block covers only a small part of the frame, so local changes, like a
+// small overlay appearing, are not averaged away.
+cv::Mat1b CreateFrameSignature(const QImage &img)
+{
+	if (img.isNull()) {
+		return {};
 	}
 
-	cv::Mat result;
-	mat.copyTo(result);
-	return result;
+	constexpr int blockSize = 16;
+	const cv::Size size(std::max(1, img.width() / blockSize),
+			    std::max(1, img.height() / blockSize));
+	cv::Mat means;
+	cv::resize(QImageToMat(img), means, size, 0, 0, cv::INTER_AREA);
+	cv::Mat1b signature;
+	cv::cvtColor(means, signature, cv::COLOR_RGBA2GRAY);
+	return signature;
 }
 
-std::string RunOCR(tesseract::TessBaseAPI *ocr, const QImage &image,
-		   const QColor &color, double colorDiff)
+// Returns the largest difference of any block of the signatures in the range
+// [0, 1]
+double GetFrameSignatureDifference(const cv::Mat1b &a, const cv::Mat1b &b)
 {
-	if (image.isNull()) {
-		return "";
+	if (a.empty() || b.empty() || a.size() != b.size()) {
+		return 1.0;
 	}
+	return cv::norm(a, b, cv::NORM_INF) / 255.0;
+}
 
-#ifdef OCR_SUPPORT
-	auto mat = PreprocessForOCR(image, color, colorDiff);
-	cv::Mat gray;
-	cv::cvtColor(mat, gray, cv::COLOR_RGBA2GRAY);
-	ocr->SetImage(gray.data, gray.cols, gray.rows, 1, gray.step);
-	ocr->Recognize(0);
-	std::unique_ptr<char[]> detectedText(ocr->GetUTF8Text());
-
-	if (!detectedText) {
-		return "";
+// Averages blocks of 8x8 pixels, which removes most of the noise introduced
+// by video encoding while still keeping local changes visible
+cv::Mat CreateBlockMeans(const QImage &img)
+{
+	if (img.isNull()) {
+		return {};
 	}
-	return detectedText.get();
 
-#else
-	return "";
-#endif
+	constexpr int blockSize = 8;
+	const cv::Size size(std::max(1, img.width() / blockSize),
+			    std::max(1, img.height() / blockSize));
+	cv::Mat means;
+	cv::resize(QImageToMat(img), means, size, 0, 0, cv::INTER_AREA);
+	return means;
+}
+
+// Returns the largest difference of any color channel of any block in the
+// range [0, 1]
+double GetBlockMeanDifference(const cv::Mat &a, const cv::Mat &b)
+{
+	if (a.empty() || b.empty() || a.size() != b.size() ||
+	    a.type() != b.type()) {
+		return 1.0;
+	}
+	cv::Mat diff;
+	cv::absdiff(a, b, diff);
+	double maxDiff = 0.;
+	cv::minMaxLoc(diff.reshape(1), nullptr, &maxDiff);
+	return maxDiff / 255.0;
 }
 
 bool ContainsPixelsInColorRange(const QImage &image, const QColor &color,
 				double colorDeviationThreshold,
 				double totalPixelMatchThreshold)
 {
+	if (image.isNull()) {
+		return false;
+	}
+
 	int totalPixels = image.width() * image.height();
-	int matchingPixels = 0;
 	int maxColorDiff = static_cast<int>(colorDeviationThreshold * 255.0);
-
-	for (int y = 0; y < image.height(); y++) {
-		for (int x = 0; x < image.width(); x++) {
-			if (colorIsSimilar(image.pixelColor(x, y), color,
-					   maxColorDiff)) {
-				matchingPixels++;
-			}
-		}
-	}
+	const auto mask =
+		getColorRangeMask(QImageToMat(image), color, maxColorDiff);
+	int matchingPixels = cv::countNonZero(mask);
 
 	double matchPercentage =
 		static_cast<double>(matchingPixels) / totalPixels;
@@ -2,6 +2,8 @@
 #include <QImage>
 #undef NO // MacOS macro that can conflict with OpenCV
 #include <opencv2/opencv.hpp>
+#include <map>
+#include <mutex>
 
 #ifdef OCR_SUPPORT
 #include <tesseract/baseapi.h>
@@ -47,22 +49,66 @@ struct PatternImageData {
 	cv::Mat1b mask;
 };
 
+// Frame converted into the format used for pattern matching.
+// This allows matching multiple patterns against the same frame without
+// converting it again for each of them.
+// Downscaled versions used for the coarse search are created on demand and
+// shared by all patterns.
+class PatternMatchFrame {
+public:
+	PatternMatchFrame(const QImage &img);
+	const QImage &Image() const { return _image; }
+	cv::Mat Get(bool useAlphaAsMask, int level = 0);
+
+private:
+	cv::Mat get(bool useAlphaAsMask, int level);
+
+	QImage _image;
+	std::mutex _mutex;
+	std::map<std::pair<bool, int>, cv::Mat> _converted;
+};
+
 PatternImageData CreatePatternData(const QImage &pattern);
+// Only creates the data required for the given mode and reuses the
+// conversions of the frame which were already done to match patterns against
+// it
+PatternImageData CreatePatternData(PatternMatchFrame &frame,
+				   bool useAlphaAsMask);
 void MatchPattern(QImage &img, const PatternImageData &patternData,
 		  double threshold, cv::Mat &result, bool useAlphaAsMask,
 		  cv::TemplateMatchModes matchMode);
+void MatchPattern(PatternMatchFrame &frame,
+		  const PatternImageData &patternData, double threshold,
+		  cv::Mat &result, bool useAlphaAsMask,
+		  cv::TemplateMatchModes matchMode);
 void MatchPattern(QImage &img, QImage &pattern, double threshold,
 		  cv::Mat &result, bool useAlphaAsMask,
 		  cv::TemplateMatchModes matchMode);
+// Finding a pattern is sped up by searching a downscaled image first, which
+// might miss patterns with very fine details.
+// Callers should therefore set fullScaleFallback every
+// fullScalePatternSearchInterval consecutive misses to search the whole image
+// at full scale if the downscaled search does not find the pattern.
+constexpr int fullScalePatternSearchInterval = 10;
+bool FindPattern(QImage &img, const PatternImageData &patternData,
+		 double threshold, bool useAlphaAsMask,
+		 cv::TemplateMatchModes matchMode, cv::Point &location,
+		 bool fullScaleFallback = false);
+bool FindPattern(PatternMatchFrame &frame, const PatternImageData &patternData,
+		 double threshold, bool useAlphaAsMask,
+		 cv::TemplateMatchModes matchMode, cv::Point &location,
+		 bool fullScaleFallback = false);
 std::vector<cv::Rect> MatchObject(QImage &img, cv::CascadeClassifier &cascade,
 				  double scaleFactor, int minNeighbors,
 				  const cv::Size &minSize,
 				  const cv::Size &maxSize);
 uchar GetAvgBrightness(QImage &img);
-cv::Mat PreprocessForOCR(const QImage &image, const QColor &color,
-			 double colorDiff);
-std::string RunOCR(tesseract::TessBaseAPI *, const QImage &, const QColor &,
-		   double colorDiff);
+cv::Mat1b PreprocessForOCR(const QImage &image, const QColor &color,
+			   double colorDiff);
+cv::Mat1b CreateFrameSignature(const QImage &img);
+double GetFrameSignatureDifference(const cv::Mat1b &, const cv::Mat1b &);
+cv::Mat CreateBlockMeans(const QImage &img);
+double GetBlockMeanDifference(const cv::Mat &, const cv::Mat &);
 bool ContainsPixelsInColorRange(const QImage &image, const QColor &color,
 				double colorDeviationThreshold,
 				double totalPixelMatchThreshold);
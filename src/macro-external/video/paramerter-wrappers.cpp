@@ -11,6 +11,7 @@ bool PatternMatchParameters::Save(obs_data_t *obj) const
 	threshold.Save(data, "threshold");
 	obs_data_set_bool(data, "useAlphaAsMask", useAlphaAsMask);
 	obs_data_set_int(data, "matchMode", matchMode);
+	obs_data_set_bool(data, "batch", batch);
 	obs_data_set_int(data, "version", 1);
 	obs_data_set_obj(obj, "patternMatchData", data);
 	obs_data_release(data);
@@ -42,6 +43,7 @@ bool PatternMatchParameters::Load(obs_data_t *obj)
 		matchMode = static_cast<cv::TemplateMatchModes>(
 			obs_data_get_int(data, "matchMode"));
 	}
+	batch = obs_data_get_bool(data, "batch");
 	obs_data_release(data);
 	return true;
 }
@@ -232,50 +234,6 @@ static QColor LoadColor(obs_data_t *obj, const char *name)
 	return color;
 }
 
-OCRParameters::OCRParameters()
-{
-	Setup();
-}
-
-OCRParameters::~OCRParameters()
-{
-	if (!initDone) {
-		return;
-	}
-	ocr->End();
-}
-
-OCRParameters::OCRParameters(const OCRParameters &other)
-	: text(other.text),
-	  regex(other.regex),
-	  color(other.color),
-	  colorThreshold(other.colorThreshold),
-	  pageSegMode(other.pageSegMode)
-{
-	if (!initDone) {
-		Setup();
-	}
-	if (initDone) {
-		ocr->SetPageSegMode(pageSegMode);
-	}
-}
-
-OCRParameters &OCRParameters::operator=(const OCRParameters &other)
-{
-	text = other.text;
-	regex = other.regex;
-	color = other.color;
-	colorThreshold = other.colorThreshold;
-	pageSegMode = other.pageSegMode;
-	if (!initDone) {
-		Setup();
-	}
-	if (initDone) {
-		ocr->SetPageSegMode(pageSegMode);
-	}
-	return *this;
-}
-
 bool OCRParameters::Save(obs_data_t *obj) const
 {
 	auto data = obs_data_create();
@@ -305,17 +263,12 @@ bool OCRParameters::Load(obs_data_t *obj)
 	pageSegMode = static_cast<tesseract::PageSegMode>(
 		obs_data_get_int(data, "pageSegMode"));
 	obs_data_release(data);
-
-	if (initDone) {
-		ocr->SetPageSegMode(pageSegMode);
-	}
 	return true;
 }
 
 void OCRParameters::SetPageMode(tesseract::PageSegMode mode)
 {
 	pageSegMode = mode;
-	ocr->SetPageSegMode(mode);
 }
 
 bool OCRParameters::SetLanguageCode(const std::string &value)
@@ -326,8 +279,7 @@ bool OCRParameters::SetLanguageCode(const std::string &value)
 	if (!std::filesystem::exists(dataPath)) {
 		return false;
 	}
-	Setup();
-	ocr->SetPageSegMode(pageSegMode);
+	languageCode = value;
 	return true;
 }
 
@@ -336,22 +288,6 @@ std::string OCRParameters::GetLanguageCode() const
 	return languageCode;
 }
 
-void OCRParameters::Setup()
-{
-	ocr = std::make_unique<tesseract::TessBaseAPI>();
-	if (!ocr) {
-		initDone = false;
-		return;
-	}
-	std::string dataPath = obs_get_module_data_path(obs_current_module()) +
-			       std::string("/res/ocr");
-	if (ocr->Init(dataPath.c_str(), languageCode.c_str()) != 0) {
-		initDone = false;
-		return;
-	}
-	initDone = true;
-}
-
 bool ColorParameters::Save(obs_data_t *obj) const
 {
 	auto data = obs_data_create();
@@ -373,4 +309,77 @@ bool ColorParameters::Load(obs_data_t *obj)
 	return true;
 }
 
+bool ScaleParameters::Save(obs_data_t *obj) const
+{
+	auto data = obs_data_create();
+	obs_data_set_int(data, "type", static_cast<int>(type));
+	factor.Save(data, "factor");
+	width.Save(data, "width");
+	obs_data_set_obj(obj, "scaleData", data);
+	obs_data_release(data);
+	return true;
+}
+
+bool ScaleParameters::Load(obs_data_t *obj)
+{
+	if (!obs_data_has_user_value(obj, "scaleData")) {
+		type = Type::FULL_RESOLUTION;
+		return true;
+	}
+	auto data = obs_data_get_obj(obj, "scaleData");
+	type = static_cast<Type>(obs_data_get_int(data, "type"));
+	factor.Load(data, "factor");
+	width.Load(data, "width");
+	obs_data_release(data);
+	return true;
+}
+
+double ScaleParameters::GetScaleFactor(uint32_t inputWidth) const
+{
+	double scale = 1.0;
+	switch (type) {
+	case Type::FULL_RESOLUTION:
+		return 1.0;
+	case Type::FACTOR:
+		scale = factor;
+		break;
+	case Type::FIXED_WIDTH:
+		if (inputWidth == 0 || width <= 0) {
+			return 1.0;
+		}
+		scale = static_cast<double>(width) / inputWidth;
+		break;
+	}
+
+	// Upscaling will not improve the analysis results
+	if (scale <= 0.0 || scale > 1.0) {
+		return 1.0;
+	}
+	return scale;
+}
+
+bool SimilarityParameters::Save(obs_data_t *obj) const
+{
+	auto data = obs_data_create();
+	obs_data_set_bool(data, "enabled", enable);
+	tolerance.Save(data, "tolerance");
+	obs_data_set_obj(obj, "similarityData", data);
+	obs_data_release(data);
+	return true;
+}
+
+bool SimilarityParameters::Load(obs_data_t *obj)
+{
+	if (!obs_data_has_user_value(obj, "similarityData")) {
+		enable = false;
+		tolerance = 0.05;
+		return true;
+	}
+	auto data = obs_data_get_obj(obj, "similarityData");
+	enable = obs_data_get_bool(data, "enabled");
+	tolerance.Load(data, "tolerance");
+	obs_data_release(data);
+	return true;
+}
+
 } // namespace advss
@@ -1,6 +1,7 @@
 #pragma once
 #include "opencv-helpers.hpp"
 #include "area-selection.hpp"
+#include "video-resource-cache.hpp"
 
 #include <source-selection.hpp>
 #include <scene-selection.hpp>
@@ -60,6 +61,9 @@ public:
 	bool useAlphaAsMask = false;
 	cv::TemplateMatchModes matchMode = cv::TM_CCORR_NORMED;
 	NumberVariable<double> threshold = 0.8;
+	// Match together with the other pattern conditions using the same
+	// video input
+	bool batch = false;
 };
 
 class ObjDetectParameters {
@@ -71,7 +75,7 @@ public:
 		obs_get_module_data_path(obs_current_module()) +
 		std::string(
 			"/res/cascadeClassifiers/haarcascade_frontalface_alt.xml");
-	cv::CascadeClassifier cascade;
+	std::shared_ptr<CascadeModel> cascade;
 	NumberVariable<double> scaleFactor = defaultScaleFactor;
 	int minNeighbors = minMinNeighbors;
 	Size minSize{0, 0};
@@ -80,20 +84,13 @@ public:
 
 class OCRParameters {
 public:
-	OCRParameters();
-	~OCRParameters();
-	OCRParameters(const OCRParameters &other);
-	OCRParameters &operator=(const OCRParameters &);
-
 	bool Save(obs_data_t *obj) const;
 	bool Load(obs_data_t *obj);
 
-	bool Initialized() const { return initDone; }
 	void SetPageMode(tesseract::PageSegMode);
 	bool SetLanguageCode(const std::string &);
 	std::string GetLanguageCode() const;
 	tesseract::PageSegMode GetPageMode() const { return pageSegMode; }
-	tesseract::TessBaseAPI *GetOCR() const { return ocr.get(); }
 
 	StringVariable text = obs_module_text("AdvSceneSwitcher.enterText");
 	RegexConfig regex = RegexConfig::PartialMatchRegexConfig();
@@ -102,11 +99,7 @@ public:
 	StringVariable languageCode = "eng";
 
 private:
-	void Setup();
-
 	tesseract::PageSegMode pageSegMode = tesseract::PSM_SINGLE_BLOCK;
-	std::unique_ptr<tesseract::TessBaseAPI> ocr;
-	bool initDone = false;
 };
 
 class ColorParameters {
@@ -128,6 +121,36 @@ public:
 	advss::Area area{0, 0, 0, 0};
 };
 
+class ScaleParameters {
+public:
+	bool Save(obs_data_t *obj) const;
+	bool Load(obs_data_t *obj);
+
+	// Returns the factor in the range (0, 1] the input should be scaled by
+	double GetScaleFactor(uint32_t inputWidth) const;
+
+	enum class Type {
+		FULL_RESOLUTION,
+		FACTOR,
+		FIXED_WIDTH,
+	};
+
+	Type type = Type::FULL_RESOLUTION;
+	DoubleVariable factor = 0.5;
+	IntVariable width = 480;
+};
+
+// Exact comparisons of images will fail due to the noise introduced by video
+// encoding, so images can instead be compared by their block means
+class SimilarityParameters {
+public:
+	bool Save(obs_data_t *obj) const;
+	bool Load(obs_data_t *obj);
+
+	bool enable = false;
+	DoubleVariable tolerance = 0.05;
+};
+
 } // namespace advss
 
 Q_DECLARE_METATYPE(advss::OCRParameters)
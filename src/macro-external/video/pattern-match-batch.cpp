@@ -0,0 +1,263 @@
+#include "pattern-match-batch.hpp"
+#include "video-analysis.hpp"
+
+#include <screenshot-helper.hpp>
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace advss {
+
+namespace {
+
+struct BatchEntry {
+	PatternImageData pattern;
+	double threshold = 0.8;
+	bool useAlphaAsMask = false;
+	cv::TemplateMatchModes matchMode = cv::TM_CCORR_NORMED;
+	uint64_t generation = 0;
+	std::optional<BatchedPatternResult> result;
+	// Consecutive matches without finding the pattern
+	int misses = 0;
+};
+
+struct PendingMatch {
+	uint64_t id;
+	BatchEntry entry;
+	BatchedPatternResult result;
+	bool fullScaleFallback = false;
+};
+
+} // namespace
+
+class PatternMatchBatch
+	: public std::enable_shared_from_this<PatternMatchBatch> {
+public:
+	PatternMatchBatch(const OBSWeakSource &source, const QRect &area,
+			  double scale);
+	bool UsesInput(const OBSWeakSource &source, const QRect &area,
+		       double scale) const;
+	uint64_t Add();
+	void Remove(uint64_t id);
+	void SetPattern(uint64_t id, const PatternImageData &, double threshold,
+			bool useAlphaAsMask, cv::TemplateMatchModes);
+	void Update();
+	std::optional<BatchedPatternResult> TakeResult(uint64_t id);
+	void DiscardPendingResult(uint64_t id);
+
+private:
+	void GetScreenshot();
+	void Match(const QImage &, std::vector<PendingMatch> &);
+
+	const OBSWeakSource _source;
+	const QRect _area;
+	const double _scale;
+
+	std::mutex _mutex;
+	std::unique_ptr<ScreenshotHelper> _screenshot;
+	bool _busy = false;
+	std::map<uint64_t, BatchEntry> _entries;
+	uint64_t _nextId = 0;
+};
+
+PatternMatchBatch::PatternMatchBatch(const OBSWeakSource &source,
+				     const QRect &area, double scale)
+	: _source(source), _area(area), _scale(scale)
+{
+}
+
+bool PatternMatchBatch::UsesInput(const OBSWeakSource &source,
+				  const QRect &area, double scale) const
+{
+	return _source == source && _area == area && _scale == scale;
+}
+
+uint64_t PatternMatchBatch::Add()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	const auto id = _nextId++;
+	_entries[id] = {};
+	return id;
+}
+
+void PatternMatchBatch::Remove(uint64_t id)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_entries.erase(id);
+}
+
+void PatternMatchBatch::SetPattern(uint64_t id,
+				   const PatternImageData &pattern,
+				   double threshold, bool useAlphaAsMask,
+				   cv::TemplateMatchModes matchMode)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto &entry = _entries[id];
+	entry.pattern = pattern;
+	entry.threshold = threshold;
+	entry.useAlphaAsMask = useAlphaAsMask;
+	entry.matchMode = matchMode;
+}
+
+void PatternMatchBatch::Update()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_screenshot) {
+		GetScreenshot();
+		return;
+	}
+	if (!_screenshot->done || _busy) {
+		return;
+	}
+
+	std::vector<PendingMatch> matches;
+	for (const auto &[id, entry] : _entries) {
+		if (entry.pattern.rgbaPattern.empty()) {
+			continue;
+		}
+		PendingMatch match{id, entry, {},
+				   entry.misses ==
+					   fullScalePatternSearchInterval - 1};
+		match.entry.result.reset();
+		match.result.captureTime = _screenshot->time;
+		matches.emplace_back(std::move(match));
+	}
+
+	_busy = true;
+	auto batch = shared_from_this();
+	auto image = std::move(_screenshot->image);
+	StartVideoAnalysisJob([batch, image, matches]() mutable {
+		batch->Match(image, matches);
+	});
+	GetScreenshot();
+}
+
+void PatternMatchBatch::GetScreenshot()
+{
+	auto source = obs_weak_source_get_source(_source);
+	_screenshot = std::make_unique<ScreenshotHelper>(source, _area, false,
+							 0, false, "", _scale);
+	obs_source_release(source);
+}
+
+void PatternMatchBatch::Match(const QImage &image,
+			      std::vector<PendingMatch> &matches)
+{
+	// The frame is only converted once and shared by all patterns
+	PatternMatchFrame frame(image);
+	auto matchRange = [&frame, &matches](const cv::Range &range) {
+		for (int i = range.start; i < range.end; i++) {
+			auto &match = matches[i];
+			const auto &entry = match.entry;
+			match.result.match = FindPattern(
+				frame, entry.pattern, entry.threshold,
+				entry.useAlphaAsMask, entry.matchMode,
+				match.result.location, match.fullScaleFallback);
+		}
+	};
+	cv::parallel_for_(cv::Range(0, static_cast<int>(matches.size())),
+			  matchRange);
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_busy = false;
+	for (const auto &match : matches) {
+		auto it = _entries.find(match.id);
+		if (it == _entries.end() ||
+		    it->second.generation != match.entry.generation) {
+			continue;
+		}
+		it->second.result = match.result;
+		auto &misses = it->second.misses;
+		misses = match.result.match ? 0 : misses + 1;
+		misses %= fullScalePatternSearchInterval;
+	}
+}
+
+std::optional<BatchedPatternResult> PatternMatchBatch::TakeResult(uint64_t id)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _entries.find(id);
+	if (it == _entries.end()) {
+		return {};
+	}
+	auto result = std::move(it->second.result);
+	it->second.result.reset();
+	return result;
+}
+
+void PatternMatchBatch::DiscardPendingResult(uint64_t id)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _entries.find(id);
+	if (it == _entries.end()) {
+		return;
+	}
+	++it->second.generation;
+	it->second.result.reset();
+}
+
+static std::mutex batchesMutex;
+static std::vector<std::weak_ptr<PatternMatchBatch>> batches;
+
+static std::shared_ptr<PatternMatchBatch>
+getBatch(const OBSWeakSource &source, const QRect &area, double scale)
+{
+	std::lock_guard<std::mutex> lock(batchesMutex);
+	batches.erase(std::remove_if(batches.begin(), batches.end(),
+				     [](const auto &batch) {
+					     return batch.expired();
+				     }),
+		      batches.end());
+	for (const auto &weakBatch : batches) {
+		auto batch = weakBatch.lock();
+		if (batch && batch->UsesInput(source, area, scale)) {
+			return batch;
+		}
+	}
+	auto batch = std::make_shared<PatternMatchBatch>(source, area, scale);
+	batches.emplace_back(batch);
+	return batch;
+}
+
+BatchedPattern::BatchedPattern(const OBSWeakSource &source, const QRect &area,
+			       double scale)
+	: _batch(getBatch(source, area, scale)), _id(_batch->Add())
+{
+}
+
+BatchedPattern::~BatchedPattern()
+{
+	_batch->Remove(_id);
+}
+
+bool BatchedPattern::UsesInput(const OBSWeakSource &source, const QRect &area,
+			       double scale) const
+{
+	return _batch->UsesInput(source, area, scale);
+}
+
+void BatchedPattern::SetPattern(const PatternImageData &pattern,
+				double threshold, bool useAlphaAsMask,
+				cv::TemplateMatchModes matchMode)
+{
+	_batch->SetPattern(_id, pattern, threshold, useAlphaAsMask, matchMode);
+}
+
+void BatchedPattern::Update()
+{
+	_batch->Update();
+}
+
+std::optional<BatchedPatternResult> BatchedPattern::TakeResult()
+{
+	return _batch->TakeResult(_id);
+}
+
+void BatchedPattern::DiscardPendingResult()
+{
+	_batch->DiscardPendingResult(_id);
+}
+
+} // namespace advss
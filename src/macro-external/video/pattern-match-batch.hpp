@@ -0,0 +1,50 @@
+#pragma once
+#include "opencv-helpers.hpp"
+
+#include <obs.hpp>
+#include <QRect>
+#include <chrono>
+#include <memory>
+#include <optional>
+
+namespace advss {
+
+class PatternMatchBatch;
+
+struct BatchedPatternResult {
+	bool match = false;
+	cv::Point location;
+	std::chrono::high_resolution_clock::time_point captureTime;
+};
+
+// Pattern which is matched together with all other batched patterns using the
+// same video input, area and scale.
+// The screenshot is only taken and converted once for all patterns of a batch
+// and the patterns are matched against it in parallel.
+class BatchedPattern {
+public:
+	BatchedPattern(const OBSWeakSource &, const QRect &area, double scale);
+	~BatchedPattern();
+	BatchedPattern(const BatchedPattern &) = delete;
+	BatchedPattern &operator=(const BatchedPattern &) = delete;
+
+	bool UsesInput(const OBSWeakSource &, const QRect &area,
+		       double scale) const;
+	void SetPattern(const PatternImageData &, double threshold,
+			bool useAlphaAsMask, cv::TemplateMatchModes);
+	// Starts matching all patterns of the batch against the last screenshot
+	// and requests the next one, unless another pattern of the batch did so
+	// already
+	void Update();
+	// Returns the result of the last finished match if it was not
+	// retrieved yet
+	std::optional<BatchedPatternResult> TakeResult();
+	// Results of matches which are still in progress will be dropped
+	void DiscardPendingResult();
+
+private:
+	std::shared_ptr<PatternMatchBatch> _batch;
+	uint64_t _id;
+};
+
+} // namespace advss
@@ -1,12 +1,18 @@
 #include "preview-dialog.hpp"
 
+#include "ocr-helpers.hpp"
 #include "opencv-helpers.hpp"
 #include "utility.hpp"
 
-#include <screenshot-helper.hpp>
+#include <algorithm>
 
 namespace advss {
 
+// The preview is refreshed at most this often, but the refresh rate is lowered
+// further if creating the preview takes a long time
+constexpr int minRefreshIntervalMs = 33;
+constexpr int maxRefreshIntervalMs = 1000;
+
 PreviewDialog::PreviewDialog(QWidget *parent)
 	: QDialog(parent),
 	  _scrollArea(new QScrollArea),
@@ -40,6 +46,10 @@ PreviewDialog::PreviewDialog(QWidget *parent)
 	layout->addWidget(_statusLabel);
 	layout->addWidget(_scrollArea);
 	setLayout(layout);
+
+	_refreshTimer.setSingleShot(true);
+	connect(&_refreshTimer, &QTimer::timeout, this,
+		&PreviewDialog::RequestImage);
 }
 
 void PreviewDialog::mousePressEvent(QMouseEvent *event)
@@ -108,6 +118,7 @@ void PreviewDialog::SelectArea()
 
 void PreviewDialog::Stop()
 {
+	_refreshTimer.stop();
 	_thread.quit();
 	_thread.wait();
 }
@@ -163,13 +174,32 @@ void PreviewDialog::UpdateStatus(const QString &status)
 	_statusLabel->setText(status);
 }
 
-void PreviewDialog::UpdateImage(const QPixmap &image)
+void PreviewDialog::UpdateImage(const QImage &image)
 {
-	_imageLabel->setPixmap(image);
+	_imageLabel->setPixmap(QPixmap::fromImage(image));
 	_imageLabel->adjustSize();
 	if (_type == PreviewType::SELECT_AREA && !_selectingArea) {
 		DrawFrame();
 	}
+	if (!_thread.isRunning()) {
+		return;
+	}
+
+	// Keep the worker idle for at least as long as it took to create the
+	// image to limit the impact on the performance of OBS
+	const auto elapsed =
+		std::chrono::duration_cast<std::chrono::milliseconds>(
+			std::chrono::high_resolution_clock::now() -
+			_requestTime)
+			.count();
+	_refreshTimer.start(std::clamp(static_cast<int>(elapsed),
+				       minRefreshIntervalMs,
+				       maxRefreshIntervalMs));
+}
+
+void PreviewDialog::RequestImage()
+{
+	_requestTime = std::chrono::high_resolution_clock::now();
 	emit NeedImage(_video, _type, _patternMatchParams, _patternImageData,
 		       _objDetectParams, _ocrParams, _areaParams, _condition);
 }
@@ -198,8 +228,7 @@ void PreviewDialog::Start()
 		&PreviewImage::CreateImage);
 	_thread.start();
 
-	emit NeedImage(_video, _type, _patternMatchParams, _patternImageData,
-		       _objDetectParams, _ocrParams, _areaParams, _condition);
+	RequestImage();
 }
 
 void PreviewDialog::DrawFrame()
@@ -254,39 +283,49 @@ void PreviewImage::CreateImage(const VideoInput &video, PreviewType type,
 			       const AreaParameters &areaParams,
 			       VideoCondition condition)
 {
-	auto source = obs_weak_source_get_source(video.GetVideo());
-	ScreenshotHelper screenshot(source, true);
-	obs_source_release(source);
+	// Only the selected area is of interest when showing matches, but the
+	// full frame is required to be able to select a new area
+	const QRect area =
+		(type == PreviewType::SHOW_MATCH && areaParams.enable)
+			? areaParams.area.Qt()
+			: QRect();
+	if (_screenshot && _screenshotSource == video.GetVideo() &&
+	    _screenshotArea == area) {
+		_screenshot->Retake(true);
+	} else {
+		auto source = obs_weak_source_get_source(video.GetVideo());
+		_screenshot =
+			std::make_unique<ScreenshotHelper>(source, area, true);
+		obs_source_release(source);
+		_screenshotSource = video.GetVideo();
+		_screenshotArea = area;
+	}
 
-	if (!video.ValidSelection() || !screenshot.done) {
+	if (!video.ValidSelection() || !_screenshot->done) {
 		emit StatusUpdate(obs_module_text(
 			"AdvSceneSwitcher.condition.video.screenshotFail"));
-		emit ImageReady(QPixmap());
+		emit ImageReady(QImage());
 		return;
 	}
 
-	if (screenshot.image.width() == 0 || screenshot.image.height() == 0) {
+	auto &image = _screenshot->image;
+	if (image.width() == 0 || image.height() == 0) {
 		emit StatusUpdate(obs_module_text(
 			"AdvSceneSwitcher.condition.video.screenshotEmpty"));
-		emit ImageReady(QPixmap());
+		emit ImageReady(QImage());
 		return;
 	}
 
 	if (type == PreviewType::SHOW_MATCH) {
 		std::unique_lock<std::mutex> lock(_mtx);
-		if (areaParams.enable) {
-			screenshot.image = screenshot.image.copy(
-				areaParams.area.x, areaParams.area.y,
-				areaParams.area.width, areaParams.area.height);
-		}
-		// Will emit status label update
-		MarkMatch(screenshot.image, patternMatchParams,
-			  patternImageData, objDetectParams, ocrParams,
-			  condition);
+		// Will emit status label update and draw the matches directly
+		// into the screenshot
+		MarkMatch(image, patternMatchParams, patternImageData,
+			  objDetectParams, ocrParams, condition);
 	} else {
 		emit StatusUpdate("");
 	}
-	emit ImageReady(QPixmap::fromImage(screenshot.image));
+	emit ImageReady(image);
 }
 
 void PreviewImage::MarkMatch(QImage &screenshot,
@@ -315,11 +354,14 @@ void PreviewImage::MarkMatch(QImage &screenshot,
 				     patternImageData.rgbaPattern);
 		}
 	} else if (condition == VideoCondition::OBJECT) {
-		auto objects = MatchObject(screenshot, objDetectParams.cascade,
-					   objDetectParams.scaleFactor,
-					   objDetectParams.minNeighbors,
-					   objDetectParams.minSize.CV(),
-					   objDetectParams.maxSize.CV());
+		std::vector<cv::Rect> objects;
+		if (objDetectParams.cascade) {
+			objects = objDetectParams.cascade->Detect(
+				screenshot, objDetectParams.scaleFactor,
+				objDetectParams.minNeighbors,
+				objDetectParams.minSize.CV(),
+				objDetectParams.maxSize.CV());
+		}
 		if (objects.empty()) {
 			emit StatusUpdate(obs_module_text(
 				"AdvSceneSwitcher.condition.video.objectMatchFail"));
@@ -329,8 +371,10 @@ void PreviewImage::MarkMatch(QImage &screenshot,
 			markObjects(screenshot, objects);
 		}
 	} else if (condition == VideoCondition::OCR) {
-		auto text = RunOCR(ocrParams.GetOCR(), screenshot,
-				   ocrParams.color, ocrParams.colorThreshold);
+		auto text = RunOCR(screenshot, ocrParams.color,
+				   ocrParams.colorThreshold,
+				   ocrParams.GetLanguageCode(),
+				   ocrParams.GetPageMode());
 		QString status(obs_module_text(
 			"AdvSceneSwitcher.condition.video.ocrMatchSuccess"));
 		emit StatusUpdate(status.arg(QString::fromStdString(text)));
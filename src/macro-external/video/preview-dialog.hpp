@@ -1,13 +1,18 @@
 #pragma once
 #include "paramerter-wrappers.hpp"
 
+#include <screenshot-helper.hpp>
+
 #include <QDialog>
 #include <QLabel>
 #include <QScrollArea>
 #include <QThread>
+#include <QTimer>
 #include <QMouseEvent>
 #include <QRubberBand>
 #include <QPoint>
+#include <chrono>
+#include <memory>
 #include <mutex>
 
 namespace advss {
@@ -29,7 +34,7 @@ public slots:
 			 const PatternImageData &, ObjDetectParameters,
 			 OCRParameters, const AreaParameters &, VideoCondition);
 signals:
-	void ImageReady(const QPixmap &);
+	void ImageReady(const QImage &);
 	void StatusUpdate(const QString &);
 
 private:
@@ -38,6 +43,11 @@ private:
 		       const OCRParameters &, VideoCondition);
 
 	std::mutex &_mtx;
+
+	// Reused for all screenshots of the same source and area
+	std::unique_ptr<ScreenshotHelper> _screenshot;
+	OBSWeakSource _screenshotSource;
+	QRect _screenshotArea;
 };
 
 class PreviewDialog : public QDialog {
@@ -59,7 +69,8 @@ public slots:
 	void AreaParametersChanged(const AreaParameters &);
 	void ConditionChanged(int cond);
 private slots:
-	void UpdateImage(const QPixmap &);
+	void UpdateImage(const QImage &);
+	void RequestImage();
 	void UpdateStatus(const QString &);
 signals:
 	void SelectionAreaChanged(QRect area);
@@ -96,6 +107,8 @@ private:
 
 	std::mutex _mtx;
 	QThread _thread;
+	QTimer _refreshTimer;
+	std::chrono::high_resolution_clock::time_point _requestTime{};
 };
 
 } // namespace advss
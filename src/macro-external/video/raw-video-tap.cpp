@@ -0,0 +1,112 @@
+#include "raw-video-tap.hpp"
+
+#include <obs-module.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace advss {
+
+static std::mutex tapsMutex;
+static std::vector<std::weak_ptr<RawVideoTap>> taps;
+
+std::shared_ptr<RawVideoTap> RawVideoTap::Get(uint32_t width, uint32_t height,
+					      uint32_t frameRateDivisor)
+{
+	std::lock_guard<std::mutex> lock(tapsMutex);
+	taps.erase(std::remove_if(taps.begin(), taps.end(),
+				  [](const auto &tap) {
+					  return tap.expired();
+				  }),
+		   taps.end());
+	for (const auto &weakTap : taps) {
+		auto tap = weakTap.lock();
+		if (tap && tap->Uses(width, height, frameRateDivisor)) {
+			return tap;
+		}
+	}
+	auto tap = std::shared_ptr<RawVideoTap>(
+		new RawVideoTap(width, height, frameRateDivisor));
+	taps.emplace_back(tap);
+	return tap;
+}
+
+RawVideoTap::RawVideoTap(uint32_t width, uint32_t height,
+			 uint32_t frameRateDivisor)
+	: _width(width),
+	  _height(height),
+	  _frameRateDivisor(std::max(frameRateDivisor, 1u))
+{
+	video_scale_info conversion = {};
+	conversion.format = VIDEO_FORMAT_RGBA;
+	conversion.width = _width;
+	conversion.height = _height;
+	conversion.range = VIDEO_RANGE_FULL;
+	conversion.colorspace = VIDEO_CS_DEFAULT;
+#if LIBOBS_API_VER >= MAKE_SEMANTIC_VERSION(30, 0, 0)
+	obs_add_raw_video_callback2(&conversion, _frameRateDivisor,
+				    ReceiveFrame, this);
+#else
+	obs_add_raw_video_callback(&conversion, ReceiveFrame, this);
+#endif
+}
+
+RawVideoTap::~RawVideoTap()
+{
+	// No more frames will be received once this returns
+	obs_remove_raw_video_callback(ReceiveFrame, this);
+}
+
+bool RawVideoTap::Uses(uint32_t width, uint32_t height,
+		       uint32_t frameRateDivisor) const
+{
+	return _width == width && _height == height &&
+	       _frameRateDivisor == std::max(frameRateDivisor, 1u);
+}
+
+std::optional<RawVideoTap::Frame> RawVideoTap::GetLatestFrame() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_frameCount == 0) {
+		return {};
+	}
+	return _frames[(_frameCount - 1) % _frames.size()];
+}
+
+void RawVideoTap::ReceiveFrame(void *param, struct video_data *frame)
+{
+	auto tap = static_cast<RawVideoTap *>(param);
+#if LIBOBS_API_VER < MAKE_SEMANTIC_VERSION(30, 0, 0)
+	// Only called from the video output thread
+	if (++tap->_skippedFrames < tap->_frameRateDivisor) {
+		return;
+	}
+	tap->_skippedFrames = 0;
+#endif
+	tap->StoreFrame(frame);
+}
+
+void RawVideoTap::StoreFrame(const struct video_data *frame)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto &slot = _frames[_frameCount % _frames.size()];
+
+	// The image memory is reused unless a consumer still holds a
+	// reference to the frame previously stored in this slot
+	if (slot.image.width() != static_cast<int>(_width) ||
+	    slot.image.height() != static_cast<int>(_height)) {
+		slot.image = QImage(_width, _height,
+				    QImage::Format::Format_RGBA8888);
+	}
+	const size_t lineSize = std::min<size_t>(slot.image.bytesPerLine(),
+						 frame->linesize[0]);
+	for (uint32_t y = 0; y < _height; y++) {
+		std::memcpy(slot.image.scanLine(y),
+			    frame->data[0] + y * frame->linesize[0], lineSize);
+	}
+	slot.time = std::chrono::high_resolution_clock::now();
+	slot.index = ++_frameCount;
+}
+
+} // namespace advss
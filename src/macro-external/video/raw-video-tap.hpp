@@ -0,0 +1,54 @@
+#pragma once
+#include <obs.hpp>
+
+#include <QImage>
+#include <array>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace advss {
+
+// Receives the frames of the OBS main output directly instead of rendering
+// the output again.
+// The frames are converted to RGBA and scaled by OBS and only every n-th frame
+// is delivered.
+// The most recent frames are kept in a small ring buffer.
+class RawVideoTap {
+public:
+	struct Frame {
+		QImage image;
+		std::chrono::high_resolution_clock::time_point time;
+		uint64_t index = 0;
+	};
+
+	// Taps with identical settings are shared by all users
+	static std::shared_ptr<RawVideoTap>
+	Get(uint32_t width, uint32_t height, uint32_t frameRateDivisor);
+	~RawVideoTap();
+	RawVideoTap(const RawVideoTap &) = delete;
+	RawVideoTap &operator=(const RawVideoTap &) = delete;
+
+	bool Uses(uint32_t width, uint32_t height,
+		  uint32_t frameRateDivisor) const;
+	std::optional<Frame> GetLatestFrame() const;
+
+private:
+	RawVideoTap(uint32_t width, uint32_t height, uint32_t frameRateDivisor);
+	static void ReceiveFrame(void *param, struct video_data *frame);
+	void StoreFrame(const struct video_data *frame);
+
+	const uint32_t _width;
+	const uint32_t _height;
+	const uint32_t _frameRateDivisor;
+#if LIBOBS_API_VER < MAKE_SEMANTIC_VERSION(30, 0, 0)
+	uint32_t _skippedFrames = 0;
+#endif
+
+	mutable std::mutex _mutex;
+	std::array<Frame, 3> _frames;
+	uint64_t _frameCount = 0;
+};
+
+} // namespace advss
@@ -0,0 +1,305 @@
+#include "video-analysis.hpp"
+#include "ocr-helpers.hpp"
+
+#include <switch-network.hpp>
+
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+
+namespace advss {
+
+static QThreadPool *getThreadPool(bool loader)
+{
+	// The destructors will wait for all running jobs to finish
+	static QThreadPool analysisPool;
+	static QThreadPool loaderPool;
+	static bool initialized = []() {
+		// Keep some cores free for OBS itself
+		analysisPool.setMaxThreadCount(
+			std::clamp(QThread::idealThreadCount() / 2, 1, 4));
+		// Files are loaded one after the other, so files used by
+		// multiple conditions will already be cached for all but the
+		// first of them
+		loaderPool.setMaxThreadCount(1);
+		return true;
+	}();
+	(void)initialized;
+	return loader ? &loaderPool : &analysisPool;
+}
+
+static bool imagesMatch(const VideoAnalysisInput &input,
+			VideoAnalysisResult &result)
+{
+	if (!input.useSimilarity) {
+		return input.image == input.matchImage;
+	}
+
+	result.blockMeans = CreateBlockMeans(input.image);
+	return GetBlockMeanDifference(result.blockMeans,
+				      input.matchBlockMeans) <=
+	       input.similarityTolerance;
+}
+
+static PatternImageData getReferencePatternData(const VideoAnalysisInput &input)
+{
+	const auto &data = input.matchPatternData;
+	const bool isComplete =
+		!data.rgbaPattern.empty() &&
+		(!input.useAlphaAsMask || !data.rgbPattern.empty());
+	if (isComplete) {
+		return data;
+	}
+
+	// The reference frame was not analyzed using the pattern, e.g.
+	// because the settings were changed in the meantime
+	return CreatePatternData(input.matchImage);
+}
+
+static bool outputChanged(const VideoAnalysisInput &input,
+			  VideoAnalysisResult &result)
+{
+	if (!input.usePatternForChangedCheck) {
+		return !imagesMatch(input, result);
+	}
+
+	PatternMatchFrame frame(input.image);
+	cv::Mat matchResult;
+	MatchPattern(frame, getReferencePatternData(input),
+		     input.patternThreshold, matchResult, input.useAlphaAsMask,
+		     input.matchMode);
+
+	// The current frame will be the reference for the next check
+	result.patternData = CreatePatternData(frame, input.useAlphaAsMask);
+	if (matchResult.total() == 0) {
+		return false;
+	}
+	return countNonZero(matchResult) == 0;
+}
+
+static bool containsPattern(const VideoAnalysisInput &input,
+			    VideoAnalysisResult &result)
+{
+	QImage image = input.image;
+	cv::Point location;
+	if (!FindPattern(image, input.patternData, input.patternThreshold,
+			 input.useAlphaAsMask, input.matchMode, location,
+			 input.fullScalePatternSearch)) {
+		return false;
+	}
+
+	if (input.reportPosition) {
+		result.variableValue =
+			GetMatchPosition(location, input.scale, input.offset);
+	}
+	return true;
+}
+
+static bool containsObject(const VideoAnalysisInput &input)
+{
+	if (!input.cascade) {
+		return false;
+	}
+	QImage image = input.image;
+	auto objects = input.cascade->Detect(image, input.objectScaleFactor,
+					     input.minNeighbors, input.minSize,
+					     input.maxSize);
+	return objects.size() > 0;
+}
+
+static bool checkBrightness(const VideoAnalysisInput &input,
+			    VideoAnalysisResult &result)
+{
+	QImage image = input.image;
+	result.brightness = GetAvgBrightness(image) / 255.;
+	return result.brightness > input.brightnessThreshold;
+}
+
+static bool checkOCR(const VideoAnalysisInput &input,
+		     VideoAnalysisResult &result)
+{
+	result.variableValue = RunOCR(input.image, input.ocrColor,
+				      input.ocrColorThreshold,
+				      input.ocrLanguage, input.pageSegMode);
+	if (!input.ocrUseRegex) {
+		return result.variableValue == input.ocrText;
+	}
+	if (!input.ocrRegex.isValid()) {
+		return false;
+	}
+	auto match = input.ocrRegex.match(
+		QString::fromStdString(result.variableValue));
+	return match.hasMatch();
+}
+
+static bool checkColor(const VideoAnalysisInput &input)
+{
+	return ContainsPixelsInColorRange(input.image, input.color,
+					  input.colorThreshold,
+					  input.colorMatchThreshold);
+}
+
+static bool compare(const VideoAnalysisInput &input,
+		    VideoAnalysisResult &result)
+{
+	switch (input.condition) {
+	case VideoCondition::MATCH:
+		return imagesMatch(input, result);
+	case VideoCondition::DIFFER:
+		return !imagesMatch(input, result);
+	case VideoCondition::HAS_CHANGED:
+		return outputChanged(input, result);
+	case VideoCondition::HAS_NOT_CHANGED:
+		return !outputChanged(input, result);
+	case VideoCondition::NO_IMAGE:
+		return input.image.isNull();
+	case VideoCondition::PATTERN:
+		return containsPattern(input, result);
+	case VideoCondition::OBJECT:
+		return containsObject(input);
+	case VideoCondition::BRIGHTNESS:
+		return checkBrightness(input, result);
+	case VideoCondition::OCR:
+		return checkOCR(input, result);
+	case VideoCondition::COLOR:
+		return checkColor(input);
+	default:
+		break;
+	}
+	return false;
+}
+
+std::string GetMatchPosition(const cv::Point &location, double scale,
+			     const QPoint &offset)
+{
+	const int x = qRound(location.x / scale) + offset.x();
+	const int y = qRound(location.y / scale) + offset.y();
+	return std::to_string(x) + "," + std::to_string(y);
+}
+
+// Parameters, which might be resolved from variables, so they can change
+// while the frame stays the same
+static std::string getParameterKey(const VideoAnalysisInput &input)
+{
+	std::string key;
+	auto add = [&key](const std::string &value) {
+		key += value;
+		key += '\n';
+	};
+	auto addNumber = [&add](auto value) { add(std::to_string(value)); };
+
+	addNumber(static_cast<int>(input.condition));
+	addNumber(input.reportPosition);
+	addNumber(input.useSimilarity);
+	addNumber(input.similarityTolerance);
+	addNumber(input.patternThreshold);
+	addNumber(input.useAlphaAsMask);
+	addNumber(static_cast<int>(input.matchMode));
+	addNumber(input.objectScaleFactor);
+	addNumber(input.minNeighbors);
+	addNumber(input.minSize.width);
+	addNumber(input.minSize.height);
+	addNumber(input.maxSize.width);
+	addNumber(input.maxSize.height);
+	addNumber(input.brightnessThreshold);
+	add(input.ocrLanguage);
+	addNumber(static_cast<int>(input.pageSegMode));
+	addNumber(input.ocrColor.rgba());
+	addNumber(input.ocrColorThreshold);
+	add(input.ocrText);
+	addNumber(input.ocrUseRegex);
+	add(input.ocrRegex.pattern().toStdString());
+	addNumber(static_cast<int>(input.ocrRegex.patternOptions()));
+	addNumber(input.color.rgba());
+	addNumber(input.colorThreshold);
+	addNumber(input.colorMatchThreshold);
+	return key;
+}
+
+VideoAnalysisResult AnalyzeFrame(const VideoAnalysisInput &input)
+{
+	VideoAnalysisResult result;
+	result.captureTime = input.captureTime;
+	result.image = input.image;
+	result.frameSignature = input.frameSignature;
+	result.frameParameters = input.frameParameters;
+
+	if (input.skipUnchangedFrames) {
+		// Compare against the last analyzed frame instead of the
+		// previous one so slow gradual changes will still be detected
+		// eventually
+		auto signature = CreateFrameSignature(input.image);
+		auto parameters = getParameterKey(input);
+		if (!input.frameSignature.empty() &&
+		    parameters == input.frameParameters &&
+		    GetFrameSignatureDifference(signature,
+						input.frameSignature) <=
+			    input.unchangedFrameTolerance) {
+			result.match = input.lastMatch;
+			result.variableValue = input.lastVariableValue;
+			return result;
+		}
+		result.frameSignature = signature;
+		result.frameParameters = std::move(parameters);
+	}
+
+	result.match = compare(input, result);
+	return result;
+}
+
+void StartVideoAnalysisJob(std::function<void()> job)
+{
+	getThreadPool(false)->start(
+		Compatability::CreateFunctionRunnable(std::move(job)));
+}
+
+void StartVideoResourceLoadJob(std::function<void()> job)
+{
+	getThreadPool(true)->start(
+		Compatability::CreateFunctionRunnable(std::move(job)));
+}
+
+bool VideoAnalysisWorker::Busy() const
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	return _state->busy;
+}
+
+void VideoAnalysisWorker::Submit(VideoAnalysisInput &&input)
+{
+	uint64_t generation;
+	{
+		std::lock_guard<std::mutex> lock(_state->mutex);
+		_state->busy = true;
+		generation = _state->generation;
+	}
+
+	auto state = _state;
+	auto data = std::make_shared<VideoAnalysisInput>(std::move(input));
+	auto job = [state, data, generation]() {
+		auto result = AnalyzeFrame(*data);
+		std::lock_guard<std::mutex> lock(state->mutex);
+		state->busy = false;
+		if (generation == state->generation) {
+			state->result = std::move(result);
+		}
+	};
+	StartVideoAnalysisJob(job);
+}
+
+std::optional<VideoAnalysisResult> VideoAnalysisWorker::TakeResult()
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	auto result = std::move(_state->result);
+	_state->result.reset();
+	return result;
+}
+
+void VideoAnalysisWorker::DiscardPendingResult()
+{
+	std::lock_guard<std::mutex> lock(_state->mutex);
+	++_state->generation;
+	_state->result.reset();
+}
+
+} // namespace advss
@@ -0,0 +1,127 @@
+#pragma once
+#include "opencv-helpers.hpp"
+#include "paramerter-wrappers.hpp"
+#include "video-resource-cache.hpp"
+
+#include <QImage>
+#include <QColor>
+#include <QRegularExpression>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+namespace advss {
+
+// Snapshot of everything needed to analyze a single frame.
+// All variables are resolved when the snapshot is taken, so the analysis does
+// not have to access any state of the condition while running in the
+// background.
+struct VideoAnalysisInput {
+	VideoCondition condition = VideoCondition::MATCH;
+	QImage image;
+	std::chrono::high_resolution_clock::time_point captureTime;
+
+	// Used to report match positions in the coordinates of the video input
+	double scale = 1.0;
+	QPoint offset;
+	bool reportPosition = false;
+
+	// Reference image for the MATCH, DIFFER and change checks
+	QImage matchImage;
+	bool usePatternForChangedCheck = false;
+	// Pattern data of the reference image, which is created while
+	// analyzing it, if the pattern is used for the change check
+	PatternImageData matchPatternData;
+	// Compare the block means of the images instead of the exact content
+	bool useSimilarity = false;
+	double similarityTolerance = 0.05;
+	cv::Mat matchBlockMeans;
+
+	PatternImageData patternData;
+	double patternThreshold = 0.8;
+	bool useAlphaAsMask = false;
+	cv::TemplateMatchModes matchMode = cv::TM_CCORR_NORMED;
+	// Search the full scale image if the downscaled search fails
+	bool fullScalePatternSearch = false;
+
+	std::shared_ptr<CascadeModel> cascade;
+	double objectScaleFactor = defaultScaleFactor;
+	int minNeighbors = minMinNeighbors;
+	cv::Size minSize;
+	cv::Size maxSize;
+
+	double brightnessThreshold = 0.5;
+
+	std::string ocrLanguage;
+	tesseract::PageSegMode pageSegMode = tesseract::PSM_SINGLE_BLOCK;
+	QColor ocrColor;
+	double ocrColorThreshold = 0.3;
+	std::string ocrText;
+	bool ocrUseRegex = false;
+	QRegularExpression ocrRegex;
+
+	QColor color;
+	double colorThreshold = 0.1;
+	double colorMatchThreshold = 0.8;
+
+	// The previous result is reused if the frame did not change noticeably
+	// compared to the frame described by frameSignature and it was analyzed
+	// using the same resolved parameters
+	bool skipUnchangedFrames = false;
+	double unchangedFrameTolerance = 0.01;
+	cv::Mat1b frameSignature;
+	std::string frameParameters;
+	bool lastMatch = false;
+	std::string lastVariableValue;
+};
+
+struct VideoAnalysisResult {
+	bool match = false;
+	std::string variableValue;
+	double brightness = 0.;
+	// The analyzed frame, which is used as the reference for change checks
+	QImage image;
+	PatternImageData patternData;
+	cv::Mat blockMeans;
+	cv::Mat1b frameSignature;
+	std::string frameParameters;
+	std::chrono::high_resolution_clock::time_point captureTime;
+};
+
+VideoAnalysisResult AnalyzeFrame(const VideoAnalysisInput &);
+// Converts the location of a match in the analyzed image to the "x,y" position
+// in the coordinates of the video input
+std::string GetMatchPosition(const cv::Point &location, double scale,
+			     const QPoint &offset);
+// Runs the given job on the worker threads used for all video analysis
+void StartVideoAnalysisJob(std::function<void()>);
+// Runs the given job on the worker thread used for loading files
+void StartVideoResourceLoadJob(std::function<void()>);
+
+// Runs the analysis of a condition on a shared pool of worker threads.
+// Only a single analysis per condition will be in progress at any time.
+// The state is shared with the running job, so the condition can be destroyed
+// while the analysis is still in progress.
+class VideoAnalysisWorker {
+public:
+	bool Busy() const;
+	void Submit(VideoAnalysisInput &&);
+	// Returns the result of the last finished analysis if it was not
+	// retrieved yet
+	std::optional<VideoAnalysisResult> TakeResult();
+	// Results of analysis jobs which are still in progress will be dropped
+	void DiscardPendingResult();
+
+private:
+	struct State {
+		std::mutex mutex;
+		bool busy = false;
+		uint64_t generation = 0;
+		std::optional<VideoAnalysisResult> result;
+	};
+	std::shared_ptr<State> _state = std::make_shared<State>();
+};
+
+} // namespace advss
@@ -0,0 +1,175 @@
+#include "video-resource-cache.hpp"
+#include "video-analysis.hpp"
+
+#include <log-helper.hpp>
+
+#include <QFileInfo>
+#include <algorithm>
+#include <functional>
+
+namespace advss {
+
+namespace {
+
+template<typename T> struct CacheEntry {
+	qint64 lastModified = 0;
+	qint64 size = 0;
+	std::weak_ptr<T> data;
+};
+
+} // namespace
+
+// Patterns are usually only used at very few different scales
+constexpr size_t maxScaledPatterns = 8;
+
+static std::mutex cacheMutex;
+static std::map<std::string, CacheEntry<const PatternImage>> patternImages;
+static std::map<std::string, CacheEntry<CascadeModel>> cascadeModels;
+
+PatternImage::PatternImage(const QImage &image)
+	: _image(image), _blockMeans(CreateBlockMeans(image))
+{
+}
+
+PatternImageData PatternImage::GetPatternData(double scale) const
+{
+	if (scale >= 1.0) {
+		scale = 1.0;
+	}
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _patternData.find(scale);
+	if (it != _patternData.end()) {
+		return it->second;
+	}
+	if (_patternData.size() >= maxScaledPatterns) {
+		_patternData.clear();
+	}
+
+	if (scale == 1.0) {
+		return _patternData[scale] = CreatePatternData(_image);
+	}
+
+	// The pattern has to be scaled by the same factor as the screenshot
+	// for the pattern to still be found
+	const int width = std::max(1, qRound(_image.width() * scale));
+	const int height = std::max(1, qRound(_image.height() * scale));
+	return _patternData[scale] = CreatePatternData(_image.scaled(
+		       width, height, Qt::IgnoreAspectRatio,
+		       Qt::SmoothTransformation));
+}
+
+std::vector<cv::Rect> CascadeModel::Detect(QImage &img, double scaleFactor,
+					   int minNeighbors,
+					   const cv::Size &minSize,
+					   const cv::Size &maxSize)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return MatchObject(img, _classifier, scaleFactor, minNeighbors, minSize,
+			   maxSize);
+}
+
+template<typename T>
+static std::shared_ptr<T>
+getCached(std::map<std::string, CacheEntry<T>> &cache, const std::string &path,
+	  const std::function<std::shared_ptr<T>()> &load)
+{
+	const QFileInfo info(QString::fromStdString(path));
+	if (!info.exists()) {
+		return nullptr;
+	}
+	const qint64 lastModified = info.lastModified().toMSecsSinceEpoch();
+	const qint64 size = info.size();
+	{
+		std::lock_guard<std::mutex> lock(cacheMutex);
+		auto it = cache.find(path);
+		if (it != cache.end() &&
+		    it->second.lastModified == lastModified &&
+		    it->second.size == size) {
+			if (auto data = it->second.data.lock()) {
+				return data;
+			}
+		}
+	}
+
+	// Loading might take a while, so it should not block other users of
+	// the cache
+	auto data = load();
+	if (!data) {
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	auto &entry = cache[path];
+	if (entry.lastModified == lastModified && entry.size == size) {
+		// Another user might have loaded the same file in the meantime
+		if (auto existing = entry.data.lock()) {
+			return existing;
+		}
+	}
+	entry = {lastModified, size, data};
+	return data;
+}
+
+std::shared_ptr<const PatternImage> GetPatternImage(const std::string &path)
+{
+	return getCached<const PatternImage>(
+		patternImages, path,
+		[&path]() -> std::shared_ptr<const PatternImage> {
+			QImage image;
+			if (!image.load(QString::fromStdString(path))) {
+				return nullptr;
+			}
+			return std::make_shared<PatternImage>(
+				image.convertToFormat(
+					QImage::Format::Format_RGBA8888));
+		});
+}
+
+std::shared_ptr<CascadeModel> GetCascadeModel(const std::string &path)
+{
+	return getCached<CascadeModel>(
+		cascadeModels, path,
+		[&path]() -> std::shared_ptr<CascadeModel> {
+			auto model = std::make_shared<CascadeModel>();
+			try {
+				model->_classifier.load(path);
+			} catch (...) {
+				blog(LOG_WARNING,
+				     "failed to load model data \"%s\"",
+				     path.c_str());
+				return nullptr;
+			}
+			if (model->Empty()) {
+				return nullptr;
+			}
+			return model;
+		});
+}
+
+template<typename T>
+static std::shared_future<std::shared_ptr<T>>
+loadAsync(const std::function<std::shared_ptr<T>()> &load)
+{
+	auto promise = std::make_shared<std::promise<std::shared_ptr<T>>>();
+	auto future = promise->get_future().share();
+	StartVideoResourceLoadJob(
+		[promise, load]() { promise->set_value(load()); });
+	return future;
+}
+
+std::shared_future<std::shared_ptr<const PatternImage>>
+LoadPatternImageAsync(const std::string &path)
+{
+	return loadAsync<const PatternImage>(
+		[path]() { return GetPatternImage(path); });
+}
+
+std::shared_future<std::shared_ptr<CascadeModel>>
+LoadCascadeModelAsync(const std::string &path)
+{
+	return loadAsync<CascadeModel>(
+		[path]() { return GetCascadeModel(path); });
+}
+
+} // namespace advss
@@ -0,0 +1,64 @@
+#pragma once
+#include "opencv-helpers.hpp"
+
+#include <QImage>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace advss {
+
+// Pattern image loaded from a file together with the data derived from it.
+// The image itself is never modified once loaded, so it can be shared by all
+// conditions using the same file.
+class PatternImage {
+public:
+	PatternImage(const QImage &image);
+	const QImage &Image() const { return _image; }
+	const cv::Mat &BlockMeans() const { return _blockMeans; }
+	// The pattern data for a given scale is only created once and shared
+	// afterwards
+	PatternImageData GetPatternData(double scale = 1.0) const;
+
+private:
+	const QImage _image;
+	const cv::Mat _blockMeans;
+	mutable std::mutex _mutex;
+	mutable std::map<double, PatternImageData> _patternData;
+};
+
+// Cascade classifier loaded from a model file.
+// Detecting objects modifies internal buffers of the classifier, so the
+// detection is serialized for all users of the same model.
+class CascadeModel {
+public:
+	bool Empty() const { return _classifier.empty(); }
+	std::vector<cv::Rect> Detect(QImage &img, double scaleFactor,
+				     int minNeighbors, const cv::Size &minSize,
+				     const cv::Size &maxSize);
+
+private:
+	friend std::shared_ptr<CascadeModel>
+	GetCascadeModel(const std::string &path);
+
+	std::mutex _mutex;
+	cv::CascadeClassifier _classifier;
+};
+
+// The files are only loaded again if they were modified since they were
+// last loaded and are shared as long as they are in use.
+// Returns nullptr if the file could not be loaded.
+std::shared_ptr<const PatternImage> GetPatternImage(const std::string &path);
+std::shared_ptr<CascadeModel> GetCascadeModel(const std::string &path);
+
+// The files are loaded on a background loader thread, so loading a large
+// number of them does not block the caller
+std::shared_future<std::shared_ptr<const PatternImage>>
+LoadPatternImageAsync(const std::string &path);
+std::shared_future<std::shared_ptr<CascadeModel>>
+LoadCascadeModelAsync(const std::string &path);
+
+} // namespace advss
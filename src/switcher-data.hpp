@@ -60,6 +60,11 @@ public:
 
 	void SetWaitScene();
 	bool SceneChangedDuringWait();
+	// Checks the macros before the interval has passed, e.g. if an event
+	// was received, without interrupting any other wait of the main loop.
+	// Requested checks replace the next regular check, so there will not
+	// be more than one check per interval.
+	void RequestMacroCheck();
 	bool AnySceneTransitionStarted();
 
 	void SetPreconditions();
@@ -110,6 +115,7 @@ public:
 	std::unique_lock<std::mutex> *mainLoopLock = nullptr;
 	bool stop = false;
 	std::condition_variable cv;
+	std::atomic_bool macroCheckRequested = {false};
 	std::condition_variable macroWaitCv;
 	std::atomic_bool abortMacroWait = {false};
 	std::condition_variable macroTransitionCv;
@@ -161,20 +167,12 @@ public:
 
 	/* --- End of General tab section --- */
 
-	struct AudioFadeInfo {
-		std::atomic_bool active = {false};
-		std::atomic_int id = {0};
-	};
-	AudioFadeInfo masterAudioFade;
-	std::unordered_map<std::string, AudioFadeInfo> activeAudioFades;
-
 	MacroProperties macroProperties;
 	std::deque<std::shared_ptr<Macro>> macros;
 	bool macroSceneSwitched = false;
 
 	Curlhelper curl;
 	std::deque<std::shared_ptr<Item>> connections;
-	std::vector<std::string> websocketMessages;
 	std::deque<std::shared_ptr<Item>> variables;
 
 	std::string lastTitle;
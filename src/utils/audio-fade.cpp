@@ -0,0 +1,267 @@
+#include "audio-fade.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace advss {
+
+namespace {
+
+struct ActiveFade {
+	uint64_t id = 0;
+	AudioFade fade;
+	float startVolume = 0.f;
+	std::chrono::steady_clock::time_point start;
+};
+
+class AudioFadeScheduler {
+public:
+	~AudioFadeScheduler();
+	uint64_t Start(const AudioFade &);
+	bool Active(const OBSWeakSource &source);
+	void Cancel(const OBSWeakSource &source);
+	void Cancel(const void *owner);
+	void Wait(uint64_t id);
+
+private:
+	void Run();
+	bool IsActive(uint64_t id) const;
+	void Remove(const std::function<bool(const ActiveFade &)> &);
+
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::vector<ActiveFade> _fades;
+	uint64_t _nextId = 1;
+	std::thread _thread;
+	bool _running = false;
+	bool _stop = false;
+};
+
+} // namespace
+
+// Volume changes are applied by OBS per audio packet, which is about 21 ms, so
+// updating more often would not make the fades any smoother
+constexpr auto fadeUpdateInterval = std::chrono::milliseconds(10);
+// Volumes below this level are treated as silence when fading in dB
+constexpr float minFadeDb = -96.f;
+
+static float getVolume(const OBSWeakSource &source)
+{
+	if (!source) {
+		return obs_get_master_volume();
+	}
+	OBSSourceAutoRelease s = obs_weak_source_get_source(source);
+	return s ? obs_source_get_volume(s) : 0.f;
+}
+
+static bool setVolume(const OBSWeakSource &source, float volume)
+{
+	if (!source) {
+		obs_set_master_volume(volume);
+		return true;
+	}
+	OBSSourceAutoRelease s = obs_weak_source_get_source(source);
+	if (!s) {
+		return false;
+	}
+	obs_source_set_volume(s, volume);
+	return true;
+}
+
+static float mulToDb(float mul)
+{
+	return mul > 0.f ? std::max(20.f * std::log10(mul), minFadeDb)
+			 : minFadeDb;
+}
+
+static float dbToMul(float db)
+{
+	return db <= minFadeDb ? 0.f : std::pow(10.f, db / 20.f);
+}
+
+static float interpolate(FadeCurve curve, float from, float to, float t)
+{
+	switch (curve) {
+	case FadeCurve::LINEAR:
+		return from + (to - from) * t;
+	case FadeCurve::DB: {
+		const float fromDb = mulToDb(from);
+		return dbToMul(fromDb + (mulToDb(to) - fromDb) * t);
+	}
+	case FadeCurve::S_CURVE:
+		t = t * t * (3.f - 2.f * t);
+		return from + (to - from) * t;
+	default:
+		break;
+	}
+	return to;
+}
+
+AudioFadeScheduler::~AudioFadeScheduler()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cv.notify_all();
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+}
+
+uint64_t AudioFadeScheduler::Start(const AudioFade &fade)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+
+	// The current volume already includes the progress of a fade, which is
+	// about to be replaced, so the volume will not jump when retargeting
+	const float startVolume = getVolume(fade.source);
+	Remove([&fade](const ActiveFade &active) {
+		return active.fade.source == fade.source;
+	});
+	if (fade.duration <= fadeUpdateInterval ||
+	    startVolume == fade.volume) {
+		setVolume(fade.source, fade.volume);
+		// Wake up anyone waiting for a fade, which was just replaced
+		lock.unlock();
+		_cv.notify_all();
+		return 0;
+	}
+
+	const auto id = _nextId++;
+	_fades.push_back(
+		{id, fade, startVolume, std::chrono::steady_clock::now()});
+
+	// The scheduler thread exits once there are no fades left
+	if (!_running) {
+		if (_thread.joinable()) {
+			_thread.join();
+		}
+		_running = true;
+		_thread = std::thread(&AudioFadeScheduler::Run, this);
+	}
+	lock.unlock();
+	_cv.notify_all();
+	return id;
+}
+
+bool AudioFadeScheduler::Active(const OBSWeakSource &source)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return std::any_of(_fades.begin(), _fades.end(),
+			   [&source](const ActiveFade &active) {
+				   return active.fade.source == source;
+			   });
+}
+
+void AudioFadeScheduler::Cancel(const OBSWeakSource &source)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		Remove([&source](const ActiveFade &active) {
+			return active.fade.source == source;
+		});
+	}
+	_cv.notify_all();
+}
+
+void AudioFadeScheduler::Cancel(const void *owner)
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		Remove([owner](const ActiveFade &active) {
+			return active.fade.owner == owner;
+		});
+	}
+	_cv.notify_all();
+}
+
+void AudioFadeScheduler::Wait(uint64_t id)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_cv.wait(lock, [this, id]() { return _stop || !IsActive(id); });
+}
+
+bool AudioFadeScheduler::IsActive(uint64_t id) const
+{
+	return std::any_of(
+		_fades.begin(), _fades.end(),
+		[id](const ActiveFade &active) { return active.id == id; });
+}
+
+void AudioFadeScheduler::Remove(
+	const std::function<bool(const ActiveFade &)> &predicate)
+{
+	_fades.erase(std::remove_if(_fades.begin(), _fades.end(), predicate),
+		     _fades.end());
+}
+
+void AudioFadeScheduler::Run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	auto nextUpdate = std::chrono::steady_clock::now();
+	while (!_stop && !_fades.empty()) {
+		const auto now = std::chrono::steady_clock::now();
+		for (auto it = _fades.begin(); it != _fades.end();) {
+			const auto &fade = it->fade;
+			const std::chrono::duration<float> elapsed =
+				now - it->start;
+			const std::chrono::duration<float> duration =
+				fade.duration;
+			const float t = std::min(elapsed / duration, 1.f);
+			// Set the exact volume at the end of the fade
+			const float volume =
+				t < 1.f ? interpolate(fade.curve,
+						      it->startVolume,
+						      fade.volume, t)
+					: fade.volume;
+			if (!setVolume(fade.source, volume) || t >= 1.f) {
+				it = _fades.erase(it);
+				_cv.notify_all();
+				continue;
+			}
+			++it;
+		}
+
+		// Waiting for a fixed point in time avoids accumulating the
+		// time it took to apply the volumes
+		nextUpdate = std::max(nextUpdate + fadeUpdateInterval, now);
+		_cv.wait_until(lock, nextUpdate);
+	}
+	_running = false;
+	_cv.notify_all();
+}
+
+static AudioFadeScheduler scheduler;
+
+uint64_t StartAudioFade(const AudioFade &fade)
+{
+	return scheduler.Start(fade);
+}
+
+bool AudioFadeActive(const OBSWeakSource &source)
+{
+	return scheduler.Active(source);
+}
+
+void CancelAudioFade(const OBSWeakSource &source)
+{
+	scheduler.Cancel(source);
+}
+
+void CancelAudioFades(const void *owner)
+{
+	scheduler.Cancel(owner);
+}
+
+void WaitForAudioFade(uint64_t id)
+{
+	scheduler.Wait(id);
+}
+
+} // namespace advss
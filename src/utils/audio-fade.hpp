@@ -0,0 +1,40 @@
+#pragma once
+#include <obs.hpp>
+
+#include <chrono>
+#include <cstdint>
+
+namespace advss {
+
+enum class FadeCurve {
+	LINEAR,
+	DB,
+	S_CURVE,
+};
+
+// Fade of the volume of a source or of the master volume, if no source is
+// given
+struct AudioFade {
+	OBSWeakSource source;
+	float volume = 0.f;
+	std::chrono::milliseconds duration{0};
+	FadeCurve curve = FadeCurve::LINEAR;
+	// Used to cancel all fades started by the same owner at once
+	const void *owner = nullptr;
+};
+
+// All active fades are advanced by a single scheduler thread.
+// The volume is calculated from the time passed since the fade was started,
+// so fades do not drift even if individual updates are delayed.
+//
+// Starting a fade of a volume, which is already being faded, will retarget it
+// to the new volume starting from the current volume.
+// Returns the id of the fade or 0 if the volume was set immediately.
+uint64_t StartAudioFade(const AudioFade &);
+bool AudioFadeActive(const OBSWeakSource &source);
+void CancelAudioFade(const OBSWeakSource &source);
+void CancelAudioFades(const void *owner);
+// Blocks until the fade was completed, canceled or retargeted
+void WaitForAudioFade(uint64_t id);
+
+} // namespace advss
@@ -121,18 +121,13 @@ void Connection::Reconnect()
 
 void Connection::SendMsg(const std::string &msg)
 {
-	const auto status = _client.GetStatus();
-	if (status == WSConnection::Status::DISCONNECTED) {
+	_client.QueueMessage(msg);
+	if (_client.GetStatus() == WSConnection::Status::DISCONNECTED) {
 		_client.Connect(GetURI(), _password, _reconnect,
 				_reconnectDelay);
-		blog(LOG_WARNING,
-		     "could not send message '%s' (connection to '%s' not established)",
-		     msg.c_str(), GetURI().c_str());
-		return;
-	}
-
-	if (status == WSConnection::Status::AUTHENTICATED) {
-		_client.SendRequest(msg);
+		vblog(LOG_INFO,
+		      "connection to '%s' not established - message queued (%zu pending)",
+		      GetURI().c_str(), _client.GetQueueDepth());
 	}
 }
 
@@ -21,6 +21,8 @@ public:
 				       const char *string);
 	CURLcode Perform();
 	bool Initialized() { return _initialized; }
+	// Used to access the functions of the curl library not wrapped here
+	template<typename T> T GetFunction(const char *name);
 
 private:
 	bool LoadLib();
@@ -45,4 +47,12 @@ inline CURLcode Curlhelper::SetOpt(CURLoption option, Args... args)
 	return _setopt(_curl, option, args...);
 }
 
+template<typename T> inline T Curlhelper::GetFunction(const char *name)
+{
+	if (!_initialized) {
+		return nullptr;
+	}
+	return reinterpret_cast<T>(_lib->resolve(name));
+}
+
 } // namespace advss
@@ -0,0 +1,384 @@
+#include "http-client.hpp"
+#include "curl-helper.hpp"
+#include "log-helper.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace advss {
+
+namespace {
+
+typedef CURLM *(*multiInitFunction)(void);
+typedef CURLMcode (*multiCleanupFunction)(CURLM *);
+typedef CURLMcode (*multiSetOptFunction)(CURLM *, CURLMoption, ...);
+typedef CURLMcode (*multiHandleFunction)(CURLM *, CURL *);
+typedef CURLMcode (*multiPerformFunction)(CURLM *, int *);
+typedef CURLMcode (*multiWaitFunction)(CURLM *, struct curl_waitfd *,
+				       unsigned int, int, int *);
+typedef CURLMsg *(*multiInfoReadFunction)(CURLM *, int *);
+typedef CURLcode (*getInfoFunction)(CURL *, CURLINFO, ...);
+typedef void (*slistFreeFunction)(struct curl_slist *);
+typedef const char *(*strErrorFunction)(CURLcode);
+
+struct Transfer {
+	HttpRequest request;
+	HttpCallback onComplete;
+	std::promise<HttpResponse> promise;
+	HttpResponse response;
+	CURL *handle = nullptr;
+	struct curl_slist *headers = nullptr;
+};
+
+class HttpClient {
+public:
+	HttpClient();
+	~HttpClient();
+	bool Available() const { return _multi != nullptr; }
+	std::shared_future<HttpResponse> Submit(const HttpRequest &,
+						HttpCallback);
+
+private:
+	bool Resolve();
+	void Run();
+	bool StartTransfer(Transfer &);
+	void FinishTransfer(Transfer &, CURLcode);
+
+	Curlhelper _curl;
+	initFunction _easyInit = nullptr;
+	cleanupFunction _easyCleanup = nullptr;
+	setOptFunction _easySetOpt = nullptr;
+	getInfoFunction _easyGetInfo = nullptr;
+	strErrorFunction _easyStrError = nullptr;
+	slistAppendFunction _slistAppend = nullptr;
+	slistFreeFunction _slistFree = nullptr;
+	multiInitFunction _multiInit = nullptr;
+	multiCleanupFunction _multiCleanup = nullptr;
+	multiSetOptFunction _multiSetOpt = nullptr;
+	multiHandleFunction _multiAdd = nullptr;
+	multiHandleFunction _multiRemove = nullptr;
+	multiPerformFunction _multiPerform = nullptr;
+	multiWaitFunction _multiWait = nullptr;
+	multiInfoReadFunction _multiInfoRead = nullptr;
+
+	// The multi handle keeps the connection cache, so it is kept even
+	// while the worker thread is not running
+	CURLM *_multi = nullptr;
+
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::deque<std::unique_ptr<Transfer>> _pending;
+	std::thread _thread;
+	bool _running = false;
+	bool _stop = false;
+};
+
+} // namespace
+
+// Requests are often sent in bursts, so the worker thread is kept around for
+// a while instead of starting a new one for each request
+constexpr auto workerIdleTimeout = std::chrono::seconds(10);
+// Upper bound for noticing newly submitted requests while transfers are active
+constexpr int multiWaitTimeoutMs = 20;
+constexpr long maxHostConnections = 6;
+
+static size_t writeCallback(char *ptr, size_t size, size_t nmemb,
+			    void *userdata)
+{
+	auto transfer = static_cast<Transfer *>(userdata);
+	if (transfer->request.keepResponseBody) {
+		transfer->response.body.append(ptr, size * nmemb);
+	}
+	return size * nmemb;
+}
+
+static size_t headerCallback(char *buffer, size_t size, size_t nitems,
+			     void *userdata)
+{
+	auto transfer = static_cast<Transfer *>(userdata);
+	const std::string line(buffer, size * nitems);
+
+	// Only keep the headers of the final response in case of redirects or
+	// informational responses
+	if (line.rfind("HTTP/", 0) == 0) {
+		transfer->response.headers.clear();
+		return size * nitems;
+	}
+
+	const auto separator = line.find(':');
+	if (separator == std::string::npos) {
+		return size * nitems;
+	}
+	std::string name = line.substr(0, separator);
+	std::transform(name.begin(), name.end(), name.begin(),
+		       [](unsigned char c) { return std::tolower(c); });
+	const auto valueStart = line.find_first_not_of(" \t", separator + 1);
+	const auto valueEnd = line.find_last_not_of(" \t\r\n");
+	std::string value;
+	if (valueStart != std::string::npos && valueEnd >= valueStart) {
+		value = line.substr(valueStart, valueEnd - valueStart + 1);
+	}
+	transfer->response.headers[name] = value;
+	return size * nitems;
+}
+
+HttpClient::HttpClient()
+{
+	if (!_curl.Initialized() || !Resolve()) {
+		blog(LOG_WARNING, "[adv-ss] http client not available");
+		return;
+	}
+
+	_multi = _multiInit();
+	if (!_multi) {
+		return;
+	}
+	_multiSetOpt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+	_multiSetOpt(_multi, CURLMOPT_MAX_HOST_CONNECTIONS, maxHostConnections);
+}
+
+HttpClient::~HttpClient()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cv.notify_all();
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+	if (_multi) {
+		_multiCleanup(_multi);
+	}
+}
+
+bool HttpClient::Resolve()
+{
+	_easyInit = _curl.GetFunction<initFunction>("curl_easy_init");
+	_easyCleanup = _curl.GetFunction<cleanupFunction>("curl_easy_cleanup");
+	_easySetOpt = _curl.GetFunction<setOptFunction>("curl_easy_setopt");
+	_easyGetInfo = _curl.GetFunction<getInfoFunction>("curl_easy_getinfo");
+	_easyStrError =
+		_curl.GetFunction<strErrorFunction>("curl_easy_strerror");
+	_slistAppend =
+		_curl.GetFunction<slistAppendFunction>("curl_slist_append");
+	_slistFree =
+		_curl.GetFunction<slistFreeFunction>("curl_slist_free_all");
+	_multiInit = _curl.GetFunction<multiInitFunction>("curl_multi_init");
+	_multiCleanup =
+		_curl.GetFunction<multiCleanupFunction>("curl_multi_cleanup");
+	_multiSetOpt =
+		_curl.GetFunction<multiSetOptFunction>("curl_multi_setopt");
+	_multiAdd =
+		_curl.GetFunction<multiHandleFunction>("curl_multi_add_handle");
+	_multiRemove = _curl.GetFunction<multiHandleFunction>(
+		"curl_multi_remove_handle");
+	_multiPerform =
+		_curl.GetFunction<multiPerformFunction>("curl_multi_perform");
+	_multiWait = _curl.GetFunction<multiWaitFunction>("curl_multi_wait");
+	_multiInfoRead = _curl.GetFunction<multiInfoReadFunction>(
+		"curl_multi_info_read");
+
+	return _easyInit && _easyCleanup && _easySetOpt && _easyGetInfo &&
+	       _easyStrError && _slistAppend && _slistFree && _multiInit &&
+	       _multiCleanup && _multiSetOpt && _multiAdd && _multiRemove &&
+	       _multiPerform && _multiWait && _multiInfoRead;
+}
+
+std::shared_future<HttpResponse> HttpClient::Submit(const HttpRequest &request,
+						    HttpCallback onComplete)
+{
+	auto transfer = std::make_unique<Transfer>();
+	transfer->request = request;
+	transfer->onComplete = std::move(onComplete);
+	auto future = transfer->promise.get_future().share();
+
+	if (!Available()) {
+		transfer->response.error = "curl not found";
+		FinishTransfer(*transfer, CURLE_FAILED_INIT);
+		return future;
+	}
+
+	std::unique_lock<std::mutex> lock(_mutex);
+	_pending.emplace_back(std::move(transfer));
+	if (!_running) {
+		if (_thread.joinable()) {
+			_thread.join();
+		}
+		_running = true;
+		_thread = std::thread(&HttpClient::Run, this);
+	}
+	lock.unlock();
+	_cv.notify_all();
+	return future;
+}
+
+bool HttpClient::StartTransfer(Transfer &transfer)
+{
+	transfer.handle = _easyInit();
+	if (!transfer.handle) {
+		return false;
+	}
+
+	auto curl = transfer.handle;
+	const auto &request = transfer.request;
+	_easySetOpt(curl, CURLOPT_URL, request.url.c_str());
+	_easySetOpt(curl, CURLOPT_NOSIGNAL, 1L);
+	_easySetOpt(curl, CURLOPT_TIMEOUT_MS, (long)request.timeout.count());
+	_easySetOpt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+	_easySetOpt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+	// Prefer waiting for an existing HTTP/2 connection to be multiplexed
+	// over opening a new connection
+	_easySetOpt(curl, CURLOPT_PIPEWAIT, 1L);
+	_easySetOpt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
+	_easySetOpt(curl, CURLOPT_WRITEDATA, &transfer);
+	_easySetOpt(curl, CURLOPT_HEADERFUNCTION, headerCallback);
+	_easySetOpt(curl, CURLOPT_HEADERDATA, &transfer);
+
+	for (const auto &header : request.headers) {
+		transfer.headers =
+			_slistAppend(transfer.headers, header.c_str());
+	}
+	if (transfer.headers) {
+		_easySetOpt(curl, CURLOPT_HTTPHEADER, transfer.headers);
+	}
+
+	switch (request.method) {
+	case HttpRequest::Method::GET:
+		_easySetOpt(curl, CURLOPT_HTTPGET, 1L);
+		break;
+	case HttpRequest::Method::POST:
+		_easySetOpt(curl, CURLOPT_POSTFIELDSIZE,
+			    (long)request.body.size());
+		_easySetOpt(curl, CURLOPT_POSTFIELDS, request.body.c_str());
+		break;
+	default:
+		break;
+	}
+
+	return _multiAdd(_multi, curl) == CURLM_OK;
+}
+
+void HttpClient::FinishTransfer(Transfer &transfer, CURLcode result)
+{
+	auto &response = transfer.response;
+	if (transfer.handle) {
+		_easyGetInfo(transfer.handle, CURLINFO_RESPONSE_CODE,
+			     &response.status);
+		_easyCleanup(transfer.handle);
+		transfer.handle = nullptr;
+	}
+	if (transfer.headers) {
+		_slistFree(transfer.headers);
+		transfer.headers = nullptr;
+	}
+
+	response.success = result == CURLE_OK;
+	if (!response.success && response.error.empty()) {
+		response.error = _easyStrError ? _easyStrError(result)
+					       : "request failed";
+	}
+	if (!response.success) {
+		vblog(LOG_INFO, "http request to \"%s\" failed: %s",
+		      transfer.request.url.c_str(), response.error.c_str());
+	}
+
+	transfer.promise.set_value(response);
+	if (transfer.onComplete) {
+		transfer.onComplete(response);
+	}
+}
+
+void HttpClient::Run()
+{
+	std::unordered_map<CURL *, std::unique_ptr<Transfer>> active;
+	std::deque<std::unique_ptr<Transfer>> aborted;
+	while (true) {
+		std::deque<std::unique_ptr<Transfer>> newTransfers;
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			if (active.empty()) {
+				_cv.wait_for(lock, workerIdleTimeout, [this]() {
+					return _stop || !_pending.empty();
+				});
+				if (_pending.empty()) {
+					_running = false;
+					break;
+				}
+			}
+			if (_stop) {
+				std::swap(aborted, _pending);
+				_running = false;
+				break;
+			}
+			std::swap(newTransfers, _pending);
+		}
+
+		for (auto &transfer : newTransfers) {
+			if (!StartTransfer(*transfer)) {
+				FinishTransfer(*transfer, CURLE_FAILED_INIT);
+				continue;
+			}
+			auto handle = transfer->handle;
+			active.emplace(handle, std::move(transfer));
+		}
+
+		int running = 0;
+		_multiPerform(_multi, &running);
+
+		int remaining = 0;
+		while (CURLMsg *msg = _multiInfoRead(_multi, &remaining)) {
+			if (msg->msg != CURLMSG_DONE) {
+				continue;
+			}
+			auto it = active.find(msg->easy_handle);
+			if (it == active.end()) {
+				continue;
+			}
+			const CURLcode result = msg->data.result;
+			_multiRemove(_multi, msg->easy_handle);
+			FinishTransfer(*it->second, result);
+			active.erase(it);
+		}
+
+		if (!active.empty()) {
+			_multiWait(_multi, nullptr, 0, multiWaitTimeoutMs,
+				   nullptr);
+		}
+	}
+
+	// Only reached with remaining transfers if the client is shutting down
+	for (auto &[handle, transfer] : active) {
+		_multiRemove(_multi, handle);
+		transfer->response.error = "request aborted";
+		FinishTransfer(*transfer, CURLE_ABORTED_BY_CALLBACK);
+	}
+	for (auto &transfer : aborted) {
+		transfer->response.error = "request aborted";
+		FinishTransfer(*transfer, CURLE_ABORTED_BY_CALLBACK);
+	}
+}
+
+static HttpClient &getClient()
+{
+	static HttpClient client;
+	return client;
+}
+
+bool HttpClientAvailable()
+{
+	return getClient().Available();
+}
+
+std::shared_future<HttpResponse> SubmitHttpRequest(const HttpRequest &request,
+						   HttpCallback onComplete)
+{
+	return getClient().Submit(request, std::move(onComplete));
+}
+
+} // namespace advss
@@ -0,0 +1,47 @@
+#pragma once
+#include <chrono>
+#include <functional>
+#include <future>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace advss {
+
+struct HttpRequest {
+	enum class Method {
+		GET,
+		POST,
+	};
+
+	std::string url;
+	Method method = Method::GET;
+	std::string body;
+	std::vector<std::string> headers;
+	std::chrono::milliseconds timeout{1000};
+	// The response body is dropped if it is not needed
+	bool keepResponseBody = true;
+};
+
+struct HttpResponse {
+	bool success = false;
+	std::string error;
+	long status = 0;
+	std::string body;
+	// The header names are converted to lower case
+	std::unordered_map<std::string, std::string> headers;
+};
+
+using HttpCallback = std::function<void(const HttpResponse &)>;
+
+// Requests are performed asynchronously by a single worker thread using a curl
+// multi handle.
+// Connections are kept alive and reused for further requests to the same host
+// and multiple requests to the same HTTP/2 server share a single connection.
+//
+// The callback is called from the worker thread once the request completed.
+bool HttpClientAvailable();
+std::shared_future<HttpResponse>
+SubmitHttpRequest(const HttpRequest &, HttpCallback onComplete = {});
+
+} // namespace advss
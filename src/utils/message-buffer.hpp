@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace advss {
+
+// Bounded buffer of received messages, which can be read by any number of
+// consumers independently.
+// Each message is assigned a sequence number and each consumer keeps a cursor
+// pointing to the next message it has not seen yet, so every consumer sees
+// every message exactly once, no matter when it reads the buffer.
+//
+// Adding a message only locks the buffer itself for a very short time, so
+// producers are never blocked by consumers processing messages.
+// If the buffer is full the oldest messages are dropped.
+template<typename T> class MessageBuffer {
+public:
+	struct Cursor {
+		uint64_t bufferId = 0;
+		uint64_t next = 0;
+	};
+
+	explicit MessageBuffer(size_t capacity = 1024);
+	MessageBuffer(const MessageBuffer &) = delete;
+	MessageBuffer &operator=(const MessageBuffer &) = delete;
+
+	void Push(T message);
+	// Returns all messages added since the cursor was last used and
+	// advances the cursor.
+	// A cursor used for the first time with this buffer will only receive
+	// messages added afterwards.
+	std::vector<T> Read(Cursor &) const;
+	// Cursor only receiving messages added afterwards
+	Cursor GetCursor() const;
+	uint64_t GetId() const { return _id; }
+
+private:
+	static uint64_t nextBufferId();
+
+	const uint64_t _id;
+	const size_t _capacity;
+	mutable std::mutex _mutex;
+	std::deque<T> _messages;
+	// Sequence number of the first message in _messages
+	uint64_t _firstSequence = 0;
+};
+
+template<typename T>
+inline MessageBuffer<T>::MessageBuffer(size_t capacity)
+	: _id(nextBufferId()), _capacity(std::max<size_t>(capacity, 1))
+{
+}
+
+template<typename T> inline uint64_t MessageBuffer<T>::nextBufferId()
+{
+	static std::atomic<uint64_t> id{1};
+	return id++;
+}
+
+template<typename T> inline void MessageBuffer<T>::Push(T message)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_messages.emplace_back(std::move(message));
+	if (_messages.size() > _capacity) {
+		_messages.pop_front();
+		++_firstSequence;
+	}
+}
+
+template<typename T>
+inline typename MessageBuffer<T>::Cursor MessageBuffer<T>::GetCursor() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return {_id, _firstSequence + _messages.size()};
+}
+
+template<typename T>
+inline std::vector<T> MessageBuffer<T>::Read(Cursor &cursor) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	const uint64_t end = _firstSequence + _messages.size();
+	if (cursor.bufferId != _id) {
+		cursor = {_id, end};
+		return {};
+	}
+
+	// Messages, which were dropped before they could be read, are skipped
+	const uint64_t start = std::max(cursor.next, _firstSequence);
+	cursor.next = end;
+	if (start >= end) {
+		return {};
+	}
+	return std::vector<T>(_messages.begin() + (start - _firstSequence),
+			      _messages.end());
+}
+
+} // namespace advss
@@ -0,0 +1,343 @@
+#include "message-dispatcher.hpp"
+
+#ifndef UNIT_TEST
+#include "regex-config.hpp"
+#endif
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace advss {
+
+using RegexKey = std::pair<QString, int>;
+
+struct MessageSubscriber {
+	bool registered = false;
+	bool useRegex = false;
+	std::string text;
+	QRegularExpression regex;
+	std::optional<std::string> match;
+};
+
+class MessageDispatcher {
+public:
+	explicit MessageDispatcher(const MessageBuffer<std::string> &buffer)
+		: _bufferId(buffer.GetId()), _cursor(buffer.GetCursor())
+	{
+	}
+	uint64_t GetBufferId() const { return _bufferId; }
+
+	void Update(MessageSubscriber *, const std::string &pattern,
+		    const std::optional<QRegularExpression> &);
+	void Remove(MessageSubscriber *);
+	void Dispatch(const MessageBuffer<std::string> &);
+	std::optional<std::string> TakeMatch(MessageSubscriber *);
+
+private:
+	struct RegexGroup {
+		QRegularExpression regex;
+		// Patterns relying on group numbers or names cannot be part of
+		// the combined expression and are always checked on their own
+		bool combinable = true;
+		std::vector<MessageSubscriber *> subscribers;
+	};
+
+	void Add(MessageSubscriber *);
+	void RemoveLocked(MessageSubscriber *);
+	void Dispatch(const std::string &message);
+	void UpdateCombinedRegex();
+
+	const uint64_t _bufferId;
+	std::mutex _mutex;
+	MessageBuffer<std::string>::Cursor _cursor;
+	std::unordered_map<std::string, std::vector<MessageSubscriber *>>
+		_exact;
+	std::map<RegexKey, RegexGroup> _regexes;
+	QRegularExpression _combinedRegex;
+	bool _combinedRegexDirty = false;
+};
+
+static RegexKey getKey(const QRegularExpression &regex)
+{
+	return {regex.pattern(), static_cast<int>(regex.patternOptions())};
+}
+
+static bool isCombinable(const QRegularExpression &regex)
+{
+	// Back references, named groups, branch reset groups, subroutine calls,
+	// recursion and conditionals would change their meaning or fail to
+	// compile as part of the combined expression
+	static const QRegularExpression groupReferences(
+		R"(\\[1-9gkK]|\(\?(P?[<'=>]|[|&(R]|[-+]?[0-9]))");
+	return regex.isValid() &&
+	       !groupReferences.match(regex.pattern()).hasMatch();
+}
+
+static QString getInlineOptions(QRegularExpression::PatternOptions options)
+{
+	QString result;
+	if (options & QRegularExpression::CaseInsensitiveOption) {
+		result += "i";
+	}
+	if (options & QRegularExpression::DotMatchesEverythingOption) {
+		result += "s";
+	}
+	if (options & QRegularExpression::MultilineOption) {
+		result += "m";
+	}
+	if (options & QRegularExpression::ExtendedPatternSyntaxOption) {
+		result += "x";
+	}
+	return result;
+}
+
+void MessageDispatcher::Update(MessageSubscriber *subscriber,
+			       const std::string &pattern,
+			       const std::optional<QRegularExpression> &regex)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	const bool useRegex = regex.has_value();
+	if (subscriber->registered && subscriber->useRegex == useRegex) {
+		if (!useRegex && subscriber->text == pattern) {
+			return;
+		}
+		if (useRegex && getKey(subscriber->regex) == getKey(*regex)) {
+			return;
+		}
+	}
+
+	RemoveLocked(subscriber);
+	subscriber->useRegex = useRegex;
+	subscriber->text = pattern;
+	subscriber->regex = useRegex ? *regex : QRegularExpression();
+	Add(subscriber);
+}
+
+void MessageDispatcher::Add(MessageSubscriber *subscriber)
+{
+	subscriber->registered = true;
+	if (!subscriber->useRegex) {
+		_exact[subscriber->text].emplace_back(subscriber);
+		return;
+	}
+
+	auto key = getKey(subscriber->regex);
+	auto it = _regexes.find(key);
+	if (it == _regexes.end()) {
+		RegexGroup group;
+		group.regex = subscriber->regex;
+		it = _regexes.emplace(key, std::move(group)).first;
+		_combinedRegexDirty = true;
+	}
+	it->second.subscribers.emplace_back(subscriber);
+}
+
+static void removeSubscriber(std::vector<MessageSubscriber *> &subscribers,
+			     MessageSubscriber *subscriber)
+{
+	subscribers.erase(std::remove(subscribers.begin(), subscribers.end(),
+				      subscriber),
+			  subscribers.end());
+}
+
+void MessageDispatcher::Remove(MessageSubscriber *subscriber)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	RemoveLocked(subscriber);
+}
+
+void MessageDispatcher::RemoveLocked(MessageSubscriber *subscriber)
+{
+	if (!subscriber->registered) {
+		return;
+	}
+	subscriber->registered = false;
+	subscriber->match.reset();
+
+	if (!subscriber->useRegex) {
+		auto it = _exact.find(subscriber->text);
+		if (it == _exact.end()) {
+			return;
+		}
+		removeSubscriber(it->second, subscriber);
+		if (it->second.empty()) {
+			_exact.erase(it);
+		}
+		return;
+	}
+
+	auto it = _regexes.find(getKey(subscriber->regex));
+	if (it == _regexes.end()) {
+		return;
+	}
+	removeSubscriber(it->second.subscribers, subscriber);
+	if (it->second.subscribers.empty()) {
+		_regexes.erase(it);
+		_combinedRegexDirty = true;
+	}
+}
+
+void MessageDispatcher::UpdateCombinedRegex()
+{
+	_combinedRegexDirty = false;
+	QStringList patterns;
+	for (auto &[_, group] : _regexes) {
+		group.combinable = isCombinable(group.regex);
+		if (!group.combinable) {
+			continue;
+		}
+		const auto options = group.regex.patternOptions();
+		// The line break terminates comments of extended patterns, but
+		// would have to be matched literally by all other patterns
+		const bool extended = options.testFlag(
+			QRegularExpression::ExtendedPatternSyntaxOption);
+		patterns << "(?" + getInlineOptions(options) + ":" +
+					group.regex.pattern() +
+					(extended ? "\n)" : ")");
+	}
+	_combinedRegex = QRegularExpression(patterns.join("|"));
+	if (patterns.isEmpty() || !_combinedRegex.isValid()) {
+		_combinedRegex = QRegularExpression();
+		for (auto &[_, group] : _regexes) {
+			group.combinable = false;
+		}
+		return;
+	}
+	_combinedRegex.optimize();
+}
+
+static void setMatch(const std::vector<MessageSubscriber *> &subscribers,
+		     const std::string &message)
+{
+	for (auto subscriber : subscribers) {
+		if (!subscriber->match) {
+			subscriber->match = message;
+		}
+	}
+}
+
+void MessageDispatcher::Dispatch(const std::string &message)
+{
+	auto it = _exact.find(message);
+	if (it != _exact.end()) {
+		setMatch(it->second, message);
+	}
+
+	if (_regexes.empty()) {
+		return;
+	}
+	const auto text = QString::fromStdString(message);
+	const bool anyCombinedMatch =
+		!_combinedRegex.pattern().isEmpty() &&
+		_combinedRegex.match(text).hasMatch();
+	for (const auto &[_, group] : _regexes) {
+		if (group.combinable && !anyCombinedMatch) {
+			continue;
+		}
+		if (group.regex.match(text).hasMatch()) {
+			setMatch(group.subscribers, message);
+		}
+	}
+}
+
+void MessageDispatcher::Dispatch(const MessageBuffer<std::string> &buffer)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	const auto messages = buffer.Read(_cursor);
+	if (messages.empty()) {
+		return;
+	}
+	if (_combinedRegexDirty) {
+		UpdateCombinedRegex();
+	}
+	for (const auto &message : messages) {
+		Dispatch(message);
+	}
+}
+
+std::optional<std::string>
+MessageDispatcher::TakeMatch(MessageSubscriber *subscriber)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto match = std::move(subscriber->match);
+	subscriber->match.reset();
+	return match;
+}
+
+static std::shared_ptr<MessageDispatcher>
+getDispatcher(const MessageBuffer<std::string> &buffer)
+{
+	static std::mutex mutex;
+	static std::unordered_map<uint64_t, std::weak_ptr<MessageDispatcher>>
+		dispatchers;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = dispatchers.begin(); it != dispatchers.end();) {
+		if (it->second.expired()) {
+			it = dispatchers.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	auto &weakDispatcher = dispatchers[buffer.GetId()];
+	auto dispatcher = weakDispatcher.lock();
+	if (!dispatcher) {
+		dispatcher = std::make_shared<MessageDispatcher>(buffer);
+		weakDispatcher = dispatcher;
+	}
+	return dispatcher;
+}
+
+MessageSubscription::MessageSubscription()
+	: _subscriber(std::make_unique<MessageSubscriber>())
+{
+}
+
+MessageSubscription::~MessageSubscription()
+{
+	Reset();
+}
+
+#ifndef UNIT_TEST
+std::optional<std::string>
+MessageSubscription::CheckForMatch(MessageBuffer<std::string> &buffer,
+				   const std::string &pattern,
+				   const RegexConfig &config)
+{
+	// Constructing the expression is cheap as it is only compiled once it
+	// is used for matching
+	return CheckForMatch(buffer, pattern,
+			     config.Enabled()
+				     ? std::optional<QRegularExpression>(
+					       config.GetRegularExpression(
+						       pattern))
+				     : std::nullopt);
+}
+#endif
+
+std::optional<std::string> MessageSubscription::CheckForMatch(
+	MessageBuffer<std::string> &buffer, const std::string &pattern,
+	const std::optional<QRegularExpression> &regex)
+{
+	if (!_dispatcher || _dispatcher->GetBufferId() != buffer.GetId()) {
+		Reset();
+		_dispatcher = getDispatcher(buffer);
+	}
+	_dispatcher->Update(_subscriber.get(), pattern, regex);
+	_dispatcher->Dispatch(buffer);
+	return _dispatcher->TakeMatch(_subscriber.get());
+}
+
+void MessageSubscription::Reset()
+{
+	if (_dispatcher) {
+		_dispatcher->Remove(_subscriber.get());
+	}
+	_dispatcher.reset();
+}
+
+} // namespace advss
@@ -0,0 +1,47 @@
+#pragma once
+#include "message-buffer.hpp"
+
+#include <QRegularExpression>
+#include <memory>
+#include <optional>
+#include <string>
+
+namespace advss {
+
+class MessageDispatcher;
+struct MessageSubscriber;
+class RegexConfig;
+
+// Subscription to the messages of a MessageBuffer matching a given pattern.
+// All subscriptions to the same buffer share a dispatcher, which reads each
+// message only once and forwards it directly to the subscriptions it matches:
+// Exact patterns are looked up by the message text and all regular expressions
+// are first checked using a single combined expression, so messages matching
+// none of them are rejected in a single pass.
+class MessageSubscription {
+public:
+	MessageSubscription();
+	~MessageSubscription();
+	MessageSubscription(const MessageSubscription &) = delete;
+	MessageSubscription &operator=(const MessageSubscription &) = delete;
+
+	// Returns the first message matching the pattern, which was received
+	// by the buffer since the last call.
+	// Changing the buffer or the pattern discards pending matches and only
+	// messages received afterwards will be considered.
+	std::optional<std::string> CheckForMatch(MessageBuffer<std::string> &,
+						 const std::string &pattern,
+						 const RegexConfig &);
+	// Messages are matched using the regular expression, if one is given,
+	// and compared to the pattern otherwise
+	std::optional<std::string>
+	CheckForMatch(MessageBuffer<std::string> &, const std::string &pattern,
+		      const std::optional<QRegularExpression> &);
+	void Reset();
+
+private:
+	std::shared_ptr<MessageDispatcher> _dispatcher;
+	std::unique_ptr<MessageSubscriber> _subscriber;
+};
+
+} // namespace advss
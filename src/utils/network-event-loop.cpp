@@ -0,0 +1,72 @@
+#include "network-event-loop.hpp"
+#include "log-helper.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace advss {
+
+constexpr int networkThreadCount = 2;
+
+namespace {
+
+class NetworkEventLoop {
+public:
+	NetworkEventLoop();
+	~NetworkEventLoop();
+	websocketpp::lib::asio::io_service &Get() { return _ioService; }
+
+private:
+	void Run();
+
+	websocketpp::lib::asio::io_service _ioService;
+	// Keeps the threads running while there is nothing to do
+	std::unique_ptr<websocketpp::lib::asio::io_service::work> _work;
+	std::vector<std::thread> _threads;
+};
+
+} // namespace
+
+NetworkEventLoop::NetworkEventLoop()
+	: _work(std::make_unique<websocketpp::lib::asio::io_service::work>(
+		  _ioService))
+{
+	for (int i = 0; i < networkThreadCount; i++) {
+		_threads.emplace_back(&NetworkEventLoop::Run, this);
+	}
+}
+
+NetworkEventLoop::~NetworkEventLoop()
+{
+	_work.reset();
+	_ioService.stop();
+	for (auto &thread : _threads) {
+		if (thread.joinable()) {
+			thread.join();
+		}
+	}
+}
+
+void NetworkEventLoop::Run()
+{
+	while (!_ioService.stopped()) {
+		// An exception thrown by a handler must not stop the event
+		// loop for all other connections
+		try {
+			_ioService.run();
+		} catch (const std::exception &e) {
+			blog(LOG_WARNING,
+			     "network event loop handler failed: %s",
+			     e.what());
+		}
+	}
+}
+
+websocketpp::lib::asio::io_service &GetNetworkEventLoop()
+{
+	static NetworkEventLoop loop;
+	return loop.Get();
+}
+
+} // namespace advss
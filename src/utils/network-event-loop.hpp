@@ -0,0 +1,12 @@
+#pragma once
+#include <websocketpp/common/asio.hpp>
+
+namespace advss {
+
+// Event loop shared by all websocket clients and servers.
+// It is served by a small fixed pool of threads, so the number of network
+// threads does not grow with the number of connections.
+// Handlers might be run concurrently by different threads of the pool.
+websocketpp::lib::asio::io_service &GetNetworkEventLoop();
+
+} // namespace advss
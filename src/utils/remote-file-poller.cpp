@@ -0,0 +1,296 @@
+#include "remote-file-poller.hpp"
+#include "http-client.hpp"
+#include "log-helper.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace advss {
+
+using Clock = std::chrono::steady_clock;
+
+class RemoteFile {
+public:
+	RemoteFile(const std::string &url) : _url(url) {}
+	const std::string &GetURL() const { return _url; }
+
+	// Returns true if the period was changed
+	bool SetPeriod(const RemoteFileSubscription *,
+		       std::chrono::milliseconds period);
+	void RemovePeriod(const RemoteFileSubscription *);
+	std::chrono::milliseconds GetPeriod() const;
+
+	std::shared_ptr<const RemoteFileContent> GetContent() const;
+	HttpRequest CreateRequest() const;
+	void HandleResponse(const HttpResponse &);
+
+	// Only accessed by the poller while holding its lock
+	Clock::time_point lastPoll;
+	bool pollPending = false;
+
+private:
+	const std::string _url;
+	mutable std::mutex _mutex;
+	std::map<const RemoteFileSubscription *, std::chrono::milliseconds>
+		_periods;
+	std::shared_ptr<const RemoteFileContent> _content;
+	std::string _etag;
+	std::string _lastModified;
+};
+
+namespace {
+
+class RemoteFilePoller {
+public:
+	~RemoteFilePoller();
+	std::shared_ptr<RemoteFile> GetFile(const std::string &url);
+	void Wake() { _cv.notify_all(); }
+
+private:
+	void Run();
+	void Poll(const std::shared_ptr<RemoteFile> &);
+
+	std::mutex _mutex;
+	std::condition_variable _cv;
+	std::vector<std::weak_ptr<RemoteFile>> _files;
+	std::thread _thread;
+	bool _running = false;
+	bool _stop = false;
+};
+
+} // namespace
+
+// Limits how long changes of the poll periods might go unnoticed
+constexpr auto maxPollerSleep = std::chrono::seconds(1);
+constexpr auto minPollPeriod = std::chrono::milliseconds(100);
+constexpr auto minRequestTimeout = std::chrono::seconds(1);
+constexpr auto maxRequestTimeout = std::chrono::seconds(10);
+
+static RemoteFilePoller poller;
+
+bool RemoteFile::SetPeriod(const RemoteFileSubscription *subscription,
+			   std::chrono::milliseconds period)
+{
+	period = std::max<std::chrono::milliseconds>(period, minPollPeriod);
+	std::lock_guard<std::mutex> lock(_mutex);
+	auto it = _periods.find(subscription);
+	if (it != _periods.end() && it->second == period) {
+		return false;
+	}
+	_periods[subscription] = period;
+	return true;
+}
+
+void RemoteFile::RemovePeriod(const RemoteFileSubscription *subscription)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_periods.erase(subscription);
+}
+
+std::chrono::milliseconds RemoteFile::GetPeriod() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_periods.empty()) {
+		return minPollPeriod;
+	}
+	return std::min_element(_periods.begin(), _periods.end(),
+				[](const auto &a, const auto &b) {
+					return a.second < b.second;
+				})
+		->second;
+}
+
+std::shared_ptr<const RemoteFileContent> RemoteFile::GetContent() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _content;
+}
+
+HttpRequest RemoteFile::CreateRequest() const
+{
+	HttpRequest request;
+	request.url = _url;
+	request.timeout = std::clamp<std::chrono::milliseconds>(
+		GetPeriod(), minRequestTimeout, maxRequestTimeout);
+
+	// Allows the server to respond with "304 Not Modified" instead of
+	// sending the unchanged file again
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (!_etag.empty()) {
+		request.headers.emplace_back("If-None-Match: " + _etag);
+	}
+	if (!_lastModified.empty()) {
+		request.headers.emplace_back("If-Modified-Since: " +
+					     _lastModified);
+	}
+	return request;
+}
+
+static std::string getHeader(const HttpResponse &response,
+			     const std::string &name)
+{
+	auto it = response.headers.find(name);
+	return it == response.headers.end() ? "" : it->second;
+}
+
+void RemoteFile::HandleResponse(const HttpResponse &response)
+{
+	if (!response.success || response.status == 304) {
+		return;
+	}
+	if (response.status < 200 || response.status >= 300) {
+		vblog(LOG_INFO, "failed to get remote file \"%s\" (status %ld)",
+		      _url.c_str(), response.status);
+		return;
+	}
+
+	auto content = std::make_shared<RemoteFileContent>();
+	content->data = response.body;
+	content->hash = std::hash<std::string>{}(content->data);
+	content->lastModified = getHeader(response, "last-modified");
+
+	std::lock_guard<std::mutex> lock(_mutex);
+	_etag = getHeader(response, "etag");
+	_lastModified = content->lastModified;
+	_content = content;
+}
+
+RemoteFilePoller::~RemoteFilePoller()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_cv.notify_all();
+	if (_thread.joinable()) {
+		_thread.join();
+	}
+}
+
+std::shared_ptr<RemoteFile> RemoteFilePoller::GetFile(const std::string &url)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_files.erase(std::remove_if(_files.begin(), _files.end(),
+				    [](const std::weak_ptr<RemoteFile> &file) {
+					    return file.expired();
+				    }),
+		     _files.end());
+	for (const auto &weakFile : _files) {
+		auto file = weakFile.lock();
+		if (file && file->GetURL() == url) {
+			return file;
+		}
+	}
+
+	auto file = std::make_shared<RemoteFile>(url);
+	_files.emplace_back(file);
+
+	// The poller thread exits once there are no files left to poll
+	if (!_running) {
+		if (_thread.joinable()) {
+			_thread.join();
+		}
+		_running = true;
+		_thread = std::thread(&RemoteFilePoller::Run, this);
+	}
+	_cv.notify_all();
+	return file;
+}
+
+void RemoteFilePoller::Poll(const std::shared_ptr<RemoteFile> &file)
+{
+	std::weak_ptr<RemoteFile> weakFile = file;
+	SubmitHttpRequest(file->CreateRequest(),
+			  [this, weakFile](const HttpResponse &response) {
+				  auto file = weakFile.lock();
+				  if (!file) {
+					  return;
+				  }
+				  file->HandleResponse(response);
+				  std::lock_guard<std::mutex> lock(_mutex);
+				  file->lastPoll = Clock::now();
+				  file->pollPending = false;
+				  _cv.notify_all();
+			  });
+}
+
+void RemoteFilePoller::Run()
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	while (!_stop) {
+		std::vector<std::shared_ptr<RemoteFile>> dueFiles;
+		auto nextPoll = Clock::time_point::max();
+		const auto now = Clock::now();
+		for (const auto &weakFile : _files) {
+			auto file = weakFile.lock();
+			if (!file || file->pollPending) {
+				continue;
+			}
+			const auto due = file->lastPoll + file->GetPeriod();
+			if (due <= now) {
+				file->pollPending = true;
+				dueFiles.emplace_back(file);
+			} else {
+				nextPoll = std::min(nextPoll, due);
+			}
+		}
+
+		// The completion of a request might be reported right away,
+		// which requires the lock
+		lock.unlock();
+		for (const auto &file : dueFiles) {
+			Poll(file);
+		}
+		dueFiles.clear();
+		lock.lock();
+
+		_files.erase(std::remove_if(
+				     _files.begin(), _files.end(),
+				     [](const std::weak_ptr<RemoteFile> &file) {
+					     return file.expired();
+				     }),
+			     _files.end());
+		if (_files.empty()) {
+			break;
+		}
+		_cv.wait_until(lock, std::min(nextPoll, now + maxPollerSleep));
+	}
+	_running = false;
+}
+
+RemoteFileSubscription::RemoteFileSubscription(const std::string &url,
+					       std::chrono::milliseconds period)
+	: _file(poller.GetFile(url))
+{
+	_file->SetPeriod(this, period);
+	poller.Wake();
+}
+
+RemoteFileSubscription::~RemoteFileSubscription()
+{
+	_file->RemovePeriod(this);
+}
+
+bool RemoteFileSubscription::UsesURL(const std::string &url) const
+{
+	return _file->GetURL() == url;
+}
+
+void RemoteFileSubscription::SetPeriod(std::chrono::milliseconds period)
+{
+	if (_file->SetPeriod(this, period)) {
+		poller.Wake();
+	}
+}
+
+std::shared_ptr<const RemoteFileContent>
+RemoteFileSubscription::GetContent() const
+{
+	return _file->GetContent();
+}
+
+} // namespace advss
@@ -0,0 +1,43 @@
+#pragma once
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace advss {
+
+class RemoteFile;
+
+struct RemoteFileContent {
+	std::string data;
+	size_t hash = 0;
+	// Value of the Last-Modified header, if provided by the server
+	std::string lastModified;
+};
+
+// Subscription to the content of a remote file.
+// The file is downloaded in the background and shared by all subscriptions
+// for the same URL.
+// If the server supports it, the file is only downloaded again if it was
+// modified since it was last downloaded.
+//
+// If subscriptions request different poll periods for the same URL, the
+// shortest one is used.
+class RemoteFileSubscription {
+public:
+	RemoteFileSubscription(const std::string &url,
+			       std::chrono::milliseconds period);
+	~RemoteFileSubscription();
+	RemoteFileSubscription(const RemoteFileSubscription &) = delete;
+	RemoteFileSubscription &
+	operator=(const RemoteFileSubscription &) = delete;
+
+	bool UsesURL(const std::string &url) const;
+	void SetPeriod(std::chrono::milliseconds period);
+	// Returns nullptr until the file was downloaded successfully
+	std::shared_ptr<const RemoteFileContent> GetContent() const;
+
+private:
+	std::shared_ptr<RemoteFile> _file;
+};
+
+} // namespace advss
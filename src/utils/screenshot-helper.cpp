@@ -1,16 +1,25 @@
 #include "screenshot-helper.hpp"
 #include "advanced-scene-switcher.hpp"
 
+#include <algorithm>
 #include <chrono>
 
 namespace advss {
 
 static void ScreenshotTick(void *param, float);
 
-ScreenshotHelper::ScreenshotHelper(obs_source_t *source, bool blocking,
+#define STAGE_SCREENSHOT 0
+#define STAGE_DOWNLOAD 1
+#define STAGE_COPY_AND_SAVE 2
+#define STAGE_FINISH 3
+
+ScreenshotHelper::ScreenshotHelper(obs_source_t *source,
+				   const QRect &subarea, bool blocking,
 				   int timeout, bool saveToFile,
-				   std::string path)
+				   std::string path, double scale)
 	: weakSource(OBSGetWeakRef(source)),
+	  _subarea(subarea),
+	  _scale(scale),
 	  _blocking(blocking),
 	  _saveToFile(saveToFile),
 	  _path(path)
@@ -19,36 +28,61 @@ ScreenshotHelper::ScreenshotHelper(obs_source_t *source, bool blocking,
 	_initDone = true;
 	obs_add_tick_callback(ScreenshotTick, this);
 	if (_blocking) {
-		auto res =
-			_cv.wait_for(lock, std::chrono::milliseconds(timeout));
-		if (res == std::cv_status::timeout) {
-			if (source) {
-				blog(LOG_WARNING,
-				     "Failed to get screenshot in time for source %s",
-				     obs_source_get_name(source));
-			} else {
-				blog(LOG_WARNING,
-				     "Failed to get screenshot in time");
-			}
-		}
+		WaitUntilDone(lock, timeout);
+	}
+}
+
+void ScreenshotHelper::Retake(bool blocking, int timeout)
+{
+	std::unique_lock<std::mutex> lock(_mutex);
+	_blocking = blocking;
+
+	// The previous screenshot is still in progress, so there is no need
+	// to start another one
+	//
+	// The tick callback does not modify the stage anymore once the
+	// screenshot is done, so it can safely be restarted here
+	if (done) {
+		done = false;
+		stage = STAGE_SCREENSHOT;
+	}
+	if (_blocking) {
+		WaitUntilDone(lock, timeout);
+	}
+}
+
+void ScreenshotHelper::WaitUntilDone(std::unique_lock<std::mutex> &lock,
+				     int timeout)
+{
+	if (_cv.wait_for(lock, std::chrono::milliseconds(timeout),
+			 [this]() { return done.load(); })) {
+		return;
+	}
+	OBSSource source = OBSGetStrongRef(weakSource);
+	if (source) {
+		blog(LOG_WARNING,
+		     "Failed to get screenshot in time for source %s",
+		     obs_source_get_name(source));
+	} else {
+		blog(LOG_WARNING, "Failed to get screenshot in time");
 	}
 }
 
 ScreenshotHelper::~ScreenshotHelper()
 {
+	obs_remove_tick_callback(ScreenshotTick, this);
 	if (_initDone) {
 		obs_enter_graphics();
 		gs_stagesurface_destroy(stagesurf);
 		gs_texrender_destroy(texrender);
 		obs_leave_graphics();
 	}
-	obs_remove_tick_callback(ScreenshotTick, this);
 	if (_saveThread.joinable()) {
 		_saveThread.join();
 	}
 }
 
-void ScreenshotHelper::Screenshot()
+bool ScreenshotHelper::Screenshot()
 {
 	OBSSource source = OBSGetStrongRef(weakSource);
 
@@ -62,17 +96,44 @@ void ScreenshotHelper::Screenshot()
 		cy = ovi.base_height;
 	}
 
+	// Only render the requested area of the source to avoid staging and
+	// copying pixels which will be discarded anyway.
+	// Parts of the area outside of the source will be left transparent.
+	float left = 0.0f;
+	float top = 0.0f;
+	if (cx && cy && _subarea.isValid()) {
+		left = (float)_subarea.x();
+		top = (float)_subarea.y();
+		cx = _subarea.width();
+		cy = _subarea.height();
+	}
+	const float width = (float)cx;
+	const float height = (float)cy;
+
+	// Let the GPU take care of downscaling the image
+	if (cx && cy && _scale > 0.0 && _scale < 1.0) {
+		cx = std::max<uint32_t>(1, (uint32_t)(cx * _scale + 0.5));
+		cy = std::max<uint32_t>(1, (uint32_t)(cy * _scale + 0.5));
+	}
+
 	if (!cx || !cy) {
 		vblog(LOG_WARNING,
 		      "Cannot screenshot \"%s\", invalid target size",
 		      obs_source_get_name(source));
-		obs_remove_tick_callback(ScreenshotTick, this);
-		done = true;
-		return;
+		return false;
 	}
 
-	texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
-	stagesurf = gs_stagesurface_create(cx, cy, GS_RGBA);
+	if (!texrender) {
+		texrender = gs_texrender_create(GS_RGBA, GS_ZS_NONE);
+	}
+	if (stagesurf && (gs_stagesurface_get_width(stagesurf) != cx ||
+			  gs_stagesurface_get_height(stagesurf) != cy)) {
+		gs_stagesurface_destroy(stagesurf);
+		stagesurf = nullptr;
+	}
+	if (!stagesurf) {
+		stagesurf = gs_stagesurface_create(cx, cy, GS_RGBA);
+	}
 
 	gs_texrender_reset(texrender);
 	if (gs_texrender_begin(texrender, cx, cy)) {
@@ -80,7 +141,8 @@ void ScreenshotHelper::Screenshot()
 		vec4_zero(&zero);
 
 		gs_clear(GS_CLEAR_COLOR, &zero, 0.0f, 0);
-		gs_ortho(0.0f, (float)cx, 0.0f, (float)cy, -100.0f, 100.0f);
+		gs_ortho(left, left + width, top, top + height, -100.0f,
+			 100.0f);
 
 		gs_blend_state_push();
 		gs_blend_function(GS_BLEND_ONE, GS_BLEND_ZERO);
@@ -96,6 +158,7 @@ void ScreenshotHelper::Screenshot()
 		gs_blend_state_pop();
 		gs_texrender_end(texrender);
 	}
+	return true;
 }
 
 void ScreenshotHelper::Download()
@@ -108,7 +171,10 @@ void ScreenshotHelper::Copy()
 	uint8_t *videoData = nullptr;
 	uint32_t videoLinesize = 0;
 
-	image = QImage(cx, cy, QImage::Format::Format_RGBA8888);
+	// Writing to the image will detach it if it is still in use elsewhere
+	if (image.width() != (int)cx || image.height() != (int)cy) {
+		image = QImage(cx, cy, QImage::Format::Format_RGBA8888);
+	}
 
 	if (gs_stagesurface_map(stagesurf, &videoData, &videoLinesize)) {
 		int linesize = image.bytesPerLine();
@@ -120,11 +186,13 @@ void ScreenshotHelper::Copy()
 	}
 }
 
+// Must only be called from the tick callback after the stage was set to
+// STAGE_FINISH
 void ScreenshotHelper::MarkDone()
 {
+	std::unique_lock<std::mutex> lock(_mutex);
 	time = std::chrono::high_resolution_clock::now();
 	done = true;
-	std::unique_lock<std::mutex> lock(_mutex);
 	_cv.notify_all();
 }
 
@@ -134,6 +202,9 @@ void ScreenshotHelper::WriteToFile()
 		return;
 	}
 
+	if (_saveThread.joinable()) {
+		_saveThread.join();
+	}
 	_saveThread = std::thread([this]() {
 		if (image.save(QString::fromStdString(_path))) {
 			vblog(LOG_INFO, "Wrote screenshot to \"%s\"",
@@ -146,11 +217,6 @@ void ScreenshotHelper::WriteToFile()
 	});
 }
 
-#define STAGE_SCREENSHOT 0
-#define STAGE_DOWNLOAD 1
-#define STAGE_COPY_AND_SAVE 2
-#define STAGE_FINISH 3
-
 static void ScreenshotTick(void *param, float)
 {
 	ScreenshotHelper *data = reinterpret_cast<ScreenshotHelper *>(param);
@@ -163,23 +229,26 @@ static void ScreenshotTick(void *param, float)
 
 	switch (data->stage) {
 	case STAGE_SCREENSHOT:
-		data->Screenshot();
+		if (data->Screenshot()) {
+			data->stage = STAGE_DOWNLOAD;
+		} else {
+			data->stage = STAGE_FINISH;
+			data->MarkDone();
+		}
 		break;
 	case STAGE_DOWNLOAD:
 		data->Download();
+		data->stage = STAGE_COPY_AND_SAVE;
 		break;
 	case STAGE_COPY_AND_SAVE:
 		data->Copy();
 		data->WriteToFile();
+		data->stage = STAGE_FINISH;
 		data->MarkDone();
-
-		obs_remove_tick_callback(ScreenshotTick, data);
 		break;
 	}
 
 	obs_leave_graphics();
-
-	data->stage++;
 }
 
 } // namespace advss
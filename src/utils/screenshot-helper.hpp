@@ -1,7 +1,9 @@
 #pragma once
 #include <obs.hpp>
+#include <atomic>
 #include <string>
 #include <QImage>
+#include <QRect>
 #include <chrono>
 #include <thread>
 #include <mutex>
@@ -12,14 +14,24 @@ namespace advss {
 class ScreenshotHelper {
 public:
 	ScreenshotHelper() = default;
-	ScreenshotHelper(obs_source_t *source, bool blocking = false,
-			 int timeout = 1000, bool saveToFile = false,
-			 std::string path = "");
+	// If a valid subarea is provided only that part of the source will be
+	// rendered, staged and copied into the resulting image.
+	// A scale below 1 will downscale the image while rendering it.
+	ScreenshotHelper(obs_source_t *source, const QRect &subarea = QRect(),
+			 bool blocking = false, int timeout = 1000,
+			 bool saveToFile = false, std::string path = "",
+			 double scale = 1.0);
 	ScreenshotHelper &operator=(const ScreenshotHelper &) = delete;
 	ScreenshotHelper(const ScreenshotHelper &) = delete;
 	~ScreenshotHelper();
 
-	void Screenshot();
+	// Takes another screenshot of the same source and area.
+	// The GPU resources and the image memory of the previous screenshot
+	// will be reused if possible.
+	void Retake(bool blocking = false, int timeout = 1000);
+
+	// Returns false if there is nothing to render
+	bool Screenshot();
 	void Download();
 	void Copy();
 	void MarkDone();
@@ -32,13 +44,20 @@ public:
 	uint32_t cx = 0;
 	uint32_t cy = 0;
 
-	int stage = 0;
+	// Only modified by the tick callback while a screenshot is in progress
+	// and by Retake() once it is done.
+	// The tick callback stays registered until the helper is destroyed.
+	std::atomic_int stage = {0};
 
-	bool done = false;
+	std::atomic_bool done = {false};
 	std::chrono::high_resolution_clock::time_point time;
 
 private:
+	void WaitUntilDone(std::unique_lock<std::mutex> &, int timeout);
+
 	std::atomic_bool _initDone = false;
+	QRect _subarea = QRect();
+	double _scale = 1.0;
 	bool _blocking = false;
 	std::thread _saveThread;
 	bool _saveToFile = false;
@@ -0,0 +1,422 @@
+#include "volmeter-registry.hpp"
+#include "log-helper.hpp"
+
+#include <util/platform.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+namespace advss {
+
+struct AudioLevels {
+	std::atomic<float> peak{-std::numeric_limits<float>::infinity()};
+	std::atomic<float> magnitude{-std::numeric_limits<float>::infinity()};
+
+	std::function<void()> onThresholdCrossed;
+	// Accessed using the atomic shared_ptr functions
+	std::shared_ptr<const LevelWatch> watch;
+	// Only accessed by the audio thread
+	bool aboveThreshold = false;
+};
+
+bool LevelWatch::operator==(const LevelWatch &other) const
+{
+	return measure == other.measure && window == other.window &&
+	       threshold == other.threshold &&
+	       hysteresis == other.hysteresis &&
+	       percentile == other.percentile && minTime == other.minTime;
+}
+
+namespace {
+
+struct LevelSample {
+	uint64_t time = 0;
+	float peak = 0.f;
+	float magnitude = 0.f;
+};
+
+// Ring buffer of the levels of the most recent audio packets.
+// The levels are only written by the audio thread, so readers never block it.
+// A sample which is overwritten while it is being read is detected and
+// skipped.
+class LevelHistory {
+public:
+	void Add(uint64_t time, float peak, float magnitude);
+	// Calls the function for each sample not older than the given time,
+	// newest first, without allocating any memory
+	template<typename Func> void ForEach(uint64_t since, Func &&) const;
+
+private:
+	struct Slot {
+		std::atomic<uint64_t> time{0};
+		std::atomic<float> peak{0.f};
+		std::atomic<float> magnitude{0.f};
+	};
+
+	// Audio packets usually cover about 21 ms, so this is enough to cover
+	// maxLevelWindow
+	static constexpr size_t _size = 4096;
+	std::array<Slot, _size> _slots;
+	std::atomic<uint64_t> _count{0};
+};
+
+} // namespace
+
+void LevelHistory::Add(uint64_t time, float peak, float magnitude)
+{
+	const auto count = _count.load(std::memory_order_relaxed);
+	auto &slot = _slots[count % _size];
+	slot.time.store(0, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	slot.peak.store(peak, std::memory_order_relaxed);
+	slot.magnitude.store(magnitude, std::memory_order_relaxed);
+	slot.time.store(time, std::memory_order_release);
+	_count.store(count + 1, std::memory_order_release);
+}
+
+template<typename Func>
+void LevelHistory::ForEach(uint64_t since, Func &&func) const
+{
+	const auto count = _count.load(std::memory_order_acquire);
+	const auto available = std::min<uint64_t>(count, _size);
+	for (uint64_t i = 1; i <= available; i++) {
+		const auto &slot = _slots[(count - i) % _size];
+		LevelSample sample;
+		sample.time = slot.time.load(std::memory_order_acquire);
+		sample.peak = slot.peak.load(std::memory_order_relaxed);
+		sample.magnitude =
+			slot.magnitude.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sample.time == 0 ||
+		    slot.time.load(std::memory_order_relaxed) != sample.time) {
+			continue;
+		}
+		if (sample.time < since) {
+			break;
+		}
+		func(sample);
+	}
+}
+
+static float getPeak(const LevelHistory &history, uint64_t since)
+{
+	float peak = -std::numeric_limits<float>::infinity();
+	history.ForEach(since, [&peak](const LevelSample &sample) {
+		peak = std::max(peak, sample.peak);
+	});
+	return peak;
+}
+
+static float getRMS(const LevelHistory &history, uint64_t since)
+{
+	// The magnitude of each packet is its RMS level already
+	double sum = 0.;
+	size_t count = 0;
+	history.ForEach(since, [&sum, &count](const LevelSample &sample) {
+		const double amplitude = std::pow(10., sample.magnitude / 20.);
+		sum += amplitude * amplitude;
+		count++;
+	});
+	if (count == 0) {
+		return -std::numeric_limits<float>::infinity();
+	}
+	return static_cast<float>(20. * std::log10(std::sqrt(sum / count)));
+}
+
+// The peaks are collected in the given vector, so its memory can be reused
+static float getPercentile(const LevelHistory &history, uint64_t since,
+			   double percentile, std::vector<float> &peaks)
+{
+	peaks.clear();
+	history.ForEach(since, [&peaks](const LevelSample &sample) {
+		peaks.emplace_back(sample.peak);
+	});
+	if (peaks.empty()) {
+		return -std::numeric_limits<float>::infinity();
+	}
+	const double rank =
+		std::clamp(percentile, 0., 100.) / 100. * (peaks.size() - 1);
+	auto nth = peaks.begin() + static_cast<size_t>(std::lround(rank));
+	std::nth_element(peaks.begin(), nth, peaks.end());
+	return *nth;
+}
+
+static uint64_t getTimeAbove(const LevelHistory &history, uint64_t since,
+			     float threshold)
+{
+	// Each packet covers the time since the previous one
+	uint64_t timeAbove = 0;
+	bool hasNewer = false;
+	LevelSample newer;
+	history.ForEach(since, [&](const LevelSample &sample) {
+		if (hasNewer && newer.peak > threshold &&
+		    newer.time > sample.time) {
+			timeAbove += newer.time - sample.time;
+		}
+		hasNewer = true;
+		newer = sample;
+	});
+	if (hasNewer && newer.peak > threshold && newer.time > since) {
+		timeAbove += newer.time - since;
+	}
+	return timeAbove;
+}
+
+class SharedVolmeter {
+public:
+	SharedVolmeter(const OBSWeakSource &source);
+	~SharedVolmeter();
+	SharedVolmeter(const SharedVolmeter &) = delete;
+	SharedVolmeter &operator=(const SharedVolmeter &) = delete;
+
+	const OBSWeakSource &GetSource() const { return _source; }
+	void Subscribe(const std::shared_ptr<AudioLevels> &);
+	void Unsubscribe(const std::shared_ptr<AudioLevels> &);
+	const LevelHistory &GetHistory() const { return _history; }
+
+private:
+	static void SetVolumeLevel(void *data,
+				   const float magnitude[MAX_AUDIO_CHANNELS],
+				   const float peak[MAX_AUDIO_CHANNELS],
+				   const float inputPeak[MAX_AUDIO_CHANNELS]);
+
+	const OBSWeakSource _source;
+	obs_volmeter_t *_volmeter = nullptr;
+	std::mutex _mutex;
+	std::vector<std::shared_ptr<AudioLevels>> _subscribers;
+	LevelHistory _history;
+};
+
+SharedVolmeter::SharedVolmeter(const OBSWeakSource &source) : _source(source)
+{
+	_volmeter = obs_volmeter_create(OBS_FADER_LOG);
+	obs_volmeter_add_callback(_volmeter, SetVolumeLevel, this);
+	obs_source_t *as = obs_weak_source_get_source(source);
+	if (!obs_volmeter_attach_source(_volmeter, as)) {
+		const char *name = obs_source_get_name(as);
+		blog(LOG_WARNING, "failed to attach volmeter to source %s",
+		     name);
+	}
+	obs_source_release(as);
+}
+
+SharedVolmeter::~SharedVolmeter()
+{
+	obs_volmeter_remove_callback(_volmeter, SetVolumeLevel, this);
+	obs_volmeter_destroy(_volmeter);
+}
+
+void SharedVolmeter::Subscribe(const std::shared_ptr<AudioLevels> &levels)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_subscribers.emplace_back(levels);
+}
+
+void SharedVolmeter::Unsubscribe(const std::shared_ptr<AudioLevels> &levels)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_subscribers.erase(std::remove(_subscribers.begin(), _subscribers.end(),
+				       levels),
+			   _subscribers.end());
+}
+
+static void updateMax(std::atomic<float> &value, float newValue)
+{
+	float current = value.load();
+	while (newValue > current &&
+	       !value.compare_exchange_weak(current, newValue)) {
+	}
+}
+
+static uint64_t getWindowStart(uint64_t now, std::chrono::milliseconds window)
+{
+	using namespace std::chrono;
+	const auto duration = duration_cast<nanoseconds>(
+		std::min<milliseconds>(window, maxLevelWindow));
+	const uint64_t length = std::max<int64_t>(duration.count(), 0);
+	return now > length ? now - length : 0;
+}
+
+static uint64_t getWindowStart(std::chrono::milliseconds window)
+{
+	return getWindowStart(os_gettime_ns(), window);
+}
+
+static bool isAboveThreshold(const LevelWatch &watch,
+			     const LevelHistory &history, uint64_t now,
+			     bool wasAbove)
+{
+	// Only used by the audio thread
+	thread_local std::vector<float> peaks;
+
+	const auto since = getWindowStart(now, watch.window);
+	float level = -std::numeric_limits<float>::infinity();
+	switch (watch.measure) {
+	case LevelWatch::Measure::PEAK:
+		level = getPeak(history, since);
+		break;
+	case LevelWatch::Measure::RMS:
+		level = getRMS(history, since);
+		break;
+	case LevelWatch::Measure::PERCENTILE:
+		level = getPercentile(history, since, watch.percentile, peaks);
+		break;
+	case LevelWatch::Measure::TIME_ABOVE: {
+		const auto minTime =
+			std::chrono::duration_cast<std::chrono::nanoseconds>(
+				watch.minTime);
+		return getTimeAbove(history, since, watch.threshold) >=
+		       static_cast<uint64_t>(
+			       std::max<int64_t>(minTime.count(), 0));
+	}
+	default:
+		break;
+	}
+	if (wasAbove) {
+		return level >= watch.threshold - watch.hysteresis;
+	}
+	return level > watch.threshold;
+}
+
+static void checkThreshold(AudioLevels &levels, const LevelHistory &history,
+			   uint64_t now)
+{
+	const auto watch = std::atomic_load(&levels.watch);
+	if (!watch) {
+		return;
+	}
+
+	const bool wasAbove = levels.aboveThreshold;
+	levels.aboveThreshold =
+		isAboveThreshold(*watch, history, now, wasAbove);
+	if (levels.aboveThreshold != wasAbove && levels.onThresholdCrossed) {
+		levels.onThresholdCrossed();
+	}
+}
+
+void SharedVolmeter::SetVolumeLevel(void *data,
+				    const float magnitude[MAX_AUDIO_CHANNELS],
+				    const float peak[MAX_AUDIO_CHANNELS],
+				    const float *)
+{
+	auto volmeter = static_cast<SharedVolmeter *>(data);
+
+	// Only determine the levels once for all subscribers
+	float maxPeak = -std::numeric_limits<float>::infinity();
+	float maxMagnitude = -std::numeric_limits<float>::infinity();
+	for (int i = 0; i < MAX_AUDIO_CHANNELS; i++) {
+		maxPeak = std::max(maxPeak, peak[i]);
+		maxMagnitude = std::max(maxMagnitude, magnitude[i]);
+	}
+	const uint64_t now = os_gettime_ns();
+	volmeter->_history.Add(now, maxPeak, maxMagnitude);
+
+	std::lock_guard<std::mutex> lock(volmeter->_mutex);
+	for (const auto &levels : volmeter->_subscribers) {
+		updateMax(levels->peak, maxPeak);
+		levels->magnitude = maxMagnitude;
+		checkThreshold(*levels, volmeter->_history, now);
+	}
+}
+
+static std::mutex volmetersMutex;
+static std::vector<std::weak_ptr<SharedVolmeter>> volmeters;
+
+static std::shared_ptr<SharedVolmeter> getVolmeter(const OBSWeakSource &source)
+{
+	std::lock_guard<std::mutex> lock(volmetersMutex);
+	volmeters.erase(std::remove_if(volmeters.begin(), volmeters.end(),
+				       [](const auto &volmeter) {
+					       return volmeter.expired();
+				       }),
+			volmeters.end());
+	for (const auto &weakVolmeter : volmeters) {
+		auto volmeter = weakVolmeter.lock();
+		if (volmeter && volmeter->GetSource() == source) {
+			return volmeter;
+		}
+	}
+	auto volmeter = std::make_shared<SharedVolmeter>(source);
+	volmeters.emplace_back(volmeter);
+	return volmeter;
+}
+
+VolmeterSubscription::VolmeterSubscription(
+	const OBSWeakSource &source, std::function<void()> onThresholdCrossed)
+	: _volmeter(getVolmeter(source)),
+	  _levels(std::make_shared<AudioLevels>())
+{
+	_levels->onThresholdCrossed = std::move(onThresholdCrossed);
+	_volmeter->Subscribe(_levels);
+}
+
+VolmeterSubscription::~VolmeterSubscription()
+{
+	_volmeter->Unsubscribe(_levels);
+}
+
+bool VolmeterSubscription::UsesSource(const OBSWeakSource &source) const
+{
+	return _volmeter->GetSource() == source;
+}
+
+float VolmeterSubscription::TakePeak()
+{
+	return _levels->peak.exchange(-std::numeric_limits<float>::infinity());
+}
+
+float VolmeterSubscription::GetMagnitude() const
+{
+	return _levels->magnitude;
+}
+
+float VolmeterSubscription::GetPeak(std::chrono::milliseconds window) const
+{
+	return getPeak(_volmeter->GetHistory(), getWindowStart(window));
+}
+
+float VolmeterSubscription::GetRMS(std::chrono::milliseconds window) const
+{
+	return getRMS(_volmeter->GetHistory(), getWindowStart(window));
+}
+
+float VolmeterSubscription::GetPercentile(std::chrono::milliseconds window,
+					  double percentile) const
+{
+	std::vector<float> peaks;
+	return getPercentile(_volmeter->GetHistory(), getWindowStart(window),
+			     percentile, peaks);
+}
+
+std::chrono::milliseconds
+VolmeterSubscription::GetTimeAbove(std::chrono::milliseconds window,
+				   float threshold) const
+{
+	const auto timeAbove = getTimeAbove(
+		_volmeter->GetHistory(), getWindowStart(window), threshold);
+	return std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::nanoseconds(timeAbove));
+}
+
+void VolmeterSubscription::WatchThreshold(const LevelWatch &watch)
+{
+	const auto current = std::atomic_load(&_levels->watch);
+	if (current && *current == watch) {
+		return;
+	}
+	std::atomic_store(&_levels->watch,
+			  std::shared_ptr<const LevelWatch>(
+				  std::make_shared<LevelWatch>(watch)));
+}
+
+void VolmeterSubscription::StopWatchingThreshold()
+{
+	std::atomic_store(&_levels->watch,
+			  std::shared_ptr<const LevelWatch>());
+}
+
+} // namespace advss
@@ -0,0 +1,85 @@
+#pragma once
+#include <obs.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace advss {
+
+constexpr std::chrono::seconds maxLevelWindow(60);
+
+class SharedVolmeter;
+struct AudioLevels;
+
+// Level measure of a subscription, which is watched for crossing a threshold
+struct LevelWatch {
+	enum class Measure {
+		PEAK,
+		RMS,
+		PERCENTILE,
+		// Time within the window the peak was above the threshold
+		TIME_ABOVE,
+	};
+
+	Measure measure = Measure::PEAK;
+	std::chrono::milliseconds window{0};
+	// Threshold in dB
+	float threshold = 0.f;
+	// The level has to fall below the threshold by this many dB before it
+	// is considered to be below it again
+	float hysteresis = 0.f;
+	// Only used by PERCENTILE
+	double percentile = 95.;
+	// Only used by TIME_ABOVE
+	std::chrono::milliseconds minTime{0};
+
+	bool operator==(const LevelWatch &) const;
+};
+
+// Subscription to the audio levels of a source.
+// All subscriptions for the same source share a single volmeter, which
+// publishes the levels to each of them.
+//
+// The volmeter also keeps a history of the levels of the last audio packets,
+// which can be used to evaluate the levels over a time window independent of
+// how often they are queried.
+// Windows are limited to maxLevelWindow.
+//
+// If a level measure is watched, the given callback is called from the audio
+// thread each time the measure crosses its threshold.
+class VolmeterSubscription {
+public:
+	VolmeterSubscription(const OBSWeakSource &source,
+			     std::function<void()> onThresholdCrossed = {});
+	~VolmeterSubscription();
+	VolmeterSubscription(const VolmeterSubscription &) = delete;
+	VolmeterSubscription &operator=(const VolmeterSubscription &) = delete;
+
+	bool UsesSource(const OBSWeakSource &source) const;
+	// Returns the highest peak in dB since the last call
+	float TakePeak();
+	// Returns the most recent magnitude in dB
+	float GetMagnitude() const;
+
+	// Highest peak in dB within the window
+	float GetPeak(std::chrono::milliseconds window) const;
+	// RMS level in dB within the window
+	float GetRMS(std::chrono::milliseconds window) const;
+	// Percentile (0 - 100) of the peaks in dB within the window
+	float GetPercentile(std::chrono::milliseconds window,
+			    double percentile) const;
+	// Time within the window the peak was above the threshold in dB
+	std::chrono::milliseconds
+	GetTimeAbove(std::chrono::milliseconds window, float threshold) const;
+
+	void WatchThreshold(const LevelWatch &);
+	void StopWatchingThreshold();
+
+private:
+	std::shared_ptr<SharedVolmeter> _volmeter;
+	std::shared_ptr<AudioLevels> _levels;
+};
+
+} // namespace advss
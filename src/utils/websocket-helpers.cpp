@@ -1,5 +1,6 @@
 #include "websocket-helpers.hpp"
 #include "connection-manager.hpp"
+#include "network-event-loop.hpp"
 #include "switcher-data.hpp"
 
 #include <QCryptographicHash>
@@ -13,17 +14,15 @@ using websocketpp::lib::bind;
 
 #define RPC_VERSION 1
 
+constexpr size_t maxQueuedMessages = 1000;
+constexpr size_t maxRequestBatchSize = 100;
+
 obs_websocket_vendor vendor;
 
-void ClearWebsocketMessages()
+MessageBuffer<std::string> &GetWebsocketMessages()
 {
-	switcher->websocketMessages.clear();
-	for (auto &connection : switcher->connections) {
-		Connection *c = dynamic_cast<Connection *>(connection.get());
-		if (c) {
-			c->Events().clear();
-		}
-	}
+	static MessageBuffer<std::string> messages;
+	return messages;
 }
 
 void SendWebsocketEvent(const std::string &eventMsg)
@@ -44,8 +43,7 @@ static void receiveWebsocketMessage(obs_data_t *request_data, obs_data_t *,
 	}
 
 	auto msg = obs_data_get_string(request_data, "message");
-	std::lock_guard<std::mutex> lock(switcher->m);
-	switcher->websocketMessages.emplace_back(msg);
+	GetWebsocketMessages().Push(msg);
 	vblog(LOG_INFO, "received message: %s", msg);
 }
 
@@ -81,56 +79,78 @@ WSConnection::WSConnection(bool useOBSProtocol) : QObject(nullptr)
 		websocketpp::log::alevel::frame_header |
 		websocketpp::log::alevel::frame_payload |
 		websocketpp::log::alevel::control);
-	_client.init_asio();
+	_client.init_asio(&GetNetworkEventLoop());
 #ifndef _WIN32
 	_client.set_reuse_addr(true);
 #endif
 
 	UseOBSWebsocketProtocol(useOBSProtocol);
 	_client.set_close_handler(bind(&WSConnection::OnClose, this, _1));
+	_client.set_fail_handler(bind(&WSConnection::OnFail, this, _1));
 }
 
 WSConnection::~WSConnection()
 {
 	Disconnect();
+	while (_pendingHandlers > 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	}
 }
 
-void WSConnection::ConnectThread()
-{
-	do {
-		std::unique_lock<std::mutex> lck(_waitMtx);
-		_client.reset();
-		_status = Status::CONNECTING;
-		// Create a connection to the given URI and queue it for connection once
-		// the event loop starts
-		websocketpp::lib::error_code ec;
-		client::connection_ptr con = _client.get_connection(_uri, ec);
-		if (ec) {
-			_failMsg = ec.message();
-			blog(LOG_INFO, "connect to '%s' failed: %s",
-			     _uri.c_str(), _failMsg.c_str());
-		} else {
-			_failMsg = "";
-			_client.connect(con);
-			_connection = connection_hdl(con);
-
-			// Start the ASIO io_service run loop
-			vblog(LOG_INFO, "connect io thread started for '%s'",
-			      _uri.c_str());
-			_client.run();
-			vblog(LOG_INFO, "connect: io thread exited '%s'",
-			      _uri.c_str());
-		}
+// Must be called while holding _connectMtx
+void WSConnection::ConnectNow()
+{
+	_status = Status::CONNECTING;
+	// The connection is established by the shared event loop
+	websocketpp::lib::error_code ec;
+	client::connection_ptr con = _client.get_connection(_uri, ec);
+	if (ec) {
+		_failMsg = ec.message();
+		blog(LOG_INFO, "connect to '%s' failed: %s", _uri.c_str(),
+		     _failMsg.c_str());
+		_status = Status::DISCONNECTED;
+		ScheduleReconnect();
+		return;
+	}
+	_failMsg = "";
+	_connection = connection_hdl(con);
+	_client.connect(con);
+}
 
-		if (_reconnect) {
-			blog(LOG_INFO,
-			     "trying to reconnect to %s in %d seconds.",
-			     _uri.c_str(), _reconnectDelay);
-			_cv.wait_for(lck,
-				     std::chrono::seconds(_reconnectDelay));
-		}
-	} while (_reconnect && !_disconnect);
-	_status = Status::DISCONNECTED;
+// Must be called while holding _connectMtx
+void WSConnection::ScheduleReconnect()
+{
+	if (!_reconnect || _disconnect) {
+		return;
+	}
+	// Only a single reconnect attempt must be pending at any time
+	CancelReconnect();
+	blog(LOG_INFO, "trying to reconnect to %s in %d seconds.",
+	     _uri.c_str(), _reconnectDelay);
+	++_pendingHandlers;
+	_reconnectTimer = _client.set_timer(
+		_reconnectDelay * 1000,
+		[this](const websocketpp::lib::error_code &ec) {
+			if (!ec) {
+				std::lock_guard<std::mutex> lock(_connectMtx);
+				// Connect() might have been called in the
+				// meantime
+				if (!_disconnect &&
+				    _status == Status::DISCONNECTED) {
+					ConnectNow();
+				}
+			}
+			--_pendingHandlers;
+		});
+}
+
+// Must be called while holding _connectMtx
+void WSConnection::CancelReconnect()
+{
+	if (_reconnectTimer) {
+		_reconnectTimer->cancel();
+		_reconnectTimer.reset();
+	}
 }
 
 void WSConnection::Connect(const std::string &uri, const std::string &pass,
@@ -147,34 +167,28 @@ void WSConnection::Connect(const std::string &uri, const std::string &pass,
 	_reconnect = reconnect;
 	_reconnectDelay = reconnectDelay;
 	_disconnect = false;
-	if (_thread.joinable()) {
-		_thread.join();
-	}
-	_thread = std::thread(&WSConnection::ConnectThread, this);
+	CancelReconnect();
+	ConnectNow();
 	blog(LOG_INFO, "connect to '%s' started", uri.c_str());
 }
 
 void WSConnection::Disconnect()
 {
-	std::lock_guard<std::mutex> lock(_connectMtx);
-	_disconnect = true;
-	websocketpp::lib::error_code ec;
-	_client.close(_connection, websocketpp::close::status::normal,
-		      "Client stopping", ec);
 	{
-		std::unique_lock<std::mutex> waitLck(_waitMtx);
-		_cv.notify_all();
+		std::lock_guard<std::mutex> lock(_connectMtx);
+		_disconnect = true;
+		CancelReconnect();
 	}
 
+	// The close and fail handlers require the connect lock
+	websocketpp::lib::error_code ec;
+	_client.close(_connection, websocketpp::close::status::normal,
+		      "Client stopping", ec);
 	while (_status != Status::DISCONNECTED) {
 		std::this_thread::sleep_for(std::chrono::milliseconds(10));
 		_client.close(_connection, websocketpp::close::status::normal,
 			      "Client stopping", ec);
 	}
-
-	if (_thread.joinable()) {
-		_thread.join();
-	}
 	_status = Status::DISCONNECTED;
 }
 
@@ -207,9 +221,145 @@ std::string ConstructVendorRequestMessage(const std::string &message)
 	return result;
 }
 
-void WSConnection::SendRequest(const std::string &msg)
+void WSConnection::QueueMessage(const std::string &msg)
+{
+	{
+		std::lock_guard<std::mutex> lock(_sendMtx);
+		_sendQueue.emplace_back(msg);
+		if (_sendQueue.size() > maxQueuedMessages) {
+			_sendQueue.pop_front();
+			++_droppedMessages;
+			vblog(LOG_INFO,
+			      "send queue of '%s' full - dropped oldest message (%llu dropped in total)",
+			      _uri.c_str(),
+			      (unsigned long long)_droppedMessages.load());
+		}
+	}
+
+	// If the connection is not established yet, the queue is drained
+	// once it is
+	ScheduleDrain();
+}
+
+void WSConnection::ScheduleDrain()
 {
-	Send(msg);
+	{
+		std::lock_guard<std::mutex> lock(_sendMtx);
+		// Bursts of messages are drained by a single handler and only
+		// one handler may send at any time to keep the message order
+		if (_drainPending || _status != Status::AUTHENTICATED) {
+			return;
+		}
+		_drainPending = true;
+	}
+
+	++_pendingHandlers;
+	_client.get_io_service().post([this]() {
+		DrainSendQueue();
+		--_pendingHandlers;
+	});
+}
+
+size_t WSConnection::GetQueueDepth() const
+{
+	std::lock_guard<std::mutex> lock(_sendMtx);
+	return _sendQueue.size();
+}
+
+void WSConnection::Requeue(std::deque<std::string> &messages)
+{
+	_sendQueue.insert(_sendQueue.begin(),
+			  std::make_move_iterator(messages.begin()),
+			  std::make_move_iterator(messages.end()));
+	while (_sendQueue.size() > maxQueuedMessages) {
+		_sendQueue.pop_front();
+		++_droppedMessages;
+	}
+}
+
+static bool isOBSRequest(const std::string &msg)
+{
+	OBSDataAutoRelease json = obs_data_create_from_json(msg.c_str());
+	return json && obs_data_get_int(json, "op") == 6;
+}
+
+static std::string
+constructRequestBatch(std::deque<std::string>::const_iterator begin,
+		      std::deque<std::string>::const_iterator end)
+{
+	OBSDataArrayAutoRelease requests = obs_data_array_create();
+	for (auto it = begin; it != end; ++it) {
+		OBSDataAutoRelease json =
+			obs_data_create_from_json(it->c_str());
+		OBSDataAutoRelease request = obs_data_get_obj(json, "d");
+		obs_data_array_push_back(requests, request);
+	}
+
+	OBSDataAutoRelease data = obs_data_create();
+	obs_data_set_string(data, "requestId",
+			    std::to_string(std::chrono::steady_clock::now()
+						   .time_since_epoch()
+						   .count())
+				    .c_str());
+	obs_data_set_bool(data, "haltOnFailure", false);
+	obs_data_set_array(data, "requests", requests);
+
+	OBSDataAutoRelease batch = obs_data_create();
+	obs_data_set_int(batch, "op", 8);
+	obs_data_set_obj(batch, "d", data);
+	return obs_data_get_json(batch);
+}
+
+void WSConnection::DrainSendQueue()
+{
+	std::deque<std::string> messages;
+	while (true) {
+		{
+			std::lock_guard<std::mutex> lock(_sendMtx);
+			// Messages queued while sending are handled by this
+			// drain instead of a new one running concurrently
+			if (_status != Status::AUTHENTICATED ||
+			    _sendQueue.empty()) {
+				_drainPending = false;
+				return;
+			}
+			messages.swap(_sendQueue);
+		}
+		if (!SendMessages(messages)) {
+			std::lock_guard<std::mutex> lock(_sendMtx);
+			Requeue(messages);
+			_drainPending = false;
+			return;
+		}
+	}
+}
+
+bool WSConnection::SendMessages(std::deque<std::string> &messages)
+{
+	while (!messages.empty()) {
+		// Consecutive requests are combined into a single RequestBatch
+		size_t count = 0;
+		while (_useOBSProtocol && count < messages.size() &&
+		       count < maxRequestBatchSize &&
+		       isOBSRequest(messages[count])) {
+			++count;
+		}
+
+		std::string frame;
+		if (count > 1) {
+			frame = constructRequestBatch(messages.begin(),
+						      messages.begin() + count);
+		} else {
+			count = 1;
+			frame = messages.front();
+		}
+
+		if (!Send(frame)) {
+			return false;
+		}
+		messages.erase(messages.begin(), messages.begin() + count);
+	}
+	return true;
 }
 
 WSConnection::Status WSConnection::GetStatus() const
@@ -219,6 +369,7 @@ WSConnection::Status WSConnection::GetStatus() const
 
 void WSConnection::UseOBSWebsocketProtocol(bool useOBSProtocol)
 {
+	_useOBSProtocol = useOBSProtocol;
 	_client.set_open_handler(bind(useOBSProtocol
 					      ? &WSConnection::OnOBSOpen
 					      : &WSConnection::OnGenericOpen,
@@ -233,6 +384,7 @@ void WSConnection::OnGenericOpen(connection_hdl hdl)
 {
 	blog(LOG_INFO, "connection to %s opened", _uri.c_str());
 	_status = Status::AUTHENTICATED;
+	ScheduleDrain();
 }
 
 void WSConnection::OnOBSOpen(connection_hdl)
@@ -294,8 +446,7 @@ void WSConnection::HandleEvent(obs_data_t *msg)
 		return;
 	}
 	auto eventDataNested = obs_data_get_obj(eventData, "eventData");
-	std::lock_guard<std::mutex> lock(switcher->m);
-	_messages.emplace_back(obs_data_get_string(eventDataNested, "message"));
+	_messages.Push(obs_data_get_string(eventDataNested, "message"));
 	vblog(LOG_INFO, "received event msg \"%s\"",
 	      obs_data_get_string(eventDataNested, "message"));
 	obs_data_release(eventDataNested);
@@ -317,6 +468,24 @@ void WSConnection::HandleResponse(obs_data_t *response)
 	obs_data_release(data);
 }
 
+void WSConnection::HandleBatchResponse(obs_data_t *response)
+{
+	OBSDataAutoRelease data = obs_data_get_obj(response, "d");
+	OBSDataArrayAutoRelease results = obs_data_get_array(data, "results");
+	const size_t count = obs_data_array_count(results);
+	for (size_t i = 0; i < count; i++) {
+		OBSDataAutoRelease result = obs_data_array_item(results, i);
+		OBSDataAutoRelease status =
+			obs_data_get_obj(result, "requestStatus");
+		vblog(LOG_INFO,
+		      "received batch result '%d' with code '%d' (%s) for id '%s'",
+		      obs_data_get_bool(status, "result"),
+		      (int)obs_data_get_int(status, "code"),
+		      obs_data_get_string(status, "comment"),
+		      obs_data_get_string(result, "requestId"));
+	}
+}
+
 void WSConnection::OnGenericMessage(connection_hdl hdl,
 				    client::message_ptr message)
 {
@@ -327,9 +496,8 @@ void WSConnection::OnGenericMessage(connection_hdl hdl,
 		return;
 	}
 
-	std::lock_guard<std::mutex> lock(switcher->m);
 	const auto payload = message->get_payload();
-	_messages.emplace_back(payload);
+	_messages.Push(payload);
 	vblog(LOG_INFO, "received event msg \"%s\"", payload.c_str());
 }
 
@@ -364,6 +532,7 @@ void WSConnection::OnOBSMessage(connection_hdl, client::message_ptr message)
 		break;
 	case 2: // Identified
 		_status = Status::AUTHENTICATED;
+		ScheduleDrain();
 		break;
 	case 5: // Event (Vendor)
 		HandleEvent(json);
@@ -371,6 +540,9 @@ void WSConnection::OnOBSMessage(connection_hdl, client::message_ptr message)
 	case 7: // RequestResponse
 		HandleResponse(json);
 		break;
+	case 9: // RequestBatchResponse
+		HandleBatchResponse(json);
+		break;
 	default:
 		vblog(LOG_INFO, "ignoring unknown opcode %d", opcode);
 		break;
@@ -378,10 +550,10 @@ void WSConnection::OnOBSMessage(connection_hdl, client::message_ptr message)
 	obs_data_release(json);
 }
 
-void WSConnection::Send(const std::string &msg)
+bool WSConnection::Send(const std::string &msg)
 {
 	if (_connection.expired()) {
-		return;
+		return false;
 	}
 	websocketpp::lib::error_code errorCode;
 	_client.send(_connection, msg, websocketpp::frame::opcode::text,
@@ -390,13 +562,35 @@ void WSConnection::Send(const std::string &msg)
 		std::string errorCodeMessage = errorCode.message();
 		blog(LOG_INFO, "websocket send failed: %s",
 		     errorCodeMessage.c_str());
+		return false;
 	}
 	vblog(LOG_INFO, "sent message to '%s':\n%s", _uri.c_str(), msg.c_str());
+	return true;
 }
 
 void WSConnection::OnClose(connection_hdl)
 {
 	blog(LOG_INFO, "client-connection to %s closed.", _uri.c_str());
+	{
+		std::lock_guard<std::mutex> lock(_connectMtx);
+		ScheduleReconnect();
+	}
+	// This object might be destroyed as soon as the status is updated
+	_status = Status::DISCONNECTED;
+}
+
+void WSConnection::OnFail(connection_hdl hdl)
+{
+	websocketpp::lib::error_code ec;
+	auto con = _client.get_con_from_hdl(hdl, ec);
+	_failMsg = con ? con->get_ec().message() : ec.message();
+	blog(LOG_INFO, "connect to '%s' failed: %s", _uri.c_str(),
+	     _failMsg.c_str());
+	{
+		std::lock_guard<std::mutex> lock(_connectMtx);
+		ScheduleReconnect();
+	}
+	// This object might be destroyed as soon as the status is updated
 	_status = Status::DISCONNECTED;
 }
 
@@ -1,4 +1,5 @@
 #pragma once
+#include "message-buffer.hpp"
 
 #include <set>
 #include <QtCore/QObject>
@@ -8,6 +9,7 @@
 #include <QtCore/QThreadPool>
 #include <mutex>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <QRunnable>
 
@@ -28,7 +30,8 @@ constexpr char VendorName[] = "AdvancedSceneSwitcher";
 constexpr char VendorRequest[] = "AdvancedSceneSwitcherMessage";
 constexpr char VendorEvent[] = "AdvancedSceneSwitcherEvent";
 
-void ClearWebsocketMessages();
+// Messages received via the obs-websocket vendor request
+MessageBuffer<std::string> &GetWebsocketMessages();
 void SendWebsocketEvent(const std::string &);
 std::string ConstructVendorRequestMessage(const std::string &message);
 
@@ -40,8 +43,13 @@ public:
 	void Connect(const std::string &uri, const std::string &pass,
 		     bool _reconnect, int reconnectDelay = 10);
 	void Disconnect();
-	void SendRequest(const std::string &msg);
-	std::vector<std::string> &Events() { return _messages; }
+	// Messages are sent asynchronously by the network thread.
+	// Messages queued while the connection is not established are kept
+	// until it is (re-)established or the queue limit is exceeded, in
+	// which case the oldest messages are dropped.
+	void QueueMessage(const std::string &msg);
+	size_t GetQueueDepth() const;
+	MessageBuffer<std::string> &Events() { return _messages; }
 	std::string GetFail() { return _failMsg; }
 
 	enum class Status {
@@ -59,27 +67,43 @@ private:
 	void OnGenericMessage(connection_hdl hdl, client::message_ptr message);
 	void OnOBSMessage(connection_hdl hdl, client::message_ptr message);
 	void OnClose(connection_hdl hdl);
-	void Send(const std::string &);
-	void ConnectThread();
+	void OnFail(connection_hdl hdl);
+	bool Send(const std::string &);
+	void ConnectNow();
+	void ScheduleReconnect();
+	void CancelReconnect();
 	void HandleHello(obs_data_t *helloMsg);
 	void HandleEvent(obs_data_t *event);
 	void HandleResponse(obs_data_t *response);
+	void HandleBatchResponse(obs_data_t *response);
+	void ScheduleDrain();
+	void DrainSendQueue();
+	bool SendMessages(std::deque<std::string> &messages);
+	// Must be called with _sendMtx locked
+	void Requeue(std::deque<std::string> &messages);
 
 	client _client;
 	std::string _uri = "";
 	std::string _password = "";
 	connection_hdl _connection;
-	std::thread _thread;
 	bool _reconnect = false;
 	int _reconnectDelay = 10;
-	std::mutex _waitMtx;
 	std::mutex _connectMtx;
-	std::condition_variable _cv;
+	client::timer_ptr _reconnectTimer;
+	// Handlers scheduled on the shared event loop referring to this object
+	std::atomic_int _pendingHandlers{0};
 	std::string _failMsg = "";
 	std::atomic<Status> _status = {Status::DISCONNECTED};
 	std::atomic_bool _disconnect{false};
+	std::atomic_bool _useOBSProtocol{true};
 
-	std::vector<std::string> _messages;
+	mutable std::mutex _sendMtx;
+	std::deque<std::string> _sendQueue;
+	// Set while a drain is scheduled or running
+	bool _drainPending = false;
+	std::atomic<uint64_t> _droppedMessages{0};
+
+	MessageBuffer<std::string> _messages;
 };
 
 } // namespace advss
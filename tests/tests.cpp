@@ -2,6 +2,9 @@
 #include "catch.hpp"
 
 #include <math-helpers.hpp>
+#include <message-buffer.hpp>
+#include <message-dispatcher.hpp>
+#include <event-sub-message.hpp>
 
 TEST_CASE("Expressions are evaluated successfully", "[math-helpers]")
 {
@@ -94,3 +97,260 @@ TEST_CASE("Invalid expressions are not evaluated", "[math-helpers]")
 
 	REQUIRE(doubleValuePtr == nullptr);
 }
+
+TEST_CASE("Regex subscribers receive matching messages", "[message-dispatcher]")
+{
+	advss::MessageBuffer<std::string> buffer;
+	const auto check = [&buffer](advss::MessageSubscription &subscription,
+				     const QString &pattern,
+				     QRegularExpression::PatternOptions
+					     options = {}) {
+		return subscription.CheckForMatch(
+			buffer, "", QRegularExpression(pattern, options));
+	};
+
+	advss::MessageSubscription exact;
+	advss::MessageSubscription partial;
+	advss::MessageSubscription anchored;
+	advss::MessageSubscription caseInsensitive;
+	advss::MessageSubscription extended;
+	advss::MessageSubscription backReference;
+	advss::MessageSubscription subroutine;
+	advss::MessageSubscription noMatch;
+
+	// Subscriptions only receive messages added after the first check
+	buffer.Push("hello world");
+	REQUIRE_FALSE(exact.CheckForMatch(buffer, "hello world", std::nullopt));
+	REQUIRE_FALSE(check(partial, "wor"));
+	REQUIRE_FALSE(check(anchored,
+			    QRegularExpression::anchoredPattern("hello.*")));
+	REQUIRE_FALSE(check(caseInsensitive, "HELLO",
+			    QRegularExpression::CaseInsensitiveOption));
+	REQUIRE_FALSE(check(extended, "hello \\s world # comment",
+			    QRegularExpression::ExtendedPatternSyntaxOption));
+	REQUIRE_FALSE(check(backReference, "(l)\\1"));
+	REQUIRE_FALSE(check(subroutine, "(l)(?1)o"));
+	REQUIRE_FALSE(check(noMatch, "xyz"));
+
+	buffer.Push("hello world");
+	REQUIRE(exact.CheckForMatch(buffer, "hello world", std::nullopt) ==
+		"hello world");
+	REQUIRE(check(partial, "wor") == "hello world");
+	REQUIRE(check(anchored,
+		      QRegularExpression::anchoredPattern("hello.*")) ==
+		"hello world");
+	REQUIRE(check(caseInsensitive, "HELLO",
+		      QRegularExpression::CaseInsensitiveOption) ==
+		"hello world");
+	REQUIRE(check(extended, "hello \\s world # comment",
+		      QRegularExpression::ExtendedPatternSyntaxOption) ==
+		"hello world");
+	REQUIRE(check(backReference, "(l)\\1") == "hello world");
+	REQUIRE(check(subroutine, "(l)(?1)o") == "hello world");
+	REQUIRE_FALSE(check(noMatch, "xyz"));
+
+	// Each message is only reported once
+	REQUIRE_FALSE(check(partial, "wor"));
+}
+
+TEST_CASE("EventSub messages are parsed", "[twitch]")
+{
+	using advss::EventSubMessage;
+
+	auto message = advss::ParseEventSubMessage(R"({
+		"metadata": {
+			"message_id": "1",
+			"message_type": "session_welcome"
+		},
+		"payload": {
+			"session": {
+				"id": "session",
+				"keepalive_timeout_seconds": 10,
+				"reconnect_url": null
+			}
+		}
+	})");
+	REQUIRE(message);
+	REQUIRE(message->type == EventSubMessage::Type::WELCOME);
+	REQUIRE(message->id == "1");
+	REQUIRE(message->sessionId == "session");
+	REQUIRE(message->keepaliveTimeout == std::chrono::seconds(10));
+	REQUIRE(message->reconnectURL.empty());
+
+	message = advss::ParseEventSubMessage(R"({
+		"metadata": {
+			"message_id": "2",
+			"message_type": "session_keepalive"
+		},
+		"payload": {}
+	})");
+	REQUIRE(message);
+	REQUIRE(message->type == EventSubMessage::Type::KEEPALIVE);
+
+	message = advss::ParseEventSubMessage(R"({
+		"metadata": {
+			"message_id": "3",
+			"message_type": "notification",
+			"subscription_type": "channel.follow"
+		},
+		"payload": {
+			"subscription": {
+				"type": "channel.follow",
+				"status": "enabled"
+			},
+			"event": {"user_name": "follower"}
+		}
+	})");
+	REQUIRE(message);
+	REQUIRE(message->type == EventSubMessage::Type::NOTIFICATION);
+	REQUIRE(message->subscriptionType == "channel.follow");
+	REQUIRE(message->event == R"({"user_name":"follower"})");
+
+	message = advss::ParseEventSubMessage(R"({
+		"metadata": {
+			"message_id": "4",
+			"message_type": "session_reconnect"
+		},
+		"payload": {
+			"session": {
+				"id": "session",
+				"keepalive_timeout_seconds": null,
+				"reconnect_url": "wss://127.0.0.1/ws?id=session"
+			}
+		}
+	})");
+	REQUIRE(message);
+	REQUIRE(message->type == EventSubMessage::Type::RECONNECT);
+	REQUIRE_FALSE(message->keepaliveTimeout);
+	REQUIRE(message->reconnectURL == "wss://127.0.0.1/ws?id=session");
+
+	message = advss::ParseEventSubMessage(R"({
+		"metadata": {
+			"message_id": "5",
+			"message_type": "revocation"
+		},
+		"payload": {
+			"subscription": {
+				"type": "stream.online",
+				"status": "authorization_revoked"
+			}
+		}
+	})");
+	REQUIRE(message);
+	REQUIRE(message->type == EventSubMessage::Type::REVOCATION);
+	REQUIRE(message->subscriptionType == "stream.online");
+	REQUIRE(message->subscriptionStatus == "authorization_revoked");
+
+	message = advss::ParseEventSubMessage(
+		R"({"metadata": {"message_type": "something_new"}})");
+	REQUIRE(message);
+	REQUIRE(message->type == EventSubMessage::Type::UNKNOWN);
+
+	REQUIRE_FALSE(advss::ParseEventSubMessage("not json"));
+}
+
+TEST_CASE("Duplicate EventSub messages are detected", "[twitch]")
+{
+	advss::MessageIdFilter filter(2);
+
+	REQUIRE_FALSE(filter.IsDuplicate("1"));
+	REQUIRE(filter.IsDuplicate("1"));
+	REQUIRE_FALSE(filter.IsDuplicate("2"));
+	REQUIRE(filter.IsDuplicate("1"));
+
+	// Only the most recent ids are remembered
+	REQUIRE_FALSE(filter.IsDuplicate("3"));
+	REQUIRE_FALSE(filter.IsDuplicate("1"));
+	REQUIRE(filter.IsDuplicate("3"));
+
+	// Messages without an id are never dropped
+	REQUIRE_FALSE(filter.IsDuplicate(""));
+	REQUIRE_FALSE(filter.IsDuplicate(""));
+}
+
+TEST_CASE("Message buffer cursors only see new messages", "[message-buffer]")
+{
+	advss::MessageBuffer<int> buffer;
+	buffer.Push(1);
+
+	// A new cursor is positioned at the end of the buffer
+	advss::MessageBuffer<int>::Cursor cursor;
+	REQUIRE(buffer.Read(cursor).empty());
+	REQUIRE(cursor.bufferId == buffer.GetId());
+
+	auto otherCursor = buffer.GetCursor();
+	REQUIRE(buffer.Read(otherCursor).empty());
+
+	buffer.Push(2);
+	REQUIRE(buffer.Read(cursor) == std::vector<int>{2});
+	REQUIRE(buffer.Read(otherCursor) == std::vector<int>{2});
+}
+
+TEST_CASE("Message buffer messages are read exactly once", "[message-buffer]")
+{
+	advss::MessageBuffer<int> buffer;
+	auto cursor1 = buffer.GetCursor();
+	auto cursor2 = buffer.GetCursor();
+
+	buffer.Push(1);
+	buffer.Push(2);
+	REQUIRE(buffer.Read(cursor1) == std::vector<int>{1, 2});
+	REQUIRE(buffer.Read(cursor1).empty());
+
+	buffer.Push(3);
+	REQUIRE(buffer.Read(cursor1) == std::vector<int>{3});
+	REQUIRE(buffer.Read(cursor1).empty());
+
+	// Consumers are independent of each other
+	REQUIRE(buffer.Read(cursor2) == std::vector<int>{1, 2, 3});
+	REQUIRE(buffer.Read(cursor2).empty());
+}
+
+TEST_CASE("Message buffer drops the oldest messages", "[message-buffer]")
+{
+	advss::MessageBuffer<int> buffer(3);
+	auto cursor = buffer.GetCursor();
+	auto slowCursor = buffer.GetCursor();
+
+	for (int i = 1; i <= 5; i++) {
+		buffer.Push(i);
+	}
+	REQUIRE(buffer.Read(cursor) == std::vector<int>{3, 4, 5});
+
+	buffer.Push(6);
+	REQUIRE(buffer.Read(cursor) == std::vector<int>{6});
+
+	// Messages dropped before they were read are skipped
+	REQUIRE(buffer.Read(slowCursor) == std::vector<int>{4, 5, 6});
+	REQUIRE(buffer.Read(slowCursor).empty());
+
+	advss::MessageBuffer<int> minimalBuffer(0);
+	auto minimalCursor = minimalBuffer.GetCursor();
+	minimalBuffer.Push(1);
+	minimalBuffer.Push(2);
+	REQUIRE(minimalBuffer.Read(minimalCursor) == std::vector<int>{2});
+}
+
+TEST_CASE("Message buffer cursors are reset for other buffers",
+	  "[message-buffer]")
+{
+	advss::MessageBuffer<int> buffer1;
+	advss::MessageBuffer<int> buffer2;
+	REQUIRE(buffer1.GetId() != buffer2.GetId());
+
+	auto cursor = buffer1.GetCursor();
+	buffer1.Push(1);
+	buffer2.Push(2);
+
+	// Switching buffers does not return messages sent before the switch
+	REQUIRE(buffer2.Read(cursor).empty());
+	REQUIRE(cursor.bufferId == buffer2.GetId());
+	buffer2.Push(3);
+	REQUIRE(buffer2.Read(cursor) == std::vector<int>{3});
+
+	// Switching back does not return the unread messages either
+	buffer1.Push(4);
+	REQUIRE(buffer1.Read(cursor).empty());
+	buffer1.Push(5);
+	REQUIRE(buffer1.Read(cursor) == std::vector<int>{5});
+}
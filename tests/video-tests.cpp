@@ -0,0 +1,249 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "catch.hpp"
+
+#include <opencv-helpers.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+// The video helpers used to process the images pixel by pixel.
+// The functions below are those original implementations, which the current
+// ones are compared against.
+//
+// The benchmarks are not run by default and can be run using:
+//   advanced-scene-switcher-tests-video "[benchmark]"
+
+namespace {
+
+bool colorIsSimilarReference(const QColor &color1, const QColor &color2,
+			     int maxDiff)
+{
+	const int diffRed = std::abs(color1.red() - color2.red());
+	const int diffGreen = std::abs(color1.green() - color2.green());
+	const int diffBlue = std::abs(color1.blue() - color2.blue());
+
+	return diffRed <= maxDiff && diffGreen <= maxDiff &&
+	       diffBlue <= maxDiff;
+}
+
+int countSimilarPixelsReference(const QImage &image, const QColor &color,
+				int maxDiff)
+{
+	int matchingPixels = 0;
+	for (int y = 0; y < image.height(); y++) {
+		for (int x = 0; x < image.width(); x++) {
+			if (colorIsSimilarReference(image.pixelColor(x, y),
+						    color, maxDiff)) {
+				matchingPixels++;
+			}
+		}
+	}
+	return matchingPixels;
+}
+
+bool containsPixelsInColorRangeReference(const QImage &image,
+					 const QColor &color,
+					 double colorDeviationThreshold,
+					 double totalPixelMatchThreshold)
+{
+	int totalPixels = image.width() * image.height();
+	int maxColorDiff = static_cast<int>(colorDeviationThreshold * 255.0);
+	int matchingPixels =
+		countSimilarPixelsReference(image, color, maxColorDiff);
+	double matchPercentage =
+		static_cast<double>(matchingPixels) / totalPixels;
+	return matchPercentage >= totalPixelMatchThreshold;
+}
+
+cv::Mat1b preprocessForOCRReference(const QImage &image,
+				    const QColor &textColor, double colorDiff)
+{
+	const int diff = colorDiff * 255;
+	cv::Mat1b mat(image.height(), image.width());
+	for (int y = 0; y < image.height(); y++) {
+		for (int x = 0; x < image.width(); x++) {
+			mat(y, x) = colorIsSimilarReference(
+					    image.pixelColor(x, y), textColor,
+					    diff)
+					    ? 0
+					    : 255;
+		}
+	}
+	return mat;
+}
+
+uchar getAvgBrightnessReference(QImage &img)
+{
+	auto image = advss::QImageToMat(img);
+	cv::Mat hsvImage, rgbImage;
+	cv::cvtColor(image, rgbImage, cv::COLOR_RGBA2RGB);
+	cv::cvtColor(rgbImage, hsvImage, cv::COLOR_RGB2HSV);
+	long long brightnessSum = 0;
+	for (int i = 0; i < hsvImage.rows; ++i) {
+		for (int j = 0; j < hsvImage.cols; ++j) {
+			brightnessSum += hsvImage.at<cv::Vec3b>(i, j)[2];
+		}
+	}
+	return brightnessSum / (hsvImage.rows * hsvImage.cols);
+}
+
+QImage createRandomImage(int width, int height)
+{
+	QImage image(width, height, QImage::Format_RGBA8888);
+	auto mat = advss::QImageToMat(image);
+	cv::RNG rng(42);
+	rng.fill(mat, cv::RNG::UNIFORM, 0, 256);
+	return image;
+}
+
+// Creates an image, whose channels lie right inside and outside of the range
+// around the given color
+QImage createColorRangeBoundaryImage(const QColor &color, int maxDiff)
+{
+	const int offsets[] = {-maxDiff - 1, -maxDiff, 0, maxDiff,
+			       maxDiff + 1};
+	constexpr int count = sizeof(offsets) / sizeof(offsets[0]);
+	const auto channel = [](int value, int offset) {
+		return std::clamp(value + offset, 0, 255);
+	};
+
+	QImage image(count * count, count, QImage::Format_RGBA8888);
+	for (int r = 0; r < count; r++) {
+		for (int g = 0; g < count; g++) {
+			for (int b = 0; b < count; b++) {
+				const QColor pixel(
+					channel(color.red(), offsets[r]),
+					channel(color.green(), offsets[g]),
+					channel(color.blue(), offsets[b]));
+				image.setPixelColor(r * count + g, b, pixel);
+			}
+		}
+	}
+	return image;
+}
+
+} // namespace
+
+TEST_CASE("Pixels in color range are detected", "[video]")
+{
+	auto image = createRandomImage(1920, 1080);
+	const QColor color(100, 150, 200);
+
+	for (const double deviation : {0.0, 0.1, 0.3, 0.5, 1.0}) {
+		const int maxDiff = static_cast<int>(deviation * 255.0);
+		const double ratio =
+			static_cast<double>(countSimilarPixelsReference(
+				image, color, maxDiff)) /
+			(image.width() * image.height());
+		for (const double threshold :
+		     {0.0, ratio, std::nextafter(ratio, 2.0), 1.0}) {
+			REQUIRE(advss::ContainsPixelsInColorRange(
+					image, color, deviation, threshold) ==
+				containsPixelsInColorRangeReference(
+					image, color, deviation, threshold));
+		}
+	}
+
+	for (const QColor &boundaryColor :
+	     {color, QColor(0, 0, 0), QColor(255, 255, 255)}) {
+		const double deviation = 0.1;
+		const int maxDiff = static_cast<int>(deviation * 255.0);
+		auto boundaryImage =
+			createColorRangeBoundaryImage(boundaryColor, maxDiff);
+		const auto expected = preprocessForOCRReference(
+			boundaryImage, boundaryColor, deviation);
+		const auto result = advss::PreprocessForOCR(
+			boundaryImage, boundaryColor, deviation);
+		REQUIRE(cv::countNonZero(expected != result) == 0);
+	}
+}
+
+TEST_CASE("Images are preprocessed for OCR", "[video]")
+{
+	auto image = createRandomImage(1920, 1080);
+	const QColor color(20, 230, 128);
+
+	for (const double deviation : {0.0, 0.1, 0.3}) {
+		const auto expected =
+			preprocessForOCRReference(image, color, deviation);
+		const auto result =
+			advss::PreprocessForOCR(image, color, deviation);
+		REQUIRE(result.size() == expected.size());
+		REQUIRE(cv::countNonZero(expected != result) == 0);
+	}
+}
+
+TEST_CASE("Average brightness is determined", "[video]")
+{
+	auto image = createRandomImage(1920, 1080);
+	REQUIRE(advss::GetAvgBrightness(image) ==
+		getAvgBrightnessReference(image));
+
+	QImage dark(1920, 1080, QImage::Format_RGBA8888);
+	dark.fill(QColor(10, 40, 20));
+	REQUIRE(advss::GetAvgBrightness(dark) == 40);
+	REQUIRE(getAvgBrightnessReference(dark) == 40);
+}
+
+TEST_CASE("Pattern match results are inverted", "[video]")
+{
+	auto image = createRandomImage(640, 360);
+	const auto pattern = image.copy(100, 50, 64, 64);
+	const auto patternData = advss::CreatePatternData(pattern);
+
+	cv::Mat result;
+	advss::MatchPattern(image, patternData, 0.0, result, false,
+			    cv::TM_SQDIFF_NORMED);
+
+	cv::Mat expected;
+	cv::matchTemplate(advss::QImageToMat(image), patternData.rgbaPattern,
+			  expected, cv::TM_SQDIFF_NORMED);
+	for (int r = 0; r < expected.rows; r++) {
+		for (int c = 0; c < expected.cols; c++) {
+			expected.at<float>(r, c) =
+				1.0 - expected.at<float>(r, c);
+		}
+	}
+	cv::threshold(expected, expected, 0.0, 0.0, cv::THRESH_TOZERO);
+
+	REQUIRE(result.size() == expected.size());
+	REQUIRE(cv::norm(result, expected, cv::NORM_INF) ==
+		Approx(0.0).margin(1e-6));
+	REQUIRE(result.at<float>(50, 100) == Approx(1.0).margin(1e-6));
+}
+
+TEST_CASE("Video helper benchmarks", "[.][benchmark]")
+{
+	auto image = createRandomImage(1920, 1080);
+	const QColor color(100, 150, 200);
+
+	BENCHMARK("ContainsPixelsInColorRange")
+	{
+		return advss::ContainsPixelsInColorRange(image, color, 0.1,
+							 0.5);
+	};
+	BENCHMARK("ContainsPixelsInColorRange (per pixel)")
+	{
+		return containsPixelsInColorRangeReference(image, color, 0.1,
+							   0.5);
+	};
+
+	BENCHMARK("PreprocessForOCR")
+	{
+		return advss::PreprocessForOCR(image, color, 0.1);
+	};
+	BENCHMARK("PreprocessForOCR (per pixel)")
+	{
+		return preprocessForOCRReference(image, color, 0.1);
+	};
+
+	BENCHMARK("GetAvgBrightness")
+	{
+		return advss::GetAvgBrightness(image);
+	};
+	BENCHMARK("GetAvgBrightness (HSV conversion)")
+	{
+		return getAvgBrightnessReference(image);
+	};
+}